@@ -24,6 +24,7 @@ extern "C"
 
 #include "rcl/macros.h"
 #include "rcl/node.h"
+#include "rcl/time.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl client implementation struct.
@@ -35,11 +36,33 @@ typedef struct rcl_client_t
   struct rcl_client_impl_t * impl;
 } rcl_client_t;
 
+/// Callback which completes a request sent with rcl_send_request_async().
+/* \param[in] user_data the pointer which was given with the request
+ * \param[in] sequence_number the sequence number of the request
+ * \param[in] ros_response type-erased pointer to the response, or NULL if there is none
+ * \param[in] result RCL_RET_OK if the response arrived, or
+ *            RCL_RET_TIMEOUT if the request expired before it did, or
+ *            RCL_RET_CLIENT_INVALID if the client was finalized before it did.
+ */
+typedef void (* rcl_client_response_callback_t)(
+  const void * user_data,
+  int64_t sequence_number,
+  const void * ros_response,
+  rcl_ret_t result);
+
 /// Options available for a rcl client.
 typedef struct rcl_client_options_t
 {
   /// Middleware quality of service settings for the client.
   rmw_qos_profile_t qos;
+  /// Number of requests sent with rcl_send_request_async() which can wait for a response.
+  /* The table of pending requests is allocated with the allocator during
+   * rcl_client_init().
+   * This is also the window of a pipelined client, see
+   * rcl_send_request_batch_async().
+   * The default is 0, which disables rcl_send_request_async().
+   */
+  size_t max_pending_requests;
   /// Custom allocator for the client, used for incidental allocations.
   /* For default behavior (malloc/free), use: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
@@ -96,6 +119,8 @@ rcl_get_zero_initialized_client(void);
  * The options struct allows the user to set the quality of service settings as
  * well as a custom allocator which is used when initializing/finalizing the
  * client to allocate space for incidentals, e.g. the service name string.
+ * The quality of service settings are passed on to the middleware.
+ * A keep last history with a depth of 0 is considered invalid.
  *
  * Expected usage (for C services):
  *
@@ -146,6 +171,8 @@ rcl_client_init(
 /*
  * After calling, calls to rcl_send_request and rcl_take_response will fail when using this client.
  * However, the given node handle is still valid.
+ * Requests sent with rcl_send_request_async() which are still pending are
+ * completed with RCL_RET_CLIENT_INVALID.
  *
  * This function is not thread-safe.
  *
@@ -178,12 +205,16 @@ rcl_client_get_default_options(void);
  * The ROS request message given by the ros_request void pointer is always owned by the
  * calling code, but should remain constant during send_request.
  *
- * This function is thread safe so long as access to both the client and the
- * ros_request is synchronized.
- * That means that calling rcl_send_request from multiple threads is allowed, but
- * calling rcl_send_request at the same time as non-thread safe client functions
- * is not, e.g. calling rcl_send_request and rcl_client_fini concurrently
- * is not allowed.
+ * Whether this function is thread-safe for a single client depends entirely
+ * on the middleware: rcl keeps no state of its own while sending, and takes
+ * no lock around the middleware's send function, so concurrent calls with the
+ * same client are only safe if that function is thread-safe for one client,
+ * which rcl cannot check.
+ * The sequence number is assigned by the middleware, so that it matches the
+ * one in the response, and each caller gets the number of its own request.
+ * Calling rcl_send_request at the same time as non-thread safe client
+ * functions is not allowed, e.g. calling rcl_send_request and
+ * rcl_client_fini concurrently is not allowed.
  * Before calling rcl_send_request the message can change and after calling
  * rcl_send_request the message can change, but it cannot be changed during the
  * send_request call.
@@ -205,6 +236,213 @@ rcl_ret_t
 rcl_send_request(const rcl_client_t * client, const void * ros_request, int64_t * sequence_number);
 
 
+/// Send a ROS request, and call a callback once its response is taken or it expires.
+/* The request is sent like with rcl_send_request(), and then kept in a table
+ * of pending requests of the client, keyed by its sequence number.
+ * When rcl_take_response() takes the response to a pending request, it
+ * removes the request and calls its callback with the response, before it
+ * returns.
+ * Requests with a timeout which are still pending after it has passed are
+ * completed with RCL_RET_TIMEOUT by rcl_client_expire_pending_requests(), and
+ * a response which arrives after that is returned by rcl_take_response()
+ * without calling any callback.
+ * Requests which are still pending during rcl_client_fini() are completed
+ * with RCL_RET_CLIENT_INVALID.
+ *
+ * The callback is called in the thread which takes the response, expires the
+ * request, or finalizes the client, and must not call any of these functions
+ * on the same client.
+ * A future can be completed from the callback, using user_data to point at it.
+ *
+ * The table is allocated once during rcl_client_init(), see the
+ * max_pending_requests option, so sending a request does not allocate heap
+ * memory in rcl.
+ * If the table is full, the request is not sent.
+ *
+ * This function has the same thread-safety as rcl_send_request().
+ * This function is not lock-free, the table of pending requests is briefly
+ * locked to reserve a slot before the request is sent, and to add the request
+ * after it was sent, but not while it is sent, so concurrent calls for the
+ * same client send concurrently, like rcl_send_request().
+ * A response which is taken before its request was added is not lost, see
+ * rcl_take_response().
+ *
+ * \param[in] client handle to the client which will make the request
+ * \param[in] ros_request type-erased pointer to the ROS request message
+ * \param[in] timeout_ns time after which the request expires, or 0 if it never does
+ * \param[in] callback the function to call once the request is completed
+ * \param[in] user_data the pointer which is passed to the callback
+ * \param[out] sequence_number the sequence number
+ * \return RCL_RET_OK if the request was sent successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *           max_pending_requests is 0, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_CLIENT_PENDING_REQUESTS_FULL if max_pending_requests
+ *           requests are already pending, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_send_request_async(
+  const rcl_client_t * client,
+  const void * ros_request,
+  uint64_t timeout_ns,
+  rcl_client_response_callback_t callback,
+  const void * user_data,
+  int64_t * sequence_number);
+
+/// Send up to count ROS requests using a client.
+/* This is equivalent to calling rcl_send_request() for each request until it
+ * fails, except that the arguments and the client are only validated once,
+ * and the sent requests are counted once for the whole batch.
+ *
+ * The middleware does not currently provide a batch send function, so the
+ * requests are sent with the middleware's send function one at a time.
+ *
+ * The sequence number of each sent request is written to the same index of
+ * the sequence_numbers array.
+ * The number of requests which were sent is returned through the sent_count
+ * argument, which is also set if an error occurs after some of the requests
+ * were sent.
+ * Passing a count of 0 is allowed and sends nothing.
+ *
+ * This function has the same thread-safety as rcl_send_request().
+ *
+ * \param[in] client handle to the client which will make the requests
+ * \param[in] ros_requests array of count type-erased pointers to ROS request messages
+ * \param[in] count number of requests in the ros_requests array
+ * \param[out] sequence_numbers array of count sequence numbers
+ * \param[out] sent_count number of requests which were sent
+ * \return RCL_RET_OK if all requests were sent, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_send_request_batch(
+  const rcl_client_t * client,
+  const void * const * ros_requests,
+  size_t count,
+  int64_t * sequence_numbers,
+  size_t * sent_count);
+
+/// Send up to count ROS requests like rcl_send_request_async(), as long as they fit in the window.
+/* This is the batched entry point of a pipelined client, which keeps many
+ * requests in flight instead of waiting for each response before sending the
+ * next request.
+ * The window is the max_pending_requests option: requests are sent until
+ * that many are pending, and the rest of the batch is left unsent, to be sent
+ * once responses were taken, e.g. with rcl_take_response_batch(), or requests
+ * expired.
+ * The steady clock is read only once for the whole batch, while the table of
+ * pending requests is locked for each request like with
+ * rcl_send_request_async(), and never while a request is sent, so concurrent
+ * senders and takers of the client are not held up for the whole batch.
+ *
+ * All requests of the batch share the timeout, callback and user_data, and
+ * the callback can tell them apart by their sequence numbers, which are
+ * written to the same index of the sequence_numbers array.
+ * The number of requests which were sent is returned through the sent_count
+ * argument, which is also set if an error occurs after some of the requests
+ * were sent.
+ * Passing a count of 0 is allowed and sends nothing.
+ *
+ * This function does not allocate heap memory.
+ * This function has the same thread-safety as rcl_send_request_async().
+ *
+ * \param[in] client handle to the client which will make the requests
+ * \param[in] ros_requests array of count type-erased pointers to ROS request messages
+ * \param[in] count number of requests in the ros_requests array
+ * \param[in] timeout_ns time after which each request expires, or 0 if they never do
+ * \param[in] callback the function to call once each request is completed
+ * \param[in] user_data the pointer which is passed to the callback
+ * \param[out] sequence_numbers array of count sequence numbers
+ * \param[out] sent_count number of requests which were sent
+ * \return RCL_RET_OK if at least one request was sent, or count is 0, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *           max_pending_requests is 0, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_CLIENT_PENDING_REQUESTS_FULL if the window is full, so no
+ *           request was sent, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_send_request_batch_async(
+  const rcl_client_t * client,
+  const void * const * ros_requests,
+  size_t count,
+  uint64_t timeout_ns,
+  rcl_client_response_callback_t callback,
+  const void * user_data,
+  int64_t * sequence_numbers,
+  size_t * sent_count);
+
+/// Complete the pending requests whose timeout has passed.
+/* The callback of each expired request is called with RCL_RET_TIMEOUT, in
+ * the order in which they expired.
+ * The time until the next pending request expires is returned through
+ * next_timeout_ns, which can be passed to rcl_wait(), or -1 if no pending
+ * request has a timeout.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe with the other functions of the client,
+ * except for rcl_client_fini().
+ * This function is not lock-free, it briefly locks the table of pending
+ * requests, but not while calling the callbacks.
+ *
+ * \param[in] client handle to the client
+ * \param[out] next_timeout_ns time until the next request expires, or NULL
+ * \return RCL_RET_OK if the expired requests were completed, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *           max_pending_requests is 0, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_ERROR if the steady clock could not be read.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_client_expire_pending_requests(const rcl_client_t * client, int64_t * next_timeout_ns);
+
+/// Get the number of requests which were sent successfully by the client.
+/* Requests sent with rcl_send_request() and rcl_send_request_async() are
+ * counted.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] client handle to the client
+ * \param[out] count the number of sent requests
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_client_get_sent_request_count(const rcl_client_t * client, uint64_t * count);
+
+/// Get the number of requests sent with rcl_send_request_async() which are still pending.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it briefly locks the table of pending requests.
+ *
+ * \param[in] client handle to the client
+ * \param[out] count the number of pending requests
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_client_get_pending_request_count(const rcl_client_t * client, size_t * count);
+
 // Take a ROS response using a client
 /* It is the job of the caller to ensure that the type of the ros_response
  * parameter and the type associate with the client (via the type support)
@@ -216,12 +454,22 @@ rcl_send_request(const rcl_client_t * client, const void * ros_request, int64_t
  * ros_response should point to an already allocated ROS response message struct of the
  * correct type, into which the response from the service will be copied.
  *
+ * If the response is to a request which is pending, see
+ * rcl_send_request_async(), the request is completed and its callback is
+ * called with the response before this function returns.
+ * Since requests are sent before they are added to the table of pending
+ * requests, a response which matches no pending request while other threads
+ * are sending asynchronous requests of the client waits, yielding the thread,
+ * until the requests which were being sent when it was taken were added.
+ *
  * \param[in] client handle to the client which will take the response
  * \param[inout] request_header pointer to the request header
  * \param[inout] ros_response type-erased pointer to the ROS response message
  * \return RCL_RET_OK if the response was taken successfully, or
  *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
  *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_CLIENT_TAKE_FAILED if no response was available, in which
+ *           case no error message is set, or
  *         RCL_RET_ERROR if an unspecified error occurs.
  */
 RCL_PUBLIC
@@ -232,6 +480,49 @@ rcl_take_response(
   rmw_request_id_t * request_header,
   void * ros_response);
 
+/// Take up to capacity ROS responses using a client.
+/* This is equivalent to calling rcl_take_response() until it fails or
+ * capacity responses were taken, except that the arguments and the client
+ * are only validated once for the whole batch.
+ * This lets a pipelined client drain the responses to many requests after a
+ * single wait.
+ *
+ * The middleware does not currently provide a batch take function, so the
+ * responses are taken from the middleware's take function one at a time.
+ *
+ * Each element of the ros_responses array must point to an already allocated
+ * ROS response message of the client's type, and must not be NULL.
+ * Responses are taken in order, so the first taken_count elements of the
+ * request_headers and ros_responses arrays are filled and the rest are
+ * unmodified.
+ * The callback of each response to a pending request is called before this
+ * function returns, like with rcl_take_response().
+ * Passing a capacity of 0 is allowed and takes nothing.
+ *
+ * This function has the same thread-safety as rcl_take_response().
+ *
+ * \param[in] client handle to the client which will take the responses
+ * \param[out] request_headers array of capacity request headers
+ * \param[inout] ros_responses array of type-erased pointers to allocated ROS response messages
+ * \param[in] capacity number of responses in the ros_responses array
+ * \param[out] taken_count number of responses which were taken
+ * \return RCL_RET_OK if at least one response was taken, or capacity is 0, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_CLIENT_INVALID if the client is invalid, or
+ *         RCL_RET_CLIENT_TAKE_FAILED if no response was available, in which
+ *           case no error message is set, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_response_batch(
+  const rcl_client_t * client,
+  rmw_request_id_t * request_headers,
+  void * const * ros_responses,
+  size_t capacity,
+  size_t * taken_count);
+
 /// Get the name of the service that this client will request a response from.
 /* This function returns the client's internal service name string.
  * This function can fail, and therefore return NULL, if the:
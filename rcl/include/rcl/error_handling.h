@@ -15,24 +15,75 @@
 #ifndef RCL__ERROR_HANDLING_H_
 #define RCL__ERROR_HANDLING_H_
 
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "rmw/error_handling.h"
 
-/* The error handling in RCL is just an alias to the error handling in RMW. */
+#include "rcl/visibility_control.h"
+
+/* The error handling in RCL is built on the error handling in RMW.
+ *
+ * Setting an error message in RMW copies it, which allocates memory.
+ * Error messages which are string literals can instead be recorded with
+ * RCL_SET_ERROR_MSG_LITERAL(), which only stores a pointer to the literal
+ * and the file and line in thread-local storage.
+ * The message is handed to RMW, and so formatted and copied, only when the
+ * error is read with rcl_get_error_state(), rcl_get_error_string() or
+ * rcl_get_error_string_safe(), which means setting such an error never
+ * allocates memory.
+ * In either case the error which was set last through rcl is the one which
+ * is reported.
+ */
 
 typedef rmw_error_state_t rcl_error_state_t;
 
-#define rcl_set_error_state rmw_set_error_state
+/// Set the error message, copying it, as well as the file and line on which it occurred.
+RCL_PUBLIC
+void
+rcl_set_error_state(const char * error_msg, const char * file, size_t line_number);
+
+/// Set the error message without copying it, see RCL_SET_ERROR_MSG_LITERAL().
+/* The error_msg and file must have static storage duration.
+ * This function does not allocate heap memory.
+ */
+RCL_PUBLIC
+void
+rcl_set_error_state_literal(const char * error_msg, const char * file, size_t line_number);
+
+#define RCL_SET_ERROR_MSG(msg) rcl_set_error_state(msg, __FILE__, __LINE__)
+
+/// Set an error message which is a string literal, without allocating memory.
+/* Passing anything but a string literal fails to compile. */
+#define RCL_SET_ERROR_MSG_LITERAL(msg) rcl_set_error_state_literal("" msg, __FILE__, __LINE__)
 
-#define RCL_SET_ERROR_MSG(msg) RMW_SET_ERROR_MSG(msg)
+RCL_PUBLIC
+bool
+rcl_error_is_set(void);
 
-#define rcl_error_is_set rmw_error_is_set
+RCL_PUBLIC
+const rcl_error_state_t *
+rcl_get_error_state(void);
 
-#define rcl_get_error_state rmw_get_error_state
+RCL_PUBLIC
+const char *
+rcl_get_error_string(void);
 
-#define rcl_get_error_string rmw_get_error_string
+RCL_PUBLIC
+const char *
+rcl_get_error_string_safe(void);
 
-#define rcl_get_error_string_safe rmw_get_error_string_safe
+RCL_PUBLIC
+void
+rcl_reset_error(void);
 
-#define rcl_reset_error rmw_reset_error
+#if __cplusplus
+}
+#endif
 
 #endif  // RCL__ERROR_HANDLING_H_
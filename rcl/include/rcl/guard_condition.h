@@ -121,7 +121,9 @@ rcl_guard_condition_get_default_options(void);
  * This function does not allocate heap memory, but can on errors.
  * This function is thread-safe with itself, but cannot be called concurrently
  * with rcl_guard_condition_fini() on the same guard condition.
- * This function is lock-free, but the underlying system calls may not be.
+ * This function is lock-free, but the underlying system calls may not be, and
+ * it spins briefly while the on trigger callback is being set, see
+ * rcl_guard_condition_set_on_trigger_callback().
  *
  * \param[in] guard_condition handle to the guard_condition to be triggered
  * \return RCL_RET_OK if the guard condition was triggered, or
@@ -133,6 +135,41 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_trigger_guard_condition(const rcl_guard_condition_t * guard_condition);
 
+/// Set a callback which is called each time the guard condition is triggered.
+/* The callback is called by rcl_trigger_guard_condition(), in the thread which
+ * triggers, with a number_of_events of 1.
+ * An executor can use it to keep its own queue of ready entities, instead of
+ * finding them with rcl_wait().
+ * Triggers which happened while no callback was set are counted, and passed to
+ * the callback as soon as it is set, so no trigger is missed.
+ * The count is reset each time rcl_wait() reports the guard condition as
+ * ready, since those triggers were already seen by the caller of rcl_wait().
+ * Passing NULL for callback removes the callback.
+ *
+ * The callback is called without holding any lock, so it may trigger the
+ * guard condition or set its callback.
+ * A trigger which happens concurrently with this function may still call the
+ * previous callback after this function returned, so user_data must stay
+ * valid until the triggering threads are done.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe with rcl_trigger_guard_condition().
+ * This function is not lock-free, it spins briefly while the guard condition is triggered.
+ *
+ * \param[in] guard_condition handle to the guard condition
+ * \param[in] callback the function to call on each trigger, or NULL
+ * \param[in] user_data the pointer which is passed to the callback
+ * \return RCL_RET_OK if the callback was set, or
+ *         RCL_RET_INVALID_ARGUMENT if any arugments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_guard_condition_set_on_trigger_callback(
+  const rcl_guard_condition_t * guard_condition,
+  rcl_event_callback_t callback,
+  const void * user_data);
+
 /// Return the rmw guard condition handle.
 /* The handle returned is a pointer to the internally held rmw handle.
  * This function can fail, and therefore return NULL, if the:
@@ -26,6 +26,12 @@ extern "C"
 # define RCL_WARN_UNUSED _Check_return_
 #endif
 
+#ifndef _WIN32
+# define RCL_THREAD_LOCAL __thread
+#else
+# define RCL_THREAD_LOCAL __declspec(thread)
+#endif
+
 #if __cplusplus
 }
 #endif
@@ -0,0 +1,117 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__MESSAGE_CACHE_H_
+#define RCL__MESSAGE_CACHE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rcl/macros.h"
+#include "rcl/subscription.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+/// Which cached message rcl_message_cache_lookup() returns for a given time.
+typedef enum rcl_message_cache_match_t
+{
+  /// The message received closest to the time, the earlier one on a tie.
+  RCL_MESSAGE_CACHE_NEAREST,
+  /// The latest message received at or before the time.
+  RCL_MESSAGE_CACHE_BEFORE,
+  /// The earliest message received at or after the time.
+  RCL_MESSAGE_CACHE_AFTER,
+} rcl_message_cache_match_t;
+
+/* A subscription created with a non-zero cache_depth option keeps a copy of
+ * the last cache_depth messages it took, together with the steady time at
+ * which each of them was taken, see rcl_subscription_options_t.
+ * The cache is filled by rcl_take(), rcl_take_batch() and
+ * rcl_take_loaned_message(), and looked up with the functions below, which
+ * search by receive time in O(log N) for N cached messages.
+ *
+ * Cached messages are read-only, and a pointer to one is valid until the
+ * next message is taken from the subscription, which may overwrite it.
+ * The cache functions are not thread-safe with each other or with the take
+ * functions for the same subscription.
+ */
+
+/// Find the cached message which matches the given steady time.
+/* This function does not allocate heap memory.
+ *
+ * \param[in] subscription the subscription with the cache
+ * \param[in] time the steady time to look for, e.g. from rcl_steady_time_now()
+ * \param[in] match which message to return relative to the time
+ * \param[out] ros_message set to the type-erased pointer to the cached message
+ * \param[out] receive_time set to the time the message was taken, or NULL
+ * \return RCL_RET_OK if a message was found, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the
+ *           subscription has no cache, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_SUBSCRIPTION_CACHE_MISS if no cached message matches, in
+ *           which case no error message is set.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_cache_lookup(
+  const rcl_subscription_t * subscription,
+  rcl_time_point_value_t time,
+  rcl_message_cache_match_t match,
+  const void ** ros_message,
+  rcl_time_point_value_t * receive_time);
+
+/// Get the cached messages received between start and end, inclusive, oldest first.
+/* Up to capacity message pointers are written to ros_messages, and count is
+ * set to the number of cached messages in the range, which may be larger
+ * than capacity.
+ * Passing a capacity of 0 and NULL for the arrays can be used to query the
+ * number of messages in the range.
+ *
+ * This function does not allocate heap memory.
+ *
+ * \param[in] subscription the subscription with the cache
+ * \param[in] start the earliest receive time to include
+ * \param[in] end the latest receive time to include
+ * \param[out] ros_messages array of at least capacity message pointers, or NULL
+ * \param[out] receive_times array of at least capacity receive times, or NULL
+ * \param[in] capacity the number of elements which fit into the arrays
+ * \param[out] count the number of cached messages in the range
+ * \return RCL_RET_OK if the range was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the
+ *           subscription has no cache, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_message_cache_get_range(
+  const rcl_subscription_t * subscription,
+  rcl_time_point_value_t start,
+  rcl_time_point_value_t end,
+  const void ** ros_messages,
+  rcl_time_point_value_t * receive_times,
+  size_t capacity,
+  size_t * count);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__MESSAGE_CACHE_H_
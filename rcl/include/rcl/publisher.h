@@ -22,8 +22,11 @@ extern "C"
 
 #include "rosidl_generator_c/message_type_support.h"
 
+#include "rcl/guard_condition.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
+#include "rcl/serialized_message.h"
+#include "rcl/statistics.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl publisher implementation struct.
@@ -35,6 +38,59 @@ typedef struct rcl_publisher_t
   struct rcl_publisher_impl_t * impl;
 } rcl_publisher_t;
 
+/// Function which writes bytes identifying a message into key, e.g. its serialized form.
+/* Messages with equal keys are considered unchanged by change-only publishing.
+ * The key is empty when the function is called, and it can be grown with
+ * rcl_serialized_message_reserve(), after which buffer_length must be set.
+ */
+typedef rcl_ret_t (* rcl_publisher_message_key_function_t)(
+  const void * ros_message,
+  rcl_serialized_message_t * key);
+
+/// What an asynchronous publisher does when its queue is full.
+typedef enum rcl_publisher_overflow_policy_t
+{
+  /// Discard the oldest queued message to make room for the new one.
+  RCL_PUBLISHER_OVERFLOW_DROP_OLDEST,
+  /// Discard the new message.
+  RCL_PUBLISHER_OVERFLOW_DROP_NEWEST,
+  /// Wait in rcl_publish(), yielding the thread, until a queued message has been published.
+  /* The queue must be flushed by another thread, a thread which flushes the
+   * queue itself and then blocks in rcl_publish() never returns.
+   */
+  RCL_PUBLISHER_OVERFLOW_BLOCK,
+} rcl_publisher_overflow_policy_t;
+
+/// How a publisher limits the rate at which messages are published.
+typedef enum rcl_publisher_throttle_mode_t
+{
+  /// Publish every message.
+  RCL_PUBLISHER_THROTTLE_NONE,
+  /// Publish at most one message per throttle_period_ns.
+  RCL_PUBLISHER_THROTTLE_MAX_RATE,
+  /// Publish only the first of every throttle_keep_every_nth messages.
+  RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH,
+  /// Publish one message per throttle_period_ns on average, with bursts of up to throttle_burst.
+  RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET,
+} rcl_publisher_throttle_mode_t;
+
+/// Counters of an asynchronous publisher, see rcl_publisher_get_async_counters().
+typedef struct rcl_publisher_async_counters_t
+{
+  /// Number of messages added to the queue.
+  uint64_t enqueued;
+  /// Number of queued messages which were published to the middleware.
+  uint64_t published;
+  /// Number of queued messages which the middleware failed to publish.
+  uint64_t publish_errors;
+  /// Number of queued messages discarded by RCL_PUBLISHER_OVERFLOW_DROP_OLDEST.
+  uint64_t dropped_oldest;
+  /// Number of new messages discarded by RCL_PUBLISHER_OVERFLOW_DROP_NEWEST.
+  uint64_t dropped_newest;
+  /// Number of calls to rcl_publish() which had to wait, with RCL_PUBLISHER_OVERFLOW_BLOCK.
+  uint64_t blocked;
+} rcl_publisher_async_counters_t;
+
 /// Options available for a rcl publisher.
 typedef struct rcl_publisher_options_t
 {
@@ -43,6 +99,72 @@ typedef struct rcl_publisher_options_t
   /// Custom allocator for the publisher, used for incidental allocations.
   /* For default behavior (malloc/free), use: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
+  /// Number of messages which can be lent out at once by rcl_borrow_loaned_message().
+  /* The storage for these messages is allocated with the allocator during
+   * rcl_publisher_init().
+   * Loaned messages are sent to the middleware by a second middleware
+   * publisher on the same topic, which lets subscriptions in this process
+   * recognize them, see rcl_publish_loaned_message().
+   * The default is 0, which means loaned messages are disabled.
+   */
+  size_t loaned_message_pool_size;
+  /// Size in bytes of one loaned message, i.e. sizeof the C message struct.
+  /* Must be greater than 0 if loaned_message_pool_size is greater than 0. */
+  size_t loaned_message_size;
+  /// If true, rcl_publish() only queues the message, see rcl_publisher_flush_async_queue().
+  /* The queue holds qos.depth messages, so the depth must be greater than 0.
+   * rcl_publish_batch() queues as well, but loaned messages are always
+   * published right away by rcl_publish_loaned_message().
+   * The default is false.
+   */
+  bool asynchronous;
+  /// Size in bytes of one queued message, i.e. sizeof the C message struct.
+  /* Must be greater than 0 if asynchronous is true. */
+  size_t async_message_size;
+  /// Function which copies a message into the asynchronous queue, or NULL for a shallow copy.
+  /* See rcl_message_copy_function_t for when a shallow copy is enough.
+   * The copy is made into zero initialized storage which is allocated during
+   * rcl_publisher_init(), so it does not allocate unless the function does.
+   */
+  rcl_message_copy_function_t async_message_copy;
+  /// Function which finalizes a queued copy once it was published or discarded, or NULL.
+  /* Must be NULL unless async_message_copy is set. */
+  rcl_message_fini_function_t async_message_fini;
+  /// What rcl_publish() does when the queue of an asynchronous publisher is full.
+  rcl_publisher_overflow_policy_t async_overflow_policy;
+  /// How the rate of published messages is limited, see rcl_publish().
+  /* The default is RCL_PUBLISHER_THROTTLE_NONE. */
+  rcl_publisher_throttle_mode_t throttle_mode;
+  /// Minimum time between messages, or the time to earn one token, in nanoseconds.
+  /* Must be greater than 0 for RCL_PUBLISHER_THROTTLE_MAX_RATE and
+   * RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET.
+   */
+  uint64_t throttle_period_ns;
+  /// Decimation factor for RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH, must be greater than 0.
+  uint64_t throttle_keep_every_nth;
+  /// Number of tokens for RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET, must be greater than 0.
+  uint64_t throttle_burst;
+  /// If true, statistics are collected for each publish call, see rcl_publisher_get_statistics().
+  /* Collecting statistics costs two reads of the steady clock and a few
+   * atomic increments per publish call.
+   * The default is false.
+   */
+  bool enable_statistics;
+  /// If true, messages which equal the last published message are not published again.
+  /* Messages are compared by a hash of their change_only_message_key, see
+   * rcl_publish().
+   * The default is false.
+   */
+  bool publish_changes_only;
+  /// Function which writes the key of a message.
+  /* Must be set if publish_changes_only is true.
+   * The bytes of the C message struct cannot serve as the key, since a string
+   * or sequence can keep its pointer and size while its contents change.
+   */
+  rcl_publisher_message_key_function_t change_only_message_key;
+  /// Time after which an unchanged message is published anyway, in nanoseconds.
+  /* The default is 0, which means unchanged messages are never republished. */
+  uint64_t change_only_heartbeat_ns;
 } rcl_publisher_options_t;
 
 /// Return a rcl_publisher_t struct with members set to NULL.
@@ -92,6 +214,12 @@ rcl_get_zero_initialized_publisher(void);
  * The options struct allows the user to set the quality of service settings as
  * well as a custom allocator which is used when initializing/finalizing the
  * publisher to allocate space for incidentals, e.g. the topic name string.
+ * The quality of service settings are passed on to the middleware, e.g. a best
+ * effort reliability or a shallow keep last depth can be used for high rate
+ * sensor data.
+ * A keep last history with a depth of 0 is considered invalid.
+ * If the asynchronous option is set, a queue of qos.depth messages is also
+ * allocated, see rcl_publish().
  *
  * Expected usage (for C messages):
  *
@@ -144,6 +272,15 @@ rcl_publisher_init(
  * After calling, calls to rcl_publish will fail when using this publisher.
  * However, the given node handle is still valid.
  *
+ * Messages which are still in the queue of an asynchronous publisher are
+ * discarded, so rcl_publisher_flush_async_queue() should be called first.
+ *
+ * Messages of this publisher which are still queued or held by intra-process
+ * subscriptions stay valid, and the storage of the loaned messages is freed
+ * once the last of them is returned.
+ * Loaned messages which are still borrowed by the caller must be published or
+ * returned before calling this function, otherwise their storage is leaked.
+ *
  * This function is not thread-safe.
  *
  * \param[inout] publisher handle to the publisher to be finalized
@@ -187,6 +324,42 @@ rcl_publisher_get_default_options(void);
  * The ROS message given by the ros_message void pointer is always owned by the
  * calling code, but should remain constant during publish.
  *
+ * If the publisher was created with the asynchronous option, rcl_publish does
+ * not call the middleware, but copies the message into the publisher's queue
+ * and returns, see rcl_publisher_flush_async_queue().
+ * What happens when the queue is full depends on the async_overflow_policy
+ * option, and in each case RCL_RET_OK is returned.
+ * Unless the async_message_copy option is set, the copy is a shallow one of
+ * async_message_size bytes, so any memory the message refers to, e.g. the
+ * data of a string or sequence, is not copied and must remain valid and
+ * unchanged until the message has been flushed.
+ * If the copy function fails, RCL_RET_ERROR is returned and the message is
+ * not queued.
+ * With RCL_PUBLISHER_OVERFLOW_BLOCK, a full queue makes rcl_publish() yield
+ * the thread until rcl_publisher_flush_async_queue() made room, so it must not
+ * be called by the thread which flushes the queue.
+ * Asynchronous publishing does not allocate heap memory, unless the copy
+ * function does or the guard condition of the queue has to be triggered and
+ * that fails.
+ *
+ * If the publisher was created with a throttle_mode, messages which exceed
+ * the configured rate are suppressed before they reach the middleware or the
+ * asynchronous queue, and RCL_RET_OK is returned for them as well.
+ * Suppressed messages are counted, see rcl_publisher_get_suppressed_count().
+ * Throttling does not allocate heap memory, is lock-free, and reads the
+ * steady clock at most once per call.
+ *
+ * If the publisher was created with the publish_changes_only option, a
+ * message is not published if the hash of its change_only_message_key equals
+ * the one of the last published message, unless change_only_heartbeat_ns
+ * have passed since then, and RCL_RET_OK is returned for it.
+ * The key is written into a buffer of the publisher, which is reallocated
+ * whenever a key outgrows it.
+ * No lock is held while the key function runs, a call which finds the buffer
+ * in use by a concurrent call allocates a temporary buffer instead.
+ * An error of the key function is returned and the message is not published.
+ * Unchanged messages are counted, see rcl_publisher_get_unchanged_count().
+ *
  * This function is thread safe so long as access to both the publisher and the
  * ros_message is synchronized.
  * That means that calling rcl_publish from multiple threads is allowed, but
@@ -212,6 +385,289 @@ RCL_WARN_UNUSED
 rcl_ret_t
 rcl_publish(const rcl_publisher_t * publisher, const void * ros_message);
 
+/// Publish the messages queued by an asynchronous publisher.
+/* Queued messages are published with the middleware in the order in which
+ * they were queued, until the queue is empty or max_messages have been
+ * published.
+ * Passing 0 for max_messages publishes until the queue is empty.
+ *
+ * rcl does not start a thread for this, instead this function is meant to be
+ * called from a sender thread owned by the application, which waits on the
+ * guard condition returned by rcl_publisher_get_async_guard_condition().
+ * The guard condition is triggered when a message is queued while the queue
+ * was empty, so after waking up the queue should be flushed until it is empty.
+ *
+ * A message which fails to be published is counted and skipped, and the error
+ * of the last failure is returned after the remaining messages are published.
+ * The number of messages which were taken from the queue is stored in
+ * flushed_count, including any which failed.
+ * If the publisher has an async_message_fini function, each message is
+ * finalized with it once it was handed to the middleware.
+ *
+ * This function does not allocate heap memory, but the middleware may.
+ * This function is thread-safe with rcl_publish(), but must not be called
+ * concurrently with itself for the same publisher.
+ *
+ * \param[in] publisher handle to the asynchronous publisher
+ * \param[in] max_messages the maximum number of messages to publish, or 0
+ * \param[out] flushed_count the number of messages taken from the queue
+ * \return RCL_RET_OK if all flushed messages were published successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the
+ *           publisher is not asynchronous, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid, or
+ *         RCL_RET_ERROR if publishing a message failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_flush_async_queue(
+  const rcl_publisher_t * publisher,
+  size_t max_messages,
+  size_t * flushed_count);
+
+/// Get the number of messages which were not published because they were unchanged.
+/* See the publish_changes_only option of rcl_publisher_options_t.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the publisher
+ * \param[out] unchanged_count the number of unchanged messages
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_get_unchanged_count(
+  const rcl_publisher_t * publisher,
+  uint64_t * unchanged_count);
+
+/// Get the number of messages which were suppressed by the throttle_mode of a publisher.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the publisher
+ * \param[out] suppressed_count the number of suppressed messages
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_get_suppressed_count(
+  const rcl_publisher_t * publisher,
+  uint64_t * suppressed_count);
+
+/// Get a snapshot of the statistics of a publisher.
+/* The statistics are collected by rcl_publish(), rcl_publish_batch() and
+ * rcl_publish_loaned_message(), if the publisher was created with the
+ * enable_statistics option.
+ * The latency is the duration of the publish call, so for an asynchronous
+ * publisher it is the time it took to queue the message.
+ * A call to rcl_publish_batch() counts as a single call in the latency
+ * histogram, but each of its messages is counted.
+ * The statistics of all publishers of a node can be read with
+ * rcl_node_get_publisher_statistics().
+ *
+ * Each counter is read atomically, but the counters are not read together,
+ * so a snapshot taken while publishing may be slightly inconsistent.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the publisher
+ * \param[out] statistics the statistics of the publisher
+ * \return RCL_RET_OK if the statistics were read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or
+ *           statistics are not enabled for the publisher, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_get_statistics(
+  const rcl_publisher_t * publisher,
+  rcl_publisher_statistics_t * statistics);
+
+/// Return the guard condition which is triggered when an asynchronous publisher has work.
+/* This function can fail, and therefore return NULL, if the:
+ *   - publisher is NULL
+ *   - publisher is invalid (never called init, called fini, or invalid)
+ *   - publisher is not asynchronous
+ *
+ * The returned guard condition is only valid as long as the publisher is valid.
+ *
+ * \param[in] publisher pointer to the publisher
+ * \return guard condition if successful, otherwise NULL
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+const rcl_guard_condition_t *
+rcl_publisher_get_async_guard_condition(const rcl_publisher_t * publisher);
+
+/// Get a snapshot of the counters of an asynchronous publisher.
+/* Each counter is read atomically, but the counters are not read together,
+ * so a snapshot taken while publishing may be slightly inconsistent.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the asynchronous publisher
+ * \param[out] counters the counters of the publisher
+ * \return RCL_RET_OK if the counters were read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the
+ *           publisher is not asynchronous, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publisher_get_async_counters(
+  const rcl_publisher_t * publisher,
+  rcl_publisher_async_counters_t * counters);
+
+/// Publish several ROS messages on a topic using a publisher.
+/* This is equivalent to calling rcl_publish() once for each of the given
+ * messages, in order, except that the arguments and the publisher are only
+ * validated once for the whole batch.
+ * This is meant for publishers which send bursts of many small messages.
+ *
+ * The middleware does not currently provide a batch publish function, so the
+ * messages are handed to the middleware's publish function one at a time.
+ *
+ * The same rules apply to each message as in rcl_publish(), i.e. all of the
+ * messages must be of the publisher's type and they must remain constant
+ * during the call.
+ * Elements of the messages array must not be NULL.
+ *
+ * Publishing stops at the first message which fails to be published.
+ * The number of messages which were published before that is returned through
+ * the published_count argument, which is also set on success.
+ * Messages suppressed by the publisher's throttle_mode or skipped because they
+ * were unchanged are not counted, but they do not stop publishing either.
+ * Passing a count of 0 is allowed and publishes nothing.
+ *
+ * This function has the same thread-safety as rcl_publish().
+ *
+ * \param[in] publisher handle to the publisher which will do the publishing
+ * \param[in] ros_messages array of type-erased pointers to the ROS messages
+ * \param[in] count number of messages in the ros_messages array
+ * \param[out] published_count number of messages which were published
+ * \return RCL_RET_OK if all of the messages were published successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publish_batch(
+  const rcl_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published_count);
+
+/// Borrow a message, owned by the publisher, to be filled and published.
+/* The returned message can be filled in place and then given back using
+ * rcl_publish_loaned_message(), or if it is not needed after all, using
+ * rcl_return_loaned_message().
+ * This avoids the need for the user to allocate a new message for each
+ * publish, e.g. for large camera frames.
+ *
+ * The middleware does not currently lend out its own buffers, so the
+ * messages come from a pool which is owned by the publisher and which is
+ * allocated during rcl_publisher_init() using the publisher's allocator.
+ * The size of the pool is set with the loaned_message_pool_size and
+ * loaned_message_size fields of the publisher options.
+ *
+ * The message is zero initialized the first time it is lent out, after that
+ * it keeps the contents from the last time it was used.
+ * rcl does not initialize or finalize the message, so any memory which the
+ * message refers to, e.g. the data of a sequence, is owned by the caller and
+ * must remain valid until the message is published or returned.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the publisher which lends the message
+ * \param[out] ros_message set to the type-erased pointer to the loaned message
+ * \return RCL_RET_OK if a message was borrowed successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid, or
+ *         RCL_RET_PUBLISHER_LOAN_FAILED if loaned messages are disabled or
+ *           all of them are in use.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_borrow_loaned_message(const rcl_publisher_t * publisher, void ** ros_message);
+
+/// Publish a loaned message and give it back to the publisher.
+/* This behaves like rcl_publish(), but the ros_message must have been
+ * borrowed from the same publisher with rcl_borrow_loaned_message().
+ * The message is given back to the publisher even if publishing fails, and
+ * must not be used by the caller after this function returns, unless the
+ * return code is RCL_RET_INVALID_ARGUMENT or RCL_RET_PUBLISHER_INVALID.
+ *
+ * Before the message is published to the middleware, a reference to it is
+ * handed directly to each subscription in this process which has the same
+ * topic name and type support and has intra-process delivery enabled, see the
+ * intra_process_depth field of rcl_subscription_options_t.
+ * Those subscriptions can take the message without it being copied or going
+ * through the middleware, and the message only goes back to the publisher's
+ * pool once every subscription has returned it.
+ * Each of them also gets the time of publishing and a sequence number, which
+ * counts the loaned messages of this publisher, see rcl_message_info_t.
+ * The message is also published to the middleware, with the gid of a
+ * middleware publisher used only for loaned messages.
+ * Subscriptions with intra-process delivery enabled skip the messages with
+ * that gid when taking from the middleware, so they do not receive the
+ * message twice, while subscriptions in other processes receive it as usual.
+ * A message dropped because the intra-process queue of a subscription was
+ * full is therefore not taken from the middleware instead.
+ * Messages published with rcl_publish() are only delivered by the middleware.
+ *
+ * This function has the same thread-safety as rcl_publish().
+ *
+ * \param[in] publisher handle to the publisher which lent the message
+ * \param[in] ros_message type-erased pointer to the loaned message
+ * \return RCL_RET_OK if the message was published successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_publish_loaned_message(const rcl_publisher_t * publisher, void * ros_message);
+
+/// Give a loaned message back to the publisher without publishing it.
+/* The message must have been borrowed from the same publisher with
+ * rcl_borrow_loaned_message() and must not be used after this call.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] publisher handle to the publisher which lent the message
+ * \param[in] ros_message type-erased pointer to the loaned message
+ * \return RCL_RET_OK if the message was given back successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_PUBLISHER_INVALID if the publisher is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_loaned_message(const rcl_publisher_t * publisher, void * ros_message);
+
 /// Get the topic name for the publisher.
 /* This function returns the publisher's internal topic name string.
  * This function can fail, and therefore return NULL, if the:
@@ -21,8 +21,10 @@ extern "C"
 #endif
 
 #include "rcl/macros.h"
+#include "rcl/message_cache.h"
 #include "rcl/node.h"
 #include "rcl/publisher.h"
+#include "rcl/statistics.h"
 #include "rcl/subscription.h"
 #include "rcl/types.h"
 #include "rcl/wait.h"
@@ -0,0 +1,124 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__SERIALIZED_MESSAGE_H_
+#define RCL__SERIALIZED_MESSAGE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/allocator.h"
+#include "rcl/macros.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+/// A message in its serialized form, i.e. an opaque buffer of bytes.
+/* The buffer is owned by the struct and is allocated with its allocator.
+ * The buffer grows with rcl_serialized_message_reserve(), but it never
+ * shrinks on its own, so a single rcl_serialized_message_t can be reused for
+ * many messages without allocating each time.
+ *
+ * rcl cannot publish or take serialized messages yet, because the middleware
+ * has no functions for it, so the buffer is only used for keys, see the
+ * request_key option of services and the change_only_message_key option of
+ * publishers.
+ */
+typedef struct rcl_serialized_message_t
+{
+  /// The serialized bytes, or NULL if nothing has been allocated yet.
+  uint8_t * buffer;
+  /// Number of valid bytes in the buffer.
+  size_t buffer_length;
+  /// Number of bytes allocated for the buffer.
+  size_t buffer_capacity;
+  /// Allocator used to (re)allocate and deallocate the buffer.
+  rcl_allocator_t allocator;
+} rcl_serialized_message_t;
+
+/// Return a rcl_serialized_message_t struct with members set to NULL or 0.
+/* Should be called to get a null rcl_serialized_message_t before passing to
+ * rcl_serialized_message_init().
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_serialized_message_t
+rcl_get_zero_initialized_serialized_message(void);
+
+/// Initialize a serialized message, preallocating capacity bytes.
+/* The allocator must have all of its function pointers set, because the
+ * reallocate function is used to grow the buffer.
+ * A capacity of 0 is allowed, in which case nothing is allocated until the
+ * buffer is first needed.
+ *
+ * This function is not thread-safe.
+ *
+ * \param[inout] serialized_message zero initialized serialized message
+ * \param[in] capacity number of bytes to allocate up front
+ * \param[in] allocator allocator to be used for the buffer
+ * \return RCL_RET_OK if the message was initialized successfully, or
+ *         RCL_RET_ALREADY_INIT if the message is already initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_serialized_message_init(
+  rcl_serialized_message_t * serialized_message,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Make sure the buffer can hold at least capacity bytes.
+/* If the buffer is already large enough nothing is done, otherwise it is
+ * reallocated and the existing bytes are kept.
+ * On failure the existing buffer is left untouched.
+ *
+ * This function is not thread-safe.
+ *
+ * \param[inout] serialized_message initialized serialized message
+ * \param[in] capacity minimum number of bytes the buffer should hold
+ * \return RCL_RET_OK if the buffer is large enough, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_serialized_message_reserve(rcl_serialized_message_t * serialized_message, size_t capacity);
+
+/// Deallocate the buffer of a serialized message.
+/* After calling, the serialized message is zero initialized again.
+ * Calling this on a zero initialized serialized message is allowed.
+ *
+ * This function is not thread-safe.
+ *
+ * \param[inout] serialized_message serialized message to be finalized
+ * \return RCL_RET_OK if the message was finalized successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_serialized_message_fini(rcl_serialized_message_t * serialized_message);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__SERIALIZED_MESSAGE_H_
@@ -22,8 +22,12 @@ extern "C"
 
 #include "rosidl_generator_c/service_type_support.h"
 
+#include "rcl/guard_condition.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
+#include "rcl/serialized_message.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl implementation struct.
@@ -35,16 +39,89 @@ typedef struct rcl_service_t
   struct rcl_service_impl_t * impl;
 } rcl_service_t;
 
+/// Function which writes bytes identifying a request into key, e.g. its serialized form.
+/* Requests with equal keys must have equal responses.
+ * The key is empty when the function is called, and it can be grown with
+ * rcl_serialized_message_reserve(), after which buffer_length must be set.
+ */
+typedef rcl_ret_t (* rcl_service_request_key_function_t)(
+  const void * ros_request,
+  rcl_serialized_message_t * key);
+
 /// Options available for a rcl service.
 typedef struct rcl_service_options_t
 {
   /// Middleware quality of service settings for the service.
   rmw_qos_profile_t qos;
+  /// Number of requests which can be admitted at once, 0 disables the admission queue.
+  /* See rcl_service_admit_requests() for details. */
+  size_t request_queue_size;
+  /// Size in bytes of one request, i.e. sizeof the C request struct.
+  /* Must be greater than 0 if request_queue_size is greater than 0. */
+  size_t request_size;
+  /// Function which initializes each queued request once, or NULL to zero initialize them.
+  rcl_message_init_function_t request_init;
+  /// Function which finalizes each queued request during rcl_service_fini(), or NULL.
+  rcl_message_fini_function_t request_fini;
+  /// Number of requests taken with rcl_take_request() which can be in flight, 0 for no limit.
+  /* A request is in flight from rcl_take_request() until its response is sent
+   * with rcl_send_response().
+   * Requests which are taken while the limit is reached are dropped, see
+   * rcl_take_request(), so a request which will never be answered must be
+   * given up with rcl_service_abandon_request(), or it keeps counting.
+   * This is ignored if the admission queue is enabled, whose size already
+   * bounds the requests in flight.
+   */
+  size_t max_requests_in_flight;
+  /// Age at which admitted requests are dropped instead of processed, 0 for no limit.
+  /* The age of a request is the time since it was admitted by
+   * rcl_service_admit_requests(), see rcl_service_take_admitted_request().
+   * Requests taken with rcl_take_request() have no age, because the
+   * middleware does not tell when they were sent.
+   */
+  rcl_duration_value_t max_request_age_ns;
+  /// Total size in bytes of the cached responses, 0 disables the response cache.
+  /* The size of a cached response is the size of its entry, the response
+   * struct and its key.
+   * See rcl_service_cache_response() for details.
+   */
+  size_t response_cache_size;
+  /// Time after which a cached response is no longer sent, in nanoseconds, 0 for no limit.
+  rcl_duration_value_t response_cache_ttl_ns;
+  /// Size in bytes of one response, i.e. sizeof the C response struct.
+  /* Must be greater than 0 if response_cache_size is greater than 0. */
+  size_t response_size;
+  /// Function which writes the key of a request.
+  /* Must be set if response_cache_size is greater than 0.
+   * The bytes of the C request struct cannot serve as the key, since a
+   * string or sequence taken into a reused request can keep its pointer and
+   * size while its contents change, so different requests would share a key.
+   */
+  rcl_service_request_key_function_t request_key;
+  /// Function which copies a response into the cache, or NULL for a shallow copy.
+  /* See rcl_message_copy_function_t for when a shallow copy of the response
+   * passed to rcl_service_cache_response() is enough.
+   */
+  rcl_message_copy_function_t response_copy;
+  /// Function which finalizes a cached response when it is evicted, or NULL.
+  /* Must be NULL unless response_copy is set. */
+  rcl_message_fini_function_t response_fini;
   /// Custom allocator for the service, used for incidental allocations.
   /* For default behavior (malloc/free), see: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
 } rcl_service_options_t;
 
+/// A request which was admitted by rcl_service_admit_requests(), owned by the service.
+typedef struct rcl_service_request_t
+{
+  /// Header of the request, to be passed to rcl_send_response().
+  rmw_request_id_t request_header;
+  /// Type-erased pointer to the request message.
+  void * ros_request;
+  /// Steady time at which the request was admitted, or 0 if the clock could not be read.
+  rcl_time_point_value_t admitted_timestamp;
+} rcl_service_request_t;
+
 /// Return a rcl_service_t struct with members set to NULL.
 /* Should be called to get a null rcl_service_t before passing to
  * rcl_initalize_service().
@@ -94,6 +171,8 @@ rcl_get_zero_initialized_service(void);
  * The options struct allows the user to set the quality of service settings as
  * well as a custom allocator which is used when initializing/finalizing the
  * client to allocate space for incidentals, e.g. the service name string.
+ * The quality of service settings are passed on to the middleware.
+ * A keep last history with a depth of 0 is considered invalid.
  *
  * Expected usage (for C services):
  *
@@ -188,6 +267,10 @@ rcl_service_get_default_options(void);
  * request_header is a pointer to pre-allocated a rmw struct containing
  * meta-information about the request (e.g. the sequence number).
  *
+ * If the response cache is enabled, the key of each request is written into
+ * a buffer which the service keeps for this function, so it must not be
+ * called concurrently with itself for the same service.
+ *
  * \param[in] service the handle to the service from which to take
  * \param[inout] request_header ptr to the struct holding metadata about the request ID
  * \param[inout] ros_request type-erased ptr to an allocated ROS request message
@@ -195,6 +278,11 @@ rcl_service_get_default_options(void);
  *         RCL_RET_INVALID_ARGUMENT if any arugments are invalid, or
  *         RCL_RET_SERVICE_INVALID if the service is invalid, or
  *         RCL_RET_BAD_ALLOC if allocating memory failed, or
+ *         RCL_RET_SERVICE_TAKE_FAILED if no request was available, in which
+ *           case no error message is set, or
+ *         RCL_RET_SERVICE_REQUEST_SHED if the request was dropped because the
+ *           max_requests_in_flight option was reached, in which case no error
+ *           message is set and the ros_request may have been overwritten, or
  *         RCL_RET_ERROR if an unspecified error occurs.
  */
 RCL_PUBLIC
@@ -217,12 +305,14 @@ rcl_take_request(
  * The ROS response message given by the ros_response void pointer is always owned by the
  * calling code, but should remain constant during send_response.
  *
- e This function is thread safe so long as access to both the service and the
+ * This function is thread safe so long as access to both the service and the
  * ros_response is synchronized.
  * That means that calling rcl_send_response from multiple threads is allowed, but
  * calling rcl_send_response at the same time as non-thread safe service functions
  * is not, e.g. calling rcl_send_response and rcl_service_fini concurrently
  * is not allowed.
+ * Responses are matched to their requests by the request_header, so workers
+ * can send them in any order, see rcl_service_admit_requests().
  * Before calling rcl_send_response the message can change and after calling
  * rcl_send_response the message can change, but it cannot be changed during the
  * send_response call.
@@ -246,6 +336,227 @@ rcl_send_response(
   rmw_request_id_t * response_header,
   void * ros_response);
 
+/// Give up on a request taken with rcl_take_request() which will not be answered.
+/* The request no longer counts as in flight, see the max_requests_in_flight
+ * option, as if its response had been sent with rcl_send_response().
+ * It must be called at most once per taken request, and not for a request
+ * whose response is sent, otherwise another request in flight is no longer
+ * counted.
+ * Nothing is done if the service does not limit the requests in flight.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] service handle to the service which took the request
+ * \return RCL_RET_OK if the request was given up, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_abandon_request(const rcl_service_t * service);
+
+/// Take requests from the middleware into the admission queue of the service.
+/* This lets a pool of worker threads process the requests of one service
+ * concurrently, and send their responses out of order.
+ * rcl does not start any threads, instead the application owns them:
+ *   - a dispatching thread, e.g. the executor, calls this function when the
+ *     service is ready after rcl_wait()
+ *   - each worker calls rcl_service_take_admitted_request() to get the next
+ *     request, processes it, sends the response with rcl_send_response() and
+ *     the request_header of the admitted request, and then gives the request
+ *     back with rcl_service_release_admitted_request()
+ *   - idle workers can wait on the guard condition returned by
+ *     rcl_service_get_admission_guard_condition(), or set a callback on it
+ *     with rcl_guard_condition_set_on_trigger_callback() to wake them
+ *
+ * The queue holds request_queue_size requests, which are allocated and
+ * initialized with the request_init option during rcl_service_init(), and
+ * reused for every request after that, so admitting requests does not
+ * allocate heap memory in rcl.
+ * A request occupies its place in the queue until it is released, so the
+ * queue bounds the number of requests which are waiting or being processed.
+ * If the queue is full, no more requests are taken from the middleware and
+ * RCL_RET_SERVICE_QUEUE_FULL is returned, leaving the rest of the requests in
+ * the middleware, whose qos history decides whether they are kept.
+ * This is the back-pressure signal, the dispatcher should stop admitting
+ * requests until a worker releases one.
+ *
+ * This function must not be called concurrently with itself or with
+ * rcl_take_request() for the same service.
+ * This function is thread-safe with the worker functions.
+ *
+ * \param[in] service handle to the service
+ * \param[out] admitted_count number of requests which were admitted, or NULL
+ * \return RCL_RET_OK if all available requests were admitted, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or the
+ *           admission queue is not enabled, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid, or
+ *         RCL_RET_SERVICE_QUEUE_FULL if the queue is full, in which case no
+ *           error message is set, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_admit_requests(const rcl_service_t * service, size_t * admitted_count);
+
+/// Take the oldest admitted request, to be processed by the calling worker.
+/* The request is owned by the service, and must be given back with
+ * rcl_service_release_admitted_request() once its response was sent.
+ *
+ * If the max_request_age_ns option is set, requests which were admitted
+ * longer ago than that are dropped and released, without a response, until a
+ * request which is young enough is found, so that no work is done for
+ * requests whose clients probably gave up already.
+ * The number of dropped requests is counted, see
+ * rcl_service_get_shed_request_counts().
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] service handle to the service
+ * \param[out] request set to the admitted request
+ * \return RCL_RET_OK if a request was taken, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or the
+ *           admission queue is not enabled, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid, or
+ *         RCL_RET_SERVICE_TAKE_FAILED if no request was admitted, in which
+ *           case no error message is set.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_take_admitted_request(
+  const rcl_service_t * service,
+  rcl_service_request_t ** request);
+
+/// Give back a request taken with rcl_service_take_admitted_request().
+/* The request keeps its memory, so it can be reused by the next admitted
+ * request, and must not be used after this call.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] service handle to the service
+ * \param[in] request the request to give back
+ * \return RCL_RET_OK if the request was given back, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or the
+ *           request was not taken from this service, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_release_admitted_request(
+  const rcl_service_t * service,
+  rcl_service_request_t * request);
+
+/// Remember the response to a request, so identical requests are answered without user code.
+/* For services whose responses only depend on their requests, e.g. lookups
+ * of static data, the response cache answers repeated requests directly.
+ * Once a response was cached, rcl_take_request() and
+ * rcl_service_admit_requests() send it with rcl_send_response() to each
+ * request with the same key, see the request_key option, and take the next
+ * request instead of returning the answered one.
+ * Cached responses are sent for response_cache_ttl_ns after they were cached,
+ * and the least recently used responses are evicted once the cached responses
+ * would exceed response_cache_size bytes.
+ *
+ * This is called after sending the response to a request which was taken
+ * and not answered from the cache.
+ * If the request already has a cached response, e.g. because another worker
+ * answered the same request concurrently, the existing one is kept.
+ * A response which is larger than the whole cache is not cached.
+ *
+ * This function allocates heap memory for the cached response and its key.
+ * This function is thread-safe.
+ * This function is not lock-free, it briefly locks the cache, which is also
+ * locked while a cached response is looked up.
+ * Cached responses are sent after the lock is released, so sending them does
+ * not hold up this function.
+ *
+ * \param[in] service handle to the service
+ * \param[in] ros_request the request, as it was taken
+ * \param[in] ros_response the response which was sent for it
+ * \return RCL_RET_OK if the response was cached, or not cached as described above, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or the
+ *           response cache is not enabled, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_cache_response(
+  const rcl_service_t * service,
+  const void * ros_request,
+  const void * ros_response);
+
+/// Get the number of taken requests which were or were not answered from the response cache.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] service handle to the service
+ * \param[out] hit_count requests answered with a cached response, or NULL
+ * \param[out] miss_count requests without a cached response, or NULL
+ * \return RCL_RET_OK if the counts were read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_get_response_cache_counts(
+  const rcl_service_t * service,
+  uint64_t * hit_count,
+  uint64_t * miss_count);
+
+/// Get the number of requests which the service dropped instead of processing them.
+/* See the max_requests_in_flight and max_request_age_ns options.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] service handle to the service
+ * \param[out] overloaded_count requests dropped by rcl_take_request() because
+ *   too many were in flight, or NULL
+ * \param[out] expired_count admitted requests dropped because they were too old, or NULL
+ * \return RCL_RET_OK if the counts were read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SERVICE_INVALID if the service is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_service_get_shed_request_counts(
+  const rcl_service_t * service,
+  uint64_t * overloaded_count,
+  uint64_t * expired_count);
+
+/// Return the guard condition which is triggered each time a request is admitted.
+/* This function can fail, and therefore return NULL, if the:
+ *   - service is NULL
+ *   - service is invalid (never called init, called fini, or invalid)
+ *   - service does not have the admission queue enabled
+ *
+ * The returned guard condition is only valid as long as the service is valid.
+ *
+ * \param[in] service pointer to the service
+ * \return guard condition if successful, otherwise NULL
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+const rcl_guard_condition_t *
+rcl_service_get_admission_guard_condition(const rcl_service_t * service);
+
 /// Get the topic name for the service.
 /* This function returns the service's internal topic name string.
  * This function can fail, and therefore return NULL, if the:
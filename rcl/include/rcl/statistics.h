@@ -0,0 +1,131 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__STATISTICS_H_
+#define RCL__STATISTICS_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+
+#include "rcl/macros.h"
+#include "rcl/node.h"
+#include "rcl/types.h"
+#include "rcl/visibility_control.h"
+
+/// Number of buckets in a latency histogram.
+/* Bucket 0 counts calls which took less than 1 microsecond, and bucket i
+ * counts calls which took at least 2^(i-1) and less than 2^i microseconds.
+ * The last bucket also counts all calls which took longer than that.
+ * The histograms of subscriptions use the same buckets for their durations.
+ */
+#define RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE 20
+
+/// Snapshot of the statistics of a rcl publisher.
+typedef struct rcl_publisher_statistics_t
+{
+  /// Topic name of the publisher, only valid as long as the publisher is valid.
+  const char * topic_name;
+  /// Number of messages which were published successfully.
+  uint64_t message_count;
+  /// Number of messages which failed to be published.
+  uint64_t error_count;
+  /// Sum of the duration of all publish calls, in nanoseconds.
+  uint64_t total_latency_ns;
+  /// Number of publish calls by their duration, see RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE.
+  uint64_t latency_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+} rcl_publisher_statistics_t;
+
+/// Snapshot of the statistics of a rcl subscription.
+typedef struct rcl_subscription_statistics_t
+{
+  /// Topic name of the subscription, only valid as long as the subscription is valid.
+  const char * topic_name;
+  /// Number of messages which were taken.
+  uint64_t take_count;
+  /// Number of take calls which found no message.
+  uint64_t empty_take_count;
+  /// Number of messages inferred to be lost from gaps in their sequence numbers.
+  /* Only messages with a known sequence number are checked, i.e. those taken
+   * with rcl_take_loaned_message(), and only gaps between consecutive
+   * messages from the same publisher are counted.
+   */
+  uint64_t dropped_count;
+  /// Number of taken messages with a known source timestamp, which have an age.
+  uint64_t aged_count;
+  /// Sum of the age of those messages when they were taken, in nanoseconds.
+  uint64_t total_age_ns;
+  /// Number of aged messages by their age, see RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE.
+  uint64_t age_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+  /// Number of taken messages by the time since the previous one was taken.
+  /* A message which comes much later than usual shows a starved subscription,
+   * and many messages in the lowest buckets show one which is catching up.
+   */
+  uint64_t inter_arrival_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+} rcl_subscription_statistics_t;
+
+/// Get a snapshot of the statistics of each publisher of a node.
+/* Only publishers which were created with the enable_statistics option are
+ * included.
+ * Up to capacity snapshots are written to the statistics array, and count is
+ * set to the number of publishers with statistics, which may be larger than
+ * capacity.
+ * Passing a capacity of 0 and NULL for statistics can be used to query the
+ * number of publishers.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it briefly spins on the node's list of
+ * publishers, but never blocks rcl_publish().
+ *
+ * \param[in] node handle to the node
+ * \param[out] statistics array of at least capacity snapshots, or NULL if capacity is 0
+ * \param[in] capacity the number of snapshots which fit into the array
+ * \param[out] count the number of publishers of the node with statistics
+ * \return RCL_RET_OK if the snapshots were taken, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_NODE_INVALID if the node is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_node_get_publisher_statistics(
+  const rcl_node_t * node,
+  rcl_publisher_statistics_t * statistics,
+  size_t capacity,
+  size_t * count);
+
+/// Get a snapshot of the statistics of each subscription of a node.
+/* Only subscriptions which were created with the enable_statistics option
+ * are included.
+ * This works like rcl_node_get_publisher_statistics(), with the same
+ * arguments, return values, and thread-safety.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_node_get_subscription_statistics(
+  const rcl_node_t * node,
+  rcl_subscription_statistics_t * statistics,
+  size_t capacity,
+  size_t * count);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__STATISTICS_H_
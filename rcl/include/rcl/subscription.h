@@ -22,8 +22,12 @@ extern "C"
 
 #include "rosidl_generator_c/message_type_support.h"
 
+#include "rcl/guard_condition.h"
 #include "rcl/macros.h"
 #include "rcl/node.h"
+#include "rcl/serialized_message.h"
+#include "rcl/statistics.h"
+#include "rcl/time.h"
 #include "rcl/visibility_control.h"
 
 /// Internal rcl implementation struct.
@@ -35,6 +39,85 @@ typedef struct rcl_subscription_t
   struct rcl_subscription_impl_t * impl;
 } rcl_subscription_t;
 
+/// Meta-data of a taken message, including when it was sent and received.
+/* The timestamps are steady times, see rcl_steady_time_now(), so the
+ * difference between them is the latency of the message within one host.
+ */
+typedef struct rcl_message_info_t
+{
+  /// Meta-data provided by the middleware.
+  rmw_message_info_t rmw_message_info;
+  /// Time at which the message was published, or 0 if it is not known.
+  /* Only known for intra-process messages, the middleware does not pass the
+   * time of publishing along with a message, so it is 0 for messages taken
+   * from the middleware.
+   */
+  rcl_time_point_value_t source_timestamp;
+  /// Time at which the message was taken, or 0 if the clock could not be read.
+  rcl_time_point_value_t received_timestamp;
+  /// Number of messages sent by the publisher up to and including this one, or 0 if not known.
+  /* A gap between the numbers of consecutive messages from the same publisher
+   * means messages were dropped on the way to this subscription.
+   * Like the source_timestamp, it is only known for intra-process messages,
+   * and 0 for messages taken from the middleware.
+   */
+  uint64_t publication_sequence_number;
+} rcl_message_info_t;
+
+/// Type of the message field which a content filter condition reads.
+typedef enum rcl_content_filter_field_type_t
+{
+  RCL_CONTENT_FILTER_BOOL,
+  RCL_CONTENT_FILTER_INT8,
+  RCL_CONTENT_FILTER_UINT8,
+  RCL_CONTENT_FILTER_INT16,
+  RCL_CONTENT_FILTER_UINT16,
+  RCL_CONTENT_FILTER_INT32,
+  RCL_CONTENT_FILTER_UINT32,
+  RCL_CONTENT_FILTER_INT64,
+  RCL_CONTENT_FILTER_UINT64,
+  RCL_CONTENT_FILTER_FLOAT32,
+  RCL_CONTENT_FILTER_FLOAT64,
+  /// A rosidl_generator_c__String, compared with strcmp().
+  RCL_CONTENT_FILTER_STRING,
+} rcl_content_filter_field_type_t;
+
+/// How a content filter condition compares the field with its value.
+typedef enum rcl_content_filter_operator_t
+{
+  RCL_CONTENT_FILTER_EQUAL,
+  RCL_CONTENT_FILTER_NOT_EQUAL,
+  RCL_CONTENT_FILTER_LESS,
+  RCL_CONTENT_FILTER_LESS_EQUAL,
+  RCL_CONTENT_FILTER_GREATER,
+  RCL_CONTENT_FILTER_GREATER_EQUAL,
+} rcl_content_filter_operator_t;
+
+/// Condition on one field of a message, which the message must meet to be taken.
+/* The field is found by its byte offset in the C message struct, e.g.
+ * offsetof(std_msgs__msg__Header, frame_id), and read as the given type.
+ * The condition is true if `field operator value`, e.g. field == value.
+ */
+typedef struct rcl_content_filter_condition_t
+{
+  /// Byte offset of the field in the C message struct.
+  size_t offset;
+  rcl_content_filter_field_type_t type;
+  rcl_content_filter_operator_t op;
+  /// Value to compare with, the member which matches the type is used.
+  /* Integer and bool fields use int_value, except for RCL_CONTENT_FILTER_UINT64
+   * which uses uint_value.
+   */
+  union
+  {
+    int64_t int_value;
+    uint64_t uint_value;
+    double float_value;
+    /// Null terminated, copied during rcl_subscription_init().
+    const char * string_value;
+  } value;
+} rcl_content_filter_condition_t;
+
 /// Options available for a rcl subscription.
 typedef struct rcl_subscription_options_t
 {
@@ -42,6 +125,70 @@ typedef struct rcl_subscription_options_t
   rmw_qos_profile_t qos;
   /// If true, messages published from within the same node are ignored.
   bool ignore_local_publications;
+  /// Number of intra-process messages which can be queued, 0 disables intra-process delivery.
+  /* Messages which were delivered intra-process are skipped when taking from
+   * the middleware, see rcl_publish_loaned_message() and
+   * rcl_take_loaned_message() for details.
+   */
+  size_t intra_process_depth;
+  /// If true, only the latest of the messages which are available is taken.
+  /* Older messages are taken and discarded by rcl_take(), rcl_take_batch()
+   * and rcl_take_loaned_message(), and counted, see
+   * rcl_subscription_get_skipped_count().
+   * The default is false.
+   */
+  bool keep_latest_only;
+  /// Conditions which a message must all meet to be taken, or NULL to take every message.
+  /* Messages which do not meet them are discarded inside the take functions,
+   * and counted, see rcl_subscription_get_filtered_count().
+   * The conditions are checked on the message as it was taken, so with the
+   * keep_latest_only option only the latest message is checked, and nothing
+   * is taken if it does not meet them.
+   * The conditions are copied during rcl_subscription_init().
+   */
+  const rcl_content_filter_condition_t * content_filter;
+  /// Number of conditions in content_filter.
+  size_t content_filter_size;
+  /// Number of taken messages which are kept for lookups by time, 0 disables the cache.
+  /* The storage for these messages is allocated with the allocator during
+   * rcl_subscription_init(), see rcl_message_cache_lookup().
+   */
+  size_t cache_depth;
+  /// Size in bytes of one cached message, i.e. sizeof the C message struct.
+  /* Must be greater than 0 if cache_depth is greater than 0. */
+  size_t cache_message_size;
+  /// Function which copies a taken message into the cache, or NULL for a shallow copy.
+  /* See rcl_message_copy_function_t for when a shallow copy is enough.
+   * The copy is made into zero initialized storage which is allocated during
+   * rcl_subscription_init().
+   * A message which cannot be copied is not cached.
+   */
+  rcl_message_copy_function_t cache_message_copy;
+  /// Function which finalizes a cached message when it is dropped from the cache, or NULL.
+  /* Must be NULL unless cache_message_copy is set. */
+  rcl_message_fini_function_t cache_message_fini;
+  /// Maximum age of a cached message relative to the newest one, in nanoseconds.
+  /* The default is 0, which means messages are only dropped when the cache is full. */
+  uint64_t cache_duration_ns;
+  /// Number of messages which can be taken with rcl_take_pooled_message() at once.
+  /* The default is 0, which disables the pool. */
+  size_t take_message_pool_size;
+  /// Size in bytes of one pooled message, i.e. sizeof the C message struct.
+  /* Must be greater than 0 if take_message_pool_size is greater than 0. */
+  size_t take_message_size;
+  /// Function which initializes each pooled message once, or NULL to zero initialize them.
+  /* The pooled messages are allocated with the allocator and initialized
+   * during rcl_subscription_init().
+   */
+  rcl_message_init_function_t take_message_init;
+  /// Function which finalizes each pooled message during rcl_subscription_fini(), or NULL.
+  rcl_message_fini_function_t take_message_fini;
+  /// If true, statistics are collected for each take call, see rcl_subscription_get_statistics().
+  /* Collecting statistics costs a read of the steady clock and a few atomic
+   * increments per taken message.
+   * The default is false.
+   */
+  bool enable_statistics;
   /// Custom allocator for the subscription, used for incidental allocations.
   /* For default behavior (malloc/free), see: rcl_get_default_allocator() */
   rcl_allocator_t allocator;
@@ -95,6 +242,13 @@ rcl_get_zero_initialized_subscription(void);
  * well as a custom allocator which is used when (de)initializing the
  * subscription to allocate space for incidental things, e.g. the topic
  * name string.
+ * The quality of service settings are passed on to the middleware and should
+ * be compatible with those of the publishers on the topic.
+ * A keep last history with a depth of 0 is considered invalid.
+ *
+ * If the intra_process_depth option is not 0, the subscription also
+ * registers itself to receive loaned messages from publishers in the same
+ * process directly, see rcl_take_loaned_message().
  *
  * Expected usage (for C messages):
  *
@@ -147,6 +301,10 @@ rcl_subscription_init(
  * Additioanlly rcl_wait will be interrupted if currently blocking.
  * However, the given node handle is still valid.
  *
+ * Any intra-process messages which are queued or still held by the caller
+ * are given back to their publishers, so held messages must not be used
+ * after calling this function.
+ *
  * This function is not thread-safe.
  *
  * \param[inout] subscription handle to the subscription to be deinitialized
@@ -176,7 +334,6 @@ rcl_subscription_get_default_options(void);
  * TODO(wjwwood) blocking of take?
  * TODO(wjwwood) pre-, during-, and post-conditions for message ownership?
  * TODO(wjwwood) is rcl_take thread-safe?
- * TODO(wjwwood) Should there be an rcl_message_info_t?
  *
  * The ros_message pointer should point to an already allocated ROS message
  * struct of the correct type, into which the taken ROS message will be copied
@@ -198,6 +355,12 @@ rcl_subscription_get_default_options(void);
  * structure.
  * Passing NULL for message_info will result in the argument being ignored.
  *
+ * If the subscription was created with the keep_latest_only option, every
+ * message which is available is taken into ros_message in turn, so that it
+ * holds the latest one when this function returns, and message_info
+ * describes that message.
+ * The older messages are counted, see rcl_subscription_get_skipped_count().
+ *
  * \param[in] subscription the handle to the subscription from which to take
  * \param[inout] ros_message type-erased ptr to a allocated ROS message
  * \param[out] taken pointer to a bool, if set to false a message was not taken
@@ -207,7 +370,7 @@ rcl_subscription_get_default_options(void);
  *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
  *         RCL_RET_BAD_ALLOC if allocating memory failed, or
  *         RCL_RET_SUBSCRIPTION_TAKE_FAILED if take failed but no error
- *         occurred in the middleware, or
+ *         occurred in the middleware, in which case no error message is set, or
  *         RCL_RET_ERROR if an unspecified error occurs.
  */
 RCL_PUBLIC
@@ -218,6 +381,364 @@ rcl_take(
   void * ros_message,
   rmw_message_info_t * message_info);
 
+/// Take a ROS message like rcl_take(), and also record when it was received.
+/* The received_timestamp of message_info is read right after the message is
+ * taken from the middleware.
+ * The middleware does not tell when or in which order a message was
+ * published, so the source_timestamp and the publication_sequence_number
+ * are set to 0, use rcl_take_loaned_message() to get them for messages
+ * published in this process.
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[inout] ros_message type-erased ptr to a allocated ROS message
+ * \param[out] message_info struct which is filled with the meta-data of the message
+ * \return RCL_RET_OK if the message was taken, or
+ *         RCL_RET_INVALID_ARGUMENT if any arugments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed, or
+ *         RCL_RET_SUBSCRIPTION_TAKE_FAILED if take failed but no error
+ *         occurred in the middleware, in which case no error message is set, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_with_info(
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rcl_message_info_t * message_info);
+
+/// Take up to capacity ROS messages from a topic using a rcl subscription.
+/* This is equivalent to calling rcl_take() until it fails or capacity
+ * messages were taken, except that the arguments and the subscription are
+ * only validated once for the whole batch.
+ * This lets an executor drain a high rate topic after a single wait, instead
+ * of going through rcl_wait() again for every message.
+ *
+ * The middleware does not currently provide a batch take function, so the
+ * messages are taken from the middleware's take function one at a time.
+ *
+ * The same rules apply to each message as in rcl_take(), i.e. each element of
+ * the ros_messages array must point to an already allocated ROS message of
+ * the subscription's type, and must not be NULL.
+ * Messages are taken in order, so the first taken_count elements of the
+ * ros_messages and message_infos arrays are filled and the rest are
+ * unmodified.
+ * Passing NULL for message_infos will result in the meta-data being ignored.
+ *
+ * The number of messages which were taken is returned through the
+ * taken_count argument, which is also set if an error occurs after some of
+ * the messages were taken.
+ * If the subscription was created with the keep_latest_only option, at most
+ * one message, the latest, is taken into the first element of ros_messages.
+ * Passing a capacity of 0 is allowed and takes nothing.
+ *
+ * This function has the same thread-safety as rcl_take().
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[inout] ros_messages array of type-erased pointers to allocated ROS messages
+ * \param[out] message_infos array of capacity rmw structs for the meta-data, or NULL
+ * \param[in] capacity number of messages in the ros_messages array
+ * \param[out] taken_count number of messages which were taken
+ * \return RCL_RET_OK if at least one message was taken, or capacity is 0, or
+ *         RCL_RET_INVALID_ARGUMENT if any arugments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed, or
+ *         RCL_RET_SUBSCRIPTION_TAKE_FAILED if no message was available, in
+ *           which case no error message is set, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_batch(
+  const rcl_subscription_t * subscription,
+  void * const * ros_messages,
+  rmw_message_info_t * message_infos,
+  size_t capacity,
+  size_t * taken_count);
+
+/// Return the guard condition which is triggered when an intra-process message arrives.
+/* The guard condition can be added to a wait set with
+ * rcl_wait_set_add_guard_condition() in order to wake up rcl_wait() when a
+ * message can be taken with rcl_take_loaned_message().
+ * Messages which arrive through the middleware still wake up rcl_wait()
+ * through the subscription itself.
+ *
+ * This function can fail, and therefore return NULL, if the:
+ *   - subscription is NULL
+ *   - subscription is invalid (never called init, called fini, or invalid)
+ *   - subscription does not have intra-process delivery enabled
+ *
+ * The returned guard condition is only valid as long as the subscription is valid.
+ *
+ * \param[in] subscription pointer to the subscription
+ * \return guard condition if successful, otherwise NULL
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+const rcl_guard_condition_t *
+rcl_subscription_get_intra_process_guard_condition(const rcl_subscription_t * subscription);
+
+/// Set a callback which is called each time a new message can be taken.
+/* The callback is called in the thread which delivers the message, with a
+ * number_of_events of 1, after the message is in the queue of the subscription.
+ * An executor can use it to keep its own queue of ready subscriptions, instead
+ * of finding them with rcl_wait().
+ * Messages which arrived while no callback was set, and which rcl_wait() did
+ * not report yet, are passed to the callback as soon as it is set.
+ * Passing NULL for callback removes the callback.
+ *
+ * Only intra-process messages are currently reported, since the middleware
+ * cannot tell rcl about new messages without a wait set.
+ * Messages which arrive through the middleware must still be found with
+ * rcl_wait().
+ * This works like rcl_guard_condition_set_on_trigger_callback() on the guard
+ * condition returned by rcl_subscription_get_intra_process_guard_condition(),
+ * so the callback may also be called once more after it was replaced.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe with publishing to the subscription.
+ * This function is not lock-free, it spins briefly while a message is delivered.
+ *
+ * \param[in] subscription the subscription
+ * \param[in] callback the function to call for each new message, or NULL
+ * \param[in] user_data the pointer which is passed to the callback
+ * \return RCL_RET_OK if the callback was set, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_UNSUPPORTED if intra-process delivery is not enabled.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_set_on_new_message_callback(
+  const rcl_subscription_t * subscription,
+  rcl_event_callback_t callback,
+  const void * user_data);
+
+/// Return true if messages can be taken with rcl_take_loaned_message().
+/* The middleware does not currently loan messages, so this is true only if
+ * the subscription has intra-process delivery enabled, see the
+ * intra_process_depth option.
+ *
+ * This function can fail, and therefore return false, if the:
+ *   - subscription is NULL
+ *   - subscription is invalid (never called init, called fini, or invalid)
+ *
+ * \param[in] subscription pointer to the subscription
+ * \return true if the subscription can take loaned messages, otherwise false
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+bool
+rcl_subscription_can_loan_messages(const rcl_subscription_t * subscription);
+
+/// Take a ROS message from a topic without copying it, using a rcl subscription.
+/* Instead of copying the message into caller provided storage like
+ * rcl_take() does, the message stays owned by whoever loaned it, and
+ * loaned_message is set to point to it.
+ * The message must be treated as read-only and given back with
+ * rcl_return_loaned_message_from_subscription() once it is no longer needed.
+ *
+ * The middleware does not currently loan messages, so only messages
+ * delivered through the rcl intra-process path can be taken this way:
+ * loaned messages published with rcl_publish_loaned_message(), by a
+ * publisher in this process with the same topic name and type support, are
+ * handed directly to each subscription with a non-zero intra_process_depth.
+ * Up to intra_process_depth of those messages are queued, after which newer
+ * messages are dropped for this subscription until it catches up, and at
+ * most intra_process_depth messages can be held at the same time.
+ * With the keep_latest_only option, only the newest queued message is taken,
+ * and the older ones are given back to their publishers right away.
+ * Messages published from other processes are still taken with rcl_take(),
+ * and since the middleware also delivers the local messages through it,
+ * setting ignore_local_publications is recommended when taking loans.
+ *
+ * The from_intra_process field of message_info is set to true and the
+ * publisher_gid is zeroed, since it is not known at this level.
+ * The source_timestamp is the time at which the message was published, and
+ * the publication_sequence_number counts the loaned messages published by
+ * its publisher, so a gap means this subscription's queue was full.
+ * Passing NULL for message_info will result in the argument being ignored.
+ *
+ * This function does not allocate heap memory, but can on errors.
+ * This function is not thread-safe with itself or with
+ * rcl_return_loaned_message_from_subscription() for the same subscription.
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[out] loaned_message set to the type-erased pointer to the taken message
+ * \param[out] message_info struct which is filled with the meta-data of the message
+ * \return RCL_RET_OK if a message was taken, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_SUBSCRIPTION_TAKE_FAILED if no message was available, in
+ *           which case no error message is set, or
+ *         RCL_RET_UNSUPPORTED if the subscription cannot take loaned
+ *           messages, see rcl_subscription_can_loan_messages(), or
+ *         RCL_RET_ERROR if too many messages are already held.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_loaned_message(
+  const rcl_subscription_t * subscription,
+  const void ** loaned_message,
+  rcl_message_info_t * message_info);
+
+/// Give back a message taken with rcl_take_loaned_message().
+/* The message must not be used by the caller after it has been returned.
+ * An intra-process message is reused by its publisher once every
+ * subscription which received it has returned it.
+ *
+ * This function does not allocate heap memory, but can on errors.
+ * This function is not thread-safe with itself or with
+ * rcl_take_loaned_message() for the same subscription.
+ *
+ * \param[in] subscription the handle to the subscription which took the message
+ * \param[in] loaned_message type-erased pointer to the taken message
+ * \return RCL_RET_OK if the message was returned, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the
+ *           message was not taken from this subscription, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_loaned_message_from_subscription(
+  const rcl_subscription_t * subscription,
+  const void * loaned_message);
+
+/// Take a ROS message into a message from the pool of the subscription.
+/* This behaves like rcl_take_with_info(), but instead of a message owned by
+ * the caller, ros_message is set to a message from the pool which is set up
+ * with the take_message_pool_size option.
+ * The message must be given back with rcl_return_pooled_message() once it is
+ * no longer needed.
+ *
+ * Each pooled message is initialized once during rcl_subscription_init() and
+ * finalized once during rcl_subscription_fini(), and keeps its contents in
+ * between.
+ * So the strings and sequences of a message which is taken again keep the
+ * memory they already have, and the middleware can deserialize into it
+ * without allocating, as long as the new data fits.
+ * Once the pooled messages are large enough for the data on the topic, taking
+ * and returning a message does not allocate heap memory in rcl.
+ *
+ * If no message is available, the pooled message is given back and
+ * RCL_RET_SUBSCRIPTION_TAKE_FAILED is returned.
+ *
+ * This function has the same thread-safety as rcl_take(), except that
+ * getting a message from the pool is thread-safe and lock-free.
+ *
+ * \param[in] subscription the handle to the subscription from which to take
+ * \param[out] ros_message set to the type-erased pointer to the taken message
+ * \param[out] message_info struct which is filled with the meta-data, or NULL
+ * \return RCL_RET_OK if the message was taken, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or the pool is
+ *           not enabled for the subscription, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid, or
+ *         RCL_RET_SUBSCRIPTION_POOL_EXHAUSTED if all of the pooled messages
+ *           are in use, until one is given back, or
+ *         RCL_RET_SUBSCRIPTION_TAKE_FAILED if take failed but no error
+ *         occurred in the middleware, in which case no error message is set, or
+ *         RCL_RET_ERROR if an unspecified error occurs.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_take_pooled_message(
+  const rcl_subscription_t * subscription,
+  void ** ros_message,
+  rcl_message_info_t * message_info);
+
+/// Give back a message taken with rcl_take_pooled_message().
+/* The message must not be used after this call.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] subscription the handle to the subscription which lent the message
+ * \param[in] ros_message type-erased pointer to the pooled message
+ * \return RCL_RET_OK if the message was given back, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or the
+ *           message is not a taken message of this subscription, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_return_pooled_message(const rcl_subscription_t * subscription, void * ros_message);
+
+/// Get a snapshot of the statistics of a subscription.
+/* The statistics are collected by rcl_take(), rcl_take_with_info(),
+ * rcl_take_batch() and rcl_take_loaned_message(), if the subscription was
+ * created with the enable_statistics option.
+ * The age of a message and the gaps in its sequence numbers are only known
+ * for messages which carry a source timestamp and a sequence number, see
+ * rcl_message_info_t.
+ * A call to rcl_take_batch() which takes nothing counts as one empty take.
+ * The statistics of all subscriptions of a node can be read with
+ * rcl_node_get_subscription_statistics().
+ *
+ * Each counter is read atomically, but the counters are not read together,
+ * so a snapshot taken while taking may be slightly inconsistent.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] subscription handle to the subscription
+ * \param[out] statistics the statistics of the subscription
+ * \return RCL_RET_OK if the statistics were read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid or
+ *           statistics are not enabled for the subscription, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_get_statistics(
+  const rcl_subscription_t * subscription,
+  rcl_subscription_statistics_t * statistics);
+
+/// Get the number of messages which were discarded because of the content_filter option.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] subscription handle to the subscription
+ * \param[out] filtered_count the number of discarded messages
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_get_filtered_count(
+  const rcl_subscription_t * subscription,
+  uint64_t * filtered_count);
+
+/// Get the number of messages which were discarded because of the keep_latest_only option.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] subscription handle to the subscription
+ * \param[out] skipped_count the number of discarded messages
+ * \return RCL_RET_OK if the count was read, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_SUBSCRIPTION_INVALID if the subscription is invalid.
+ */
+RCL_PUBLIC
+RCL_WARN_UNUSED
+rcl_ret_t
+rcl_subscription_get_skipped_count(
+  const rcl_subscription_t * subscription,
+  uint64_t * skipped_count);
+
 /// Get the topic name for the subscription.
 /* This function returns the subscription's internal topic name string.
  * This function can fail, and therefore return NULL, if the:
@@ -15,6 +15,9 @@
 #ifndef RCL__TYPES_H_
 #define RCL__TYPES_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include <rmw/types.h>
 
 typedef rmw_ret_t rcl_ret_t;
@@ -26,19 +29,26 @@ typedef rmw_ret_t rcl_ret_t;
 #define RCL_RET_NOT_INIT 101
 #define RCL_RET_BAD_ALLOC 102
 #define RCL_RET_INVALID_ARGUMENT 103
+#define RCL_RET_UNSUPPORTED 104
 // rcl node specific ret codes in 2XX
 #define RCL_RET_NODE_INVALID 200
 // rcl publisher specific ret codes in 3XX
 #define RCL_RET_PUBLISHER_INVALID 300
+#define RCL_RET_PUBLISHER_LOAN_FAILED 301
 // rcl subscription specific ret codes in 4XX
 #define RCL_RET_SUBSCRIPTION_INVALID 400
+#define RCL_RET_SUBSCRIPTION_CACHE_MISS 401
+#define RCL_RET_SUBSCRIPTION_POOL_EXHAUSTED 402
 #define RCL_RET_SUBSCRIPTION_TAKE_FAILED 501
 // rcl service client specific ret codes in 5XX
 #define RCL_RET_CLIENT_INVALID 500
 #define RCL_RET_CLIENT_TAKE_FAILED 501
+#define RCL_RET_CLIENT_PENDING_REQUESTS_FULL 502
 // rcl service server specific ret codes in 6XX
 #define RCL_RET_SERVICE_INVALID 600
 #define RCL_RET_SERVICE_TAKE_FAILED 601
+#define RCL_RET_SERVICE_QUEUE_FULL 602
+#define RCL_RET_SERVICE_REQUEST_SHED 603
 // rcl guard condition specific ret codes in 7XX
 // rcl timer specific ret codes in 8XX
 #define RCL_RET_TIMER_INVALID 800
@@ -48,4 +58,33 @@ typedef rmw_ret_t rcl_ret_t;
 #define RCL_RET_WAIT_SET_EMPTY 901
 #define RCL_RET_WAIT_SET_FULL 902
 
+/// Callback which is told about new events of an entity, e.g. new messages.
+/* Only guard conditions and the intra-process messages of subscriptions are
+ * reported this way, see rcl_guard_condition_set_on_trigger_callback() and
+ * rcl_subscription_set_on_new_message_callback().
+ * Messages from the middleware, responses of clients and requests of
+ * services must still be found with rcl_wait(), because the middleware cannot
+ * report them without a wait set.
+ *
+ * \param[in] user_data the pointer which was given with the callback
+ * \param[in] number_of_events the number of new events, at least 1
+ */
+typedef void (* rcl_event_callback_t)(const void * user_data, size_t number_of_events);
+
+/// Function which initializes a ROS message in place, e.g. std_msgs__msg__String__init.
+typedef bool (* rcl_message_init_function_t)(void * ros_message);
+
+/// Function which finalizes a ROS message in place, e.g. std_msgs__msg__String__fini.
+typedef void (* rcl_message_fini_function_t)(void * ros_message);
+
+/// Function which copies a ROS message into zero initialized storage, returning false on failure.
+/* Options which take a copy function make a shallow copy of the C message
+ * struct if it is NULL.
+ * A shallow copy shares the data of strings and sequences with the original
+ * message, which the caller still owns, so it is only meant for messages
+ * without them, and the fini function which goes with the option must be
+ * NULL as well.
+ */
+typedef bool (* rcl_message_copy_function_t)(const void * source, void * destination);
+
 #endif  // RCL__TYPES_H_
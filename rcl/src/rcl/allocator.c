@@ -54,7 +54,7 @@ void *
 rcl_reallocf(void * pointer, size_t size, rcl_allocator_t * allocator)
 {
   if (!allocator || !allocator->reallocate || !allocator->deallocate) {
-    RCL_SET_ERROR_MSG("invalid allocator or allocator function pointers");
+    RCL_SET_ERROR_MSG_LITERAL("invalid allocator or allocator function pointers");
     return NULL;
   }
   void * new_pointer = allocator->reallocate(pointer, size, allocator->state);
@@ -0,0 +1,226 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./change_filter.h"
+
+#include <string.h>
+
+#include "./common.h"
+
+#define RCL_HASH_PRIME_1 0x9E3779B185EBCA87ULL
+#define RCL_HASH_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define RCL_HASH_PRIME_3 0x165667B19E3779F9ULL
+
+static inline uint64_t
+__rotate_left(uint64_t value, unsigned int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t
+__mix(uint64_t hash, uint64_t word)
+{
+  hash ^= __rotate_left(word * RCL_HASH_PRIME_2, 31) * RCL_HASH_PRIME_1;
+  return __rotate_left(hash, 27) * RCL_HASH_PRIME_1 + RCL_HASH_PRIME_3;
+}
+
+uint64_t
+rcl_impl_hash_bytes(const void * data, size_t size)
+{
+  const unsigned char * bytes = (const unsigned char *)data;
+  size_t remaining = size;
+  uint64_t lanes[4] = {
+    RCL_HASH_PRIME_1 + RCL_HASH_PRIME_2, RCL_HASH_PRIME_2, 0, (uint64_t)0 - RCL_HASH_PRIME_1
+  };
+  uint64_t word;
+  size_t i;
+  // Four independent lanes per 32 bytes keep the multipliers busy, and leave
+  // the compiler free to vectorize them.
+  for (; remaining >= 32; remaining -= 32, bytes += 32) {
+    for (i = 0; i < 4; ++i) {
+      memcpy(&word, bytes + i * 8, sizeof(word));
+      lanes[i] = __rotate_left(lanes[i] + word * RCL_HASH_PRIME_2, 31) * RCL_HASH_PRIME_1;
+    }
+  }
+  uint64_t hash = __rotate_left(lanes[0], 1) + __rotate_left(lanes[1], 7) +
+    __rotate_left(lanes[2], 12) + __rotate_left(lanes[3], 18) + (uint64_t)size;
+  for (; remaining >= 8; remaining -= 8, bytes += 8) {
+    memcpy(&word, bytes, sizeof(word));
+    hash = __mix(hash, word);
+  }
+  if (remaining > 0) {
+    word = 0;
+    memcpy(&word, bytes, remaining);
+    hash = __mix(hash, word);
+  }
+  // Final avalanche, so every input bit affects every output bit.
+  hash ^= hash >> 33;
+  hash *= RCL_HASH_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= RCL_HASH_PRIME_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+// Allocate an empty key buffer.
+static rcl_serialized_message_t *
+__key_create(rcl_allocator_t allocator)
+{
+  rcl_serialized_message_t * key = (rcl_serialized_message_t *)allocator.allocate(
+    sizeof(rcl_serialized_message_t), allocator.state);
+  if (!key) {
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    return NULL;
+  }
+  *key = rcl_get_zero_initialized_serialized_message();
+  // An empty buffer does not allocate, it grows with the first key.
+  if (rcl_serialized_message_init(key, 0, allocator) != RCL_RET_OK) {
+    allocator.deallocate(key, allocator.state);
+    return NULL;  // rcl error state should already be set.
+  }
+  return key;
+}
+
+// Free a key buffer, and return the error of finalizing it if any.
+static rcl_ret_t
+__key_destroy(rcl_allocator_t allocator, rcl_serialized_message_t * key)
+{
+  rcl_ret_t ret = rcl_serialized_message_fini(key);
+  allocator.deallocate(key, allocator.state);
+  return ret;
+}
+
+rcl_ret_t
+rcl_impl_change_filter_init(
+  rcl_change_filter_t * filter,
+  const rcl_publisher_options_t * options)
+{
+  filter->message_key = NULL;
+  filter->heartbeat_period_ns = options->change_only_heartbeat_ns;
+  filter->allocator = options->allocator;
+  atomic_init(&filter->has_published, false);
+  atomic_init(&filter->last_hash, 0);
+  atomic_init(&filter->last_publish_time, 0);
+  atomic_init(&filter->unchanged_count, 0);
+  if (!options->publish_changes_only) {
+    return RCL_RET_OK;
+  }
+  if (!options->change_only_message_key) {
+    RCL_SET_ERROR_MSG_LITERAL("change-only publishers need a change_only_message_key");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_serialized_message_t * key = __key_create(filter->allocator);
+  if (!key) {
+    return RCL_RET_BAD_ALLOC;  // rcl error state should already be set.
+  }
+  rcl_atomic_store(&filter->spare_key, (uintptr_t)key);
+  filter->message_key = options->change_only_message_key;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_impl_change_filter_fini(rcl_change_filter_t * filter)
+{
+  rcl_serialized_message_t * key =
+    (rcl_serialized_message_t *)(uintptr_t)rcl_atomic_exchange_uintptr_t(&filter->spare_key, 0);
+  if (!key) {
+    return RCL_RET_OK;
+  }
+  return __key_destroy(filter->allocator, key);
+}
+
+bool
+rcl_impl_change_filter_needs_clock(const rcl_change_filter_t * filter)
+{
+  return filter->message_key && filter->heartbeat_period_ns > 0;
+}
+
+rcl_ret_t
+rcl_impl_change_filter_check(
+  rcl_change_filter_t * filter,
+  const void * ros_message,
+  rcl_time_point_value_t now,
+  bool * publish,
+  uint64_t * hash)
+{
+  *publish = true;
+  *hash = 0;
+  if (!filter->message_key) {
+    return RCL_RET_OK;
+  }
+  rcl_serialized_message_t * key =
+    (rcl_serialized_message_t *)(uintptr_t)rcl_atomic_exchange_uintptr_t(&filter->spare_key, 0);
+  if (!key) {
+    // Another thread is checking a message with the spare buffer, use one of our own.
+    key = __key_create(filter->allocator);
+    if (!key) {
+      return RCL_RET_BAD_ALLOC;  // rcl error state should already be set.
+    }
+  }
+  key->buffer_length = 0;
+  rcl_ret_t ret = filter->message_key(ros_message, key);
+  if (ret == RCL_RET_OK && key->buffer_length > key->buffer_capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("message key length exceeds its capacity");
+    ret = RCL_RET_ERROR;
+  }
+  if (ret == RCL_RET_OK) {
+    *hash = rcl_impl_hash_bytes(key->buffer, key->buffer_length);
+  }
+  // Keep this buffer as the spare, and free the one another thread may have put back meanwhile.
+  rcl_serialized_message_t * other =
+    (rcl_serialized_message_t *)(uintptr_t)rcl_atomic_exchange_uintptr_t(
+    &filter->spare_key, (uintptr_t)key);
+  if (other && __key_destroy(filter->allocator, other) != RCL_RET_OK && ret == RCL_RET_OK) {
+    ret = RCL_RET_ERROR;  // rcl error state should already be set.
+  }
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  if (!rcl_atomic_load_bool(&filter->has_published) ||
+    rcl_atomic_load_uint64_t(&filter->last_hash) != *hash)
+  {
+    return RCL_RET_OK;
+  }
+  if (filter->heartbeat_period_ns > 0 &&
+    now >= rcl_atomic_load_uint64_t(&filter->last_publish_time) + filter->heartbeat_period_ns)
+  {
+    return RCL_RET_OK;
+  }
+  rcl_atomic_fetch_add_uint64_t(&filter->unchanged_count, 1);
+  *publish = false;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_change_filter_commit(
+  rcl_change_filter_t * filter,
+  uint64_t hash,
+  rcl_time_point_value_t now)
+{
+  if (!filter->message_key) {
+    return;
+  }
+  rcl_atomic_store(&filter->last_hash, hash);
+  rcl_atomic_store(&filter->last_publish_time, now);
+  rcl_atomic_store(&filter->has_published, true);
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__CHANGE_FILTER_H_
+#define RCL__CHANGE_FILTER_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/publisher.h"
+#include "rcl/serialized_message.h"
+#include "rcl/allocator.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// State of the change-only publishing of a publisher.
+/* Only the hash of the key of the last published message is kept, so a
+ * message which differs but collides with it is suppressed as well, with a
+ * probability of about 2^-64.
+ */
+typedef struct rcl_change_filter_t
+{
+  /// Function which writes the key of a message, or NULL if the filter is disabled.
+  rcl_publisher_message_key_function_t message_key;
+  /// Key buffer which no check is using, a rcl_serialized_message_t pointer or 0.
+  /* A check takes the buffer out with an atomic exchange, so the key function
+   * is never called while a lock is held.
+   */
+  atomic_uintptr_t spare_key;
+  /// Allocator of the key buffers.
+  rcl_allocator_t allocator;
+  /// Maximum time between two published messages, or 0 for no heartbeat.
+  uint64_t heartbeat_period_ns;
+  atomic_bool has_published;
+  atomic_uint_least64_t last_hash;
+  atomic_uint_least64_t last_publish_time;
+  atomic_uint_least64_t unchanged_count;
+} rcl_change_filter_t;
+
+/// Return a 64-bit non-cryptographic hash of size bytes of data.
+/* The data is consumed 8 bytes at a time with unaligned loads, so the hash is
+ * only limited by the multiplier throughput and needs no alignment of data.
+ */
+uint64_t
+rcl_impl_hash_bytes(const void * data, size_t size);
+
+/// Validate the change-only options and initialize the filter from them.
+/* The spare key must be initialized to 0 before calling this.
+ * The spare key buffer starts empty and uses the allocator of the options.
+ *
+ * \return RCL_RET_OK if the filter was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if the options are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_change_filter_init(
+  rcl_change_filter_t * filter,
+  const rcl_publisher_options_t * options);
+
+/// Release the key buffer of the filter.
+/* Safe to call on a filter whose spare key is still 0. */
+rcl_ret_t
+rcl_impl_change_filter_fini(rcl_change_filter_t * filter);
+
+/// Return true if the filter needs the current time.
+bool
+rcl_impl_change_filter_needs_clock(const rcl_change_filter_t * filter);
+
+/// Decide whether a message should be published, otherwise count it as unchanged.
+/* A message should be published if the filter is disabled, if nothing was
+ * published yet, if the hash of its key differs from the last published
+ * message, or if the heartbeat period has elapsed since then.
+ * The key is written by the message_key function into the spare key buffer
+ * of the filter, which the check takes out and puts back afterwards.
+ * A check which finds no spare buffer, because other threads are checking
+ * messages at the same time, allocates a buffer of its own, and the buffers
+ * beyond the one kept as the spare are freed again.
+ * The filter is not updated, call rcl_impl_change_filter_commit() once the
+ * message was actually published, so a message which is suppressed by the
+ * throttle or fails to publish is not mistaken for the last published one.
+ *
+ * This function allocates heap memory only if the key function grows the key,
+ * or if several threads check messages at the same time.
+ * This function is thread-safe.
+ * This function is lock-free, unless the key function is not.
+ *
+ * \param[in] filter the change filter of the publisher
+ * \param[in] ros_message the message
+ * \param[in] now the steady time, only used if rcl_impl_change_filter_needs_clock()
+ * \param[out] publish true if the message should be published
+ * \param[out] hash the hash of the key, to be passed to rcl_impl_change_filter_commit()
+ * \return RCL_RET_OK if the message was checked, or
+ *         RCL_RET_ERROR if the key function failed or set an invalid length, or
+ *         the error returned by the key function.
+ */
+rcl_ret_t
+rcl_impl_change_filter_check(
+  rcl_change_filter_t * filter,
+  const void * ros_message,
+  rcl_time_point_value_t now,
+  bool * publish,
+  uint64_t * hash);
+
+/// Remember a message as the last published one.
+/* Concurrent publishers race to set it, which at worst lets an unchanged
+ * message through.
+ */
+void
+rcl_impl_change_filter_commit(
+  rcl_change_filter_t * filter,
+  uint64_t hash,
+  rcl_time_point_value_t now);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__CHANGE_FILTER_H_
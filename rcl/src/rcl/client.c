@@ -24,13 +24,23 @@ extern "C"
 #include "rmw/rmw.h"
 
 #include "./common.h"
+#include "./pending_requests.h"
 #include "./stdatomic_helper.h"
 
 typedef struct rcl_client_impl_t
 {
   rcl_client_options_t options;
   rmw_client_t * rmw_handle;
-  atomic_int_least64_t sequence_number;
+  // Number of requests which were sent successfully.
+  atomic_uint_least64_t sent_request_count;
+  // Protects the pending requests, never held while calling a callback.
+  atomic_bool pending_requests_lock;
+  // Empty unless the max_pending_requests option is greater than 0.
+  rcl_pending_requests_t pending_requests;
+  // Requests which are being sent without the lock, and have a slot of the table reserved,
+  // counted by the parity of the epoch in which they were reserved, guarded by the lock.
+  size_t sending_count[2];
+  uint64_t sending_epoch;
 } rcl_client_impl_t;
 
 rcl_client_t
@@ -52,16 +62,19 @@ rcl_client_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (!node->impl) {
-    RCL_SET_ERROR_MSG("invalid node");
+    RCL_SET_ERROR_MSG_LITERAL("invalid node");
     return RCL_RET_NODE_INVALID;
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(type_support, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(service_name, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   if (client->impl) {
-    RCL_SET_ERROR_MSG("client already initialized, or memory was unintialized");
+    RCL_SET_ERROR_MSG_LITERAL("client already initialized, or memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
+  if (rcl_impl_validate_qos_profile(&options->qos) != RCL_RET_OK) {
+    return RCL_RET_INVALID_ARGUMENT;  // rcl error state should already be set.
+  }
   const rcl_allocator_t * allocator = &options->allocator;
   RCL_CHECK_FOR_NULL_WITH_MSG(
     allocator->allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
@@ -73,23 +86,42 @@ rcl_client_init(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     client->impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
   // Fill out implementation struct.
+  atomic_init(&client->impl->sent_request_count, 0);
+  atomic_init(&client->impl->pending_requests_lock, false);
+  client->impl->pending_requests = rcl_impl_get_zero_initialized_pending_requests();
+  client->impl->sending_count[0] = 0;
+  client->impl->sending_count[1] = 0;
+  client->impl->sending_epoch = 0;
   // rmw handle (create rmw client)
   // TODO(wjwwood): pass along the allocator to rmw when it supports it
   client->impl->rmw_handle = rmw_create_client(
     rcl_node_get_rmw_handle(node),
     type_support,
     service_name,
-    &rmw_qos_profile_default);
+    &options->qos);
   if (!client->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
     goto fail;
   }
   // options
   client->impl->options = *options;
+  // pending requests
+  if (options->max_pending_requests > 0) {
+    rcl_ret_t ret = rcl_impl_pending_requests_init(
+      &client->impl->pending_requests, options->max_pending_requests, *allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
   return RCL_RET_OK;
 fail:
   if (client->impl) {
+    if (client->impl->rmw_handle) {
+      (void)rmw_destroy_client(client->impl->rmw_handle);
+    }
     allocator->deallocate(client->impl, allocator->state);
+    client->impl = NULL;
   }
   return fail_ret;
 }
@@ -102,6 +134,12 @@ rcl_client_fini(rcl_client_t * client, rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (client->impl) {
+    // Complete the pending requests, so nobody waits for them forever.
+    rcl_pending_request_t request;
+    while (rcl_impl_pending_requests_pop_any(&client->impl->pending_requests, &request)) {
+      request.callback(request.user_data, request.sequence_number, NULL, RCL_RET_CLIENT_INVALID);
+    }
+    rcl_impl_pending_requests_fini(&client->impl->pending_requests);
     rmw_ret_t ret =
       rmw_destroy_client(client->impl->rmw_handle);
     if (ret != RMW_RET_OK) {
@@ -153,6 +191,37 @@ rcl_client_get_rmw_handle(const rcl_client_t * client)
   return client->impl->rmw_handle;
 }
 
+// Send one request, without counting it.
+static rcl_ret_t
+__send_request(rcl_client_impl_t * impl, const void * ros_request, int64_t * sequence_number)
+{
+  // The middleware assigns the sequence number, so that it matches the one in the response.
+  // It is written to a local first, so concurrent callers never see each other's numbers.
+  int64_t local_sequence_number = 0;
+  if (rmw_send_request(impl->rmw_handle, ros_request, &local_sequence_number) != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+    return RCL_RET_ERROR;
+  }
+  *sequence_number = local_sequence_number;
+  return RCL_RET_OK;
+}
+
+// Check the arguments which the batch send functions have in common.
+static rcl_ret_t
+__check_request_batch(const void * const * ros_requests, size_t count, int64_t * sequence_numbers)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_requests, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence_numbers, RCL_RET_INVALID_ARGUMENT);
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    if (!ros_requests[i]) {
+      RCL_SET_ERROR_MSG_LITERAL("ros_requests argument contains a null request");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  }
+  return RCL_RET_OK;
+}
+
 RCL_PUBLIC
 RCL_WARN_UNUSED
 rcl_ret_t
@@ -162,15 +231,308 @@ rcl_send_request(const rcl_client_t * client, const void * ros_request, int64_t
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_request, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(sequence_number, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_FOR_NULL_WITH_MSG(
-    client->impl, "client is invalid", return RCL_RET_INVALID_ARGUMENT);
-  *sequence_number = rcl_atomic_load_int64_t(&client->impl->sequence_number);
-  if (rmw_send_request(
-      client->impl->rmw_handle, ros_request, sequence_number) != RMW_RET_OK)
-  {
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  rcl_ret_t ret = __send_request(client->impl, ros_request, sequence_number);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_atomic_fetch_add_uint64_t(&client->impl->sent_request_count, 1);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_send_request_batch(
+  const rcl_client_t * client,
+  const void * const * ros_requests,
+  size_t count,
+  int64_t * sequence_numbers,
+  size_t * sent_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sent_count, RCL_RET_INVALID_ARGUMENT);
+  *sent_count = 0;
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  if (count == 0) {
+    return RCL_RET_OK;
+  }
+  rcl_ret_t ret = __check_request_batch(ros_requests, count, sequence_numbers);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  // The middleware has no batch send, so each request is sent on its own.
+  while (*sent_count < count) {
+    ret = __send_request(
+      client->impl, ros_requests[*sent_count], &sequence_numbers[*sent_count]);
+    if (ret != RCL_RET_OK) {
+      break;  // rcl error state should already be set.
+    }
+    ++(*sent_count);
+  }
+  if (*sent_count > 0) {
+    rcl_atomic_fetch_add_uint64_t(&client->impl->sent_request_count, *sent_count);
+  }
+  return ret;
+}
+
+// Reserve a slot of the table for a request which is about to be sent without the lock.
+static bool
+__reserve_pending_request(rcl_client_impl_t * impl, size_t * parity)
+{
+  rcl_atomic_spin_lock(&impl->pending_requests_lock);
+  size_t sending_count = impl->sending_count[0] + impl->sending_count[1];
+  bool reserved = impl->pending_requests.size + sending_count < impl->pending_requests.capacity;
+  if (reserved) {
+    *parity = impl->sending_epoch & 1;
+    ++impl->sending_count[*parity];
+  }
+  rcl_atomic_spin_unlock(&impl->pending_requests_lock);
+  return reserved;
+}
+
+// Add a sent request to the table, or only release its reservation if request is NULL.
+static void
+__finish_pending_request(
+  rcl_client_impl_t * impl,
+  size_t parity,
+  const rcl_pending_request_t * request)
+{
+  rcl_atomic_spin_lock(&impl->pending_requests_lock);
+  --impl->sending_count[parity];
+  if (request) {
+    // There is room for the request, since a slot was reserved for it.
+    (void)rcl_impl_pending_requests_insert(&impl->pending_requests, request);
+  }
+  rcl_atomic_spin_unlock(&impl->pending_requests_lock);
+}
+
+// Remove the pending request of a taken response, if there is one.
+// The response can be taken before its request is added to the table, since requests are sent
+// without the lock, so a response which matches no request waits for the requests which were
+// being sent when it was taken.
+// Those are done once the epoch has advanced twice, as it only advances once the requests
+// reserved in the epoch before the current one are done, and later requests are not waited for.
+static bool
+__remove_pending_request(
+  rcl_client_impl_t * impl,
+  int64_t sequence_number,
+  rcl_pending_request_t * request)
+{
+  bool waiting = false;
+  uint64_t target_epoch = 0;
+  for (;;) {
+    rcl_atomic_spin_lock(&impl->pending_requests_lock);
+    bool pending =
+      rcl_impl_pending_requests_remove(&impl->pending_requests, sequence_number, request);
+    if (!pending && !waiting) {
+      waiting = true;
+      target_epoch = impl->sending_epoch + 2;
+    }
+    if (!pending && impl->sending_epoch < target_epoch &&
+      impl->sending_count[(impl->sending_epoch + 1) & 1] == 0)
+    {
+      ++impl->sending_epoch;
+    }
+    bool done = pending || impl->sending_epoch >= target_epoch ||
+      impl->sending_count[0] + impl->sending_count[1] == 0;
+    rcl_atomic_spin_unlock(&impl->pending_requests_lock);
+    if (done) {
+      return pending;
+    }
+    rcl_impl_yield_thread();
+  }
+}
+
+rcl_ret_t
+rcl_send_request_async(
+  const rcl_client_t * client,
+  const void * ros_request,
+  uint64_t timeout_ns,
+  rcl_client_response_callback_t callback,
+  const void * user_data,
+  int64_t * sequence_number)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_request, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(sequence_number, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  rcl_client_impl_t * impl = client->impl;
+  if (impl->pending_requests.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("asynchronous requests are not enabled for this client");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_pending_request_t request;
+  request.deadline = 0;
+  if (timeout_ns > 0) {
+    rcl_time_point_value_t now;
+    if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+      return RCL_RET_ERROR;  // rcl error state should already be set.
+    }
+    request.deadline = now + timeout_ns;
+  }
+  request.callback = callback;
+  request.user_data = user_data;
+  size_t parity;
+  if (!__reserve_pending_request(impl, &parity)) {
+    RCL_SET_ERROR_MSG_LITERAL("too many requests of the client are pending");
+    return RCL_RET_CLIENT_PENDING_REQUESTS_FULL;
+  }
+  rcl_ret_t ret = rcl_send_request(client, ros_request, sequence_number);
+  if (ret != RCL_RET_OK) {
+    __finish_pending_request(impl, parity, NULL);
+    return ret;  // rcl error state should already be set.
+  }
+  request.sequence_number = *sequence_number;
+  __finish_pending_request(impl, parity, &request);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_send_request_batch_async(
+  const rcl_client_t * client,
+  const void * const * ros_requests,
+  size_t count,
+  uint64_t timeout_ns,
+  rcl_client_response_callback_t callback,
+  const void * user_data,
+  int64_t * sequence_numbers,
+  size_t * sent_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(sent_count, RCL_RET_INVALID_ARGUMENT);
+  *sent_count = 0;
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(callback, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  rcl_client_impl_t * impl = client->impl;
+  if (impl->pending_requests.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("asynchronous requests are not enabled for this client");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (count == 0) {
+    return RCL_RET_OK;
+  }
+  rcl_ret_t ret = __check_request_batch(ros_requests, count, sequence_numbers);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  // All requests of the batch share the clock reading, each one is added like a single request.
+  rcl_pending_request_t request;
+  request.deadline = 0;
+  if (timeout_ns > 0) {
+    rcl_time_point_value_t now;
+    if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+      return RCL_RET_ERROR;  // rcl error state should already be set.
+    }
+    request.deadline = now + timeout_ns;
+  }
+  request.callback = callback;
+  request.user_data = user_data;
+  size_t parity;
+  while (*sent_count < count && __reserve_pending_request(impl, &parity)) {
+    ret = __send_request(impl, ros_requests[*sent_count], &sequence_numbers[*sent_count]);
+    if (ret != RCL_RET_OK) {
+      __finish_pending_request(impl, parity, NULL);
+      break;  // rcl error state should already be set.
+    }
+    request.sequence_number = sequence_numbers[*sent_count];
+    __finish_pending_request(impl, parity, &request);
+    ++(*sent_count);
+  }
+  if (*sent_count > 0) {
+    rcl_atomic_fetch_add_uint64_t(&impl->sent_request_count, *sent_count);
+  }
+  if (ret == RCL_RET_OK && *sent_count == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("too many requests of the client are pending");
+    return RCL_RET_CLIENT_PENDING_REQUESTS_FULL;
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_client_expire_pending_requests(const rcl_client_t * client, int64_t * next_timeout_ns)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  rcl_client_impl_t * impl = client->impl;
+  if (impl->pending_requests.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("asynchronous requests are not enabled for this client");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_time_point_value_t now;
+  if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+    return RCL_RET_ERROR;  // rcl error state should already be set.
+  }
+  for (;;) {
+    rcl_pending_request_t request;
+    rcl_atomic_spin_lock(&impl->pending_requests_lock);
+    bool expired = rcl_impl_pending_requests_pop_expired(&impl->pending_requests, now, &request);
+    rcl_atomic_spin_unlock(&impl->pending_requests_lock);
+    if (!expired) {
+      break;
+    }
+    request.callback(request.user_data, request.sequence_number, NULL, RCL_RET_TIMEOUT);
+  }
+  if (next_timeout_ns) {
+    rcl_atomic_spin_lock(&impl->pending_requests_lock);
+    rcl_time_point_value_t deadline =
+      rcl_impl_pending_requests_next_deadline(&impl->pending_requests);
+    rcl_atomic_spin_unlock(&impl->pending_requests_lock);
+    if (deadline == 0) {
+      *next_timeout_ns = -1;
+    } else {
+      *next_timeout_ns = deadline > now ? (int64_t)(deadline - now) : 0;
+    }
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_client_get_sent_request_count(const rcl_client_t * client, uint64_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  *count = rcl_atomic_load_uint64_t(&client->impl->sent_request_count);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_client_get_pending_request_count(const rcl_client_t * client, size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  rcl_atomic_spin_lock(&client->impl->pending_requests_lock);
+  *count = client->impl->pending_requests.size;
+  rcl_atomic_spin_unlock(&client->impl->pending_requests_lock);
+  return RCL_RET_OK;
+}
+
+// Take one response, and complete its request if it is pending.
+static rcl_ret_t
+__take_response(rcl_client_impl_t * impl, rmw_request_id_t * request_header, void * ros_response)
+{
+  bool taken = false;
+  if (rmw_take_response(impl->rmw_handle, request_header, ros_response, &taken) != RMW_RET_OK) {
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
     return RCL_RET_ERROR;
   }
-  rcl_atomic_exchange_int64_t(&client->impl->sequence_number, *sequence_number);
+  if (!taken) {
+    // Nothing to take is expected when polling, so no error message is set.
+    return RCL_RET_CLIENT_TAKE_FAILED;
+  }
+  if (impl->pending_requests.capacity > 0) {
+    rcl_pending_request_t request;
+    if (__remove_pending_request(impl, request_header->sequence_number, &request)) {
+      request.callback(request.user_data, request.sequence_number, ros_response, RCL_RET_OK);
+    }
+  }
   return RCL_RET_OK;
 }
 
@@ -187,16 +549,47 @@ rcl_take_response(
     client->impl, "client is invalid", return RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(request_header, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_response, RCL_RET_INVALID_ARGUMENT);
+  return __take_response(client->impl, request_header, ros_response);
+}
 
-  bool taken = false;
-  if (rmw_take_response(
-      client->impl->rmw_handle, request_header, ros_response, &taken) != RMW_RET_OK)
-  {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
-    return RCL_RET_ERROR;
+rcl_ret_t
+rcl_take_response_batch(
+  const rcl_client_t * client,
+  rmw_request_id_t * request_headers,
+  void * const * ros_responses,
+  size_t capacity,
+  size_t * taken_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(taken_count, RCL_RET_INVALID_ARGUMENT);
+  *taken_count = 0;
+  RCL_CHECK_ARGUMENT_FOR_NULL(client, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    client->impl, "client is invalid", return RCL_RET_CLIENT_INVALID);
+  if (capacity == 0) {
+    return RCL_RET_OK;
   }
-  if (!taken) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+  RCL_CHECK_ARGUMENT_FOR_NULL(request_headers, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_responses, RCL_RET_INVALID_ARGUMENT);
+  size_t i;
+  for (i = 0; i < capacity; ++i) {
+    if (!ros_responses[i]) {
+      RCL_SET_ERROR_MSG_LITERAL("ros_responses argument contains a null response");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  }
+  // The middleware has no batch take, so each response is taken on its own.
+  for (i = 0; i < capacity; ++i) {
+    rcl_ret_t ret = __take_response(client->impl, &request_headers[i], ros_responses[i]);
+    if (ret == RCL_RET_CLIENT_TAKE_FAILED) {
+      break;
+    }
+    if (ret != RCL_RET_OK) {
+      return ret;  // rcl error state should already be set.
+    }
+    ++(*taken_count);
+  }
+  if (*taken_count == 0) {
+    // Nothing to take is expected when polling, so no error message is set.
     return RCL_RET_CLIENT_TAKE_FAILED;
   }
   return RCL_RET_OK;
@@ -21,6 +21,12 @@ extern "C"
 
 #include <stdlib.h>
 
+#if defined(WIN32)
+# include <windows.h>
+#else
+# include <sched.h>
+#endif
+
 #if defined(WIN32)
 # define WINDOWS_ENV_BUFFER_SIZE 2048
 static char __env_buffer[WINDOWS_ENV_BUFFER_SIZE];
@@ -41,7 +47,7 @@ rcl_impl_getenv(const char * env_name, const char ** env_value)
   size_t required_size;
   errno_t ret = getenv_s(&required_size, __env_buffer, sizeof(__env_buffer), env_name);
   if (ret != 0) {
-    RCL_SET_ERROR_MSG("value in env variable too large to read in");
+    RCL_SET_ERROR_MSG_LITERAL("value in env variable too large to read in");
     return RCL_RET_ERROR;
   }
   __env_buffer[WINDOWS_ENV_BUFFER_SIZE - 1] = '\0';
@@ -50,6 +56,46 @@ rcl_impl_getenv(const char * env_name, const char ** env_value)
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_impl_validate_qos_profile(const rmw_qos_profile_t * qos)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(qos, RCL_RET_INVALID_ARGUMENT);
+  switch (qos->history) {
+    case RMW_QOS_POLICY_KEEP_LAST_HISTORY:
+      if (qos->depth == 0) {
+        RCL_SET_ERROR_MSG_LITERAL("qos history is keep last but depth is 0");
+        return RCL_RET_INVALID_ARGUMENT;
+      }
+      break;
+    case RMW_QOS_POLICY_KEEP_ALL_HISTORY:
+    case RMW_QOS_POLICY_HISTORY_SYSTEM_DEFAULT:
+      break;
+    default:
+      RCL_SET_ERROR_MSG_LITERAL("qos history policy is unknown");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  switch (qos->reliability) {
+    case RMW_QOS_POLICY_RELIABLE:
+    case RMW_QOS_POLICY_BEST_EFFORT:
+    case RMW_QOS_POLICY_RELIABILITY_SYSTEM_DEFAULT:
+      break;
+    default:
+      RCL_SET_ERROR_MSG_LITERAL("qos reliability policy is unknown");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_yield_thread()
+{
+#if !defined(WIN32)
+  sched_yield();
+#else  // !defined(WIN32)
+  SwitchToThread();
+#endif  // !defined(WIN32)
+}
+
 #if __cplusplus
 }
 #endif
@@ -21,14 +21,16 @@ extern "C"
 #endif
 
 #include "rcl/error_handling.h"
+#include "rcl/guard_condition.h"
 #include "rcl/types.h"
+#include "rmw/types.h"
 
 #define RCL_CHECK_ARGUMENT_FOR_NULL(argument, error_return_type) \
   RCL_CHECK_FOR_NULL_WITH_MSG(argument, #argument " argument is null", return error_return_type)
 
 #define RCL_CHECK_FOR_NULL_WITH_MSG(value, msg, error_statement) \
   if (!(value)) { \
-    RCL_SET_ERROR_MSG(msg); \
+    RCL_SET_ERROR_MSG_LITERAL(msg); \
     error_statement; \
   }
 
@@ -53,6 +55,45 @@ extern "C"
 rcl_ret_t
 rcl_impl_getenv(const char * env_name, const char ** env_value);
 
+/// Check that the given quality of service profile can be passed to the middleware.
+/* The history and reliability policies must be known values and a keep last
+ * history must have a non-zero depth.
+ * If the profile is invalid the rcl error state is set.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] qos the quality of service profile to validate
+ * \return RCL_RET_OK if the profile is valid, or
+ *         RCL_RET_INVALID_ARGUMENT if the profile is NULL or invalid.
+ */
+rcl_ret_t
+rcl_impl_validate_qos_profile(const rmw_qos_profile_t * qos);
+
+/// Give up the rest of the time slice of the calling thread to other threads.
+/* Used while waiting for another thread to make progress, instead of
+ * spinning on a core which that thread may need.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ */
+void
+rcl_impl_yield_thread(void);
+
+/// Forget the triggers of a guard condition which were counted while no callback was set.
+/* Used by rcl_wait() once it reported the guard condition as ready, so that
+ * these triggers are not passed to an on trigger callback which is set later.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the callback lock of the guard condition.
+ *
+ * \param[in] guard_condition a valid guard condition
+ */
+void
+rcl_impl_guard_condition_clear_unread_count(const rcl_guard_condition_t * guard_condition);
+
 #if __cplusplus
 }
 #endif
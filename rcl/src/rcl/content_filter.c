@@ -0,0 +1,251 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./content_filter.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rosidl_generator_c/string.h"
+
+#include "./common.h"
+
+// Result of comparing two values which have no order, i.e. if one of them is NaN.
+#define RCL_CONTENT_FILTER_UNORDERED 2
+
+rcl_content_filter_t
+rcl_impl_get_zero_initialized_content_filter()
+{
+  static rcl_content_filter_t null_filter = {0};
+  return null_filter;
+}
+
+rcl_ret_t
+rcl_impl_content_filter_init(
+  rcl_content_filter_t * filter,
+  const rcl_content_filter_condition_t * conditions,
+  size_t size,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(filter, RCL_RET_INVALID_ARGUMENT);
+  atomic_init(&filter->filtered_count, 0);
+  if (size == 0) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(conditions, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  if (size > SIZE_MAX / 2 / sizeof(rcl_content_filter_condition_t)) {
+    RCL_SET_ERROR_MSG_LITERAL("too many content filter conditions");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  // The conditions and their strings are copied into a single block.
+  size_t bytes = sizeof(rcl_content_filter_condition_t) * size;
+  size_t i;
+  for (i = 0; i < size; ++i) {
+    if (conditions[i].type < RCL_CONTENT_FILTER_BOOL ||
+      conditions[i].type > RCL_CONTENT_FILTER_STRING)
+    {
+      RCL_SET_ERROR_MSG_LITERAL("unknown content filter field type");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+    if (conditions[i].op < RCL_CONTENT_FILTER_EQUAL ||
+      conditions[i].op > RCL_CONTENT_FILTER_GREATER_EQUAL)
+    {
+      RCL_SET_ERROR_MSG_LITERAL("unknown content filter operator");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+    if (conditions[i].type == RCL_CONTENT_FILTER_STRING) {
+      RCL_CHECK_FOR_NULL_WITH_MSG(
+        conditions[i].value.string_value, "content filter string value is null",
+        return RCL_RET_INVALID_ARGUMENT);
+      bytes += strlen(conditions[i].value.string_value) + 1;
+    }
+  }
+  filter->conditions =
+    (rcl_content_filter_condition_t *)allocator.allocate(bytes, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    filter->conditions, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  memcpy(filter->conditions, conditions, sizeof(rcl_content_filter_condition_t) * size);
+  char * strings = (char *)(filter->conditions + size);
+  for (i = 0; i < size; ++i) {
+    if (conditions[i].type == RCL_CONTENT_FILTER_STRING) {
+      size_t length = strlen(conditions[i].value.string_value) + 1;
+      memcpy(strings, conditions[i].value.string_value, length);
+      filter->conditions[i].value.string_value = strings;
+      strings += length;
+    }
+  }
+  filter->size = size;
+  filter->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_content_filter_fini(rcl_content_filter_t * filter)
+{
+  if (filter->conditions) {
+    filter->allocator.deallocate(filter->conditions, filter->allocator.state);
+    filter->conditions = NULL;
+  }
+  filter->size = 0;
+}
+
+// Read an integer field as int64_t, the field may not be aligned.
+static int64_t
+__read_signed(const char * field, rcl_content_filter_field_type_t type)
+{
+  switch (type) {
+    case RCL_CONTENT_FILTER_BOOL:
+      {
+        bool value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_INT8:
+      {
+        int8_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_UINT8:
+      {
+        uint8_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_INT16:
+      {
+        int16_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_UINT16:
+      {
+        uint16_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_INT32:
+      {
+        int32_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    case RCL_CONTENT_FILTER_UINT32:
+      {
+        uint32_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+    default:
+      {
+        int64_t value;
+        memcpy(&value, field, sizeof(value));
+        return value;
+      }
+  }
+}
+
+// Compare the field of a message with the value of a condition, like strcmp().
+static int
+__compare(const rcl_content_filter_condition_t * condition, const char * field)
+{
+  switch (condition->type) {
+    case RCL_CONTENT_FILTER_UINT64:
+      {
+        uint64_t value;
+        memcpy(&value, field, sizeof(value));
+        return (value > condition->value.uint_value) - (value < condition->value.uint_value);
+      }
+    case RCL_CONTENT_FILTER_FLOAT32:
+    case RCL_CONTENT_FILTER_FLOAT64:
+      {
+        double value;
+        if (condition->type == RCL_CONTENT_FILTER_FLOAT32) {
+          float single;
+          memcpy(&single, field, sizeof(single));
+          value = single;
+        } else {
+          memcpy(&value, field, sizeof(value));
+        }
+        if (value < condition->value.float_value) {
+          return -1;
+        }
+        if (value > condition->value.float_value) {
+          return 1;
+        }
+        return value == condition->value.float_value ? 0 : RCL_CONTENT_FILTER_UNORDERED;
+      }
+    case RCL_CONTENT_FILTER_STRING:
+      {
+        rosidl_generator_c__String value;
+        memcpy(&value, field, sizeof(value));
+        int result = strcmp(value.data ? value.data : "", condition->value.string_value);
+        return (result > 0) - (result < 0);
+      }
+    default:
+      {
+        int64_t value = __read_signed(field, condition->type);
+        return (value > condition->value.int_value) - (value < condition->value.int_value);
+      }
+  }
+}
+
+bool
+rcl_impl_content_filter_accept(rcl_content_filter_t * filter, const void * ros_message)
+{
+  size_t i;
+  for (i = 0; i < filter->size; ++i) {
+    const rcl_content_filter_condition_t * condition = &filter->conditions[i];
+    int comparison = __compare(condition, (const char *)ros_message + condition->offset);
+    bool holds;
+    switch (condition->op) {
+      case RCL_CONTENT_FILTER_EQUAL:
+        holds = comparison == 0;
+        break;
+      case RCL_CONTENT_FILTER_NOT_EQUAL:
+        holds = comparison != 0;
+        break;
+      case RCL_CONTENT_FILTER_LESS:
+        holds = comparison == -1;
+        break;
+      case RCL_CONTENT_FILTER_LESS_EQUAL:
+        holds = comparison == -1 || comparison == 0;
+        break;
+      case RCL_CONTENT_FILTER_GREATER:
+        holds = comparison == 1;
+        break;
+      default:
+        holds = comparison == 1 || comparison == 0;
+        break;
+    }
+    if (!holds) {
+      rcl_atomic_fetch_add_uint64_t(&filter->filtered_count, 1);
+      return false;
+    }
+  }
+  return true;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,77 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__CONTENT_FILTER_H_
+#define RCL__CONTENT_FILTER_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/subscription.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// Content filter of a subscription, with its own copy of the conditions.
+typedef struct rcl_content_filter_t
+{
+  /// Conditions, with the string values copied, or NULL if the filter is disabled.
+  rcl_content_filter_condition_t * conditions;
+  size_t size;
+  rcl_allocator_t allocator;
+  /// Number of messages which did not meet the conditions.
+  atomic_uint_least64_t filtered_count;
+} rcl_content_filter_t;
+
+/// Return a rcl_content_filter_t which accepts every message.
+rcl_content_filter_t
+rcl_impl_get_zero_initialized_content_filter(void);
+
+/// Validate the conditions and copy them into the filter.
+/* A size of 0 leaves the filter disabled.
+ *
+ * \return RCL_RET_OK if the filter was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any of the conditions are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_content_filter_init(
+  rcl_content_filter_t * filter,
+  const rcl_content_filter_condition_t * conditions,
+  size_t size,
+  rcl_allocator_t allocator);
+
+/// Free the copy of the conditions.
+void
+rcl_impl_content_filter_fini(rcl_content_filter_t * filter);
+
+/// Return true if the message meets all conditions, otherwise count it as filtered.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+bool
+rcl_impl_content_filter_accept(rcl_content_filter_t * filter, const void * ros_message);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__CONTENT_FILTER_H_
@@ -0,0 +1,91 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/error_handling.h"
+
+#include "rcl/macros.h"
+
+// The last error set with a literal message, which has not been handed to rmw yet.
+static RCL_THREAD_LOCAL const char * __literal_error_msg = NULL;
+static RCL_THREAD_LOCAL const char * __literal_error_file = NULL;
+static RCL_THREAD_LOCAL size_t __literal_error_line_number = 0;
+
+static void
+__format_literal_error(void)
+{
+  if (!__literal_error_msg) {
+    return;
+  }
+  const char * error_msg = __literal_error_msg;
+  __literal_error_msg = NULL;
+  rmw_set_error_state(error_msg, __literal_error_file, __literal_error_line_number);
+}
+
+void
+rcl_set_error_state(const char * error_msg, const char * file, size_t line_number)
+{
+  __literal_error_msg = NULL;
+  rmw_set_error_state(error_msg, file, line_number);
+}
+
+void
+rcl_set_error_state_literal(const char * error_msg, const char * file, size_t line_number)
+{
+  __literal_error_msg = error_msg;
+  __literal_error_file = file;
+  __literal_error_line_number = line_number;
+}
+
+bool
+rcl_error_is_set(void)
+{
+  return __literal_error_msg || rmw_error_is_set();
+}
+
+const rcl_error_state_t *
+rcl_get_error_state(void)
+{
+  __format_literal_error();
+  return rmw_get_error_state();
+}
+
+const char *
+rcl_get_error_string(void)
+{
+  __format_literal_error();
+  return rmw_get_error_string();
+}
+
+const char *
+rcl_get_error_string_safe(void)
+{
+  __format_literal_error();
+  return rmw_get_error_string_safe();
+}
+
+void
+rcl_reset_error(void)
+{
+  __literal_error_msg = NULL;
+  rmw_reset_error();
+}
+
+#if __cplusplus
+}
+#endif
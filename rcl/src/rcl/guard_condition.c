@@ -20,6 +20,7 @@ extern "C"
 #include "rcl/guard_condition.h"
 
 #include "./common.h"
+#include "./stdatomic_helper.h"
 #include "rcl/rcl.h"
 #include "rmw/rmw.h"
 
@@ -27,6 +28,12 @@ typedef struct rcl_guard_condition_impl_t
 {
   rmw_guard_condition_t * rmw_handle;
   rcl_guard_condition_options_t options;
+  // Protects the callback members, only held while reading or changing them.
+  atomic_bool callback_lock;
+  rcl_event_callback_t on_trigger_callback;
+  const void * user_data;
+  // Number of triggers while no callback was set, which were not reported by rcl_wait() yet.
+  size_t unread_count;
 } rcl_guard_condition_impl_t;
 
 rcl_guard_condition_t
@@ -50,14 +57,14 @@ rcl_guard_condition_init(
     allocator->deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
   // Ensure the guard_condition handle is zero initialized.
   if (guard_condition->impl) {
-    RCL_SET_ERROR_MSG("guard_condition already initialized, or memory was unintialized");
+    RCL_SET_ERROR_MSG_LITERAL("guard_condition already initialized, or memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
   // Allocate space for the guard condition impl.
   guard_condition->impl = (rcl_guard_condition_impl_t *)allocator->allocate(
     sizeof(rcl_guard_condition_impl_t), allocator->state);
   if (!guard_condition->impl) {
-    RCL_SET_ERROR_MSG("allocating memory failed");
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
     return RCL_RET_BAD_ALLOC;
   }
   // Create the rmw guard condition.
@@ -70,6 +77,10 @@ rcl_guard_condition_init(
   }
   // Copy options into impl.
   guard_condition->impl->options = options;
+  atomic_init(&guard_condition->impl->callback_lock, false);
+  guard_condition->impl->on_trigger_callback = NULL;
+  guard_condition->impl->user_data = NULL;
+  guard_condition->impl->unread_count = 0;
   return RCL_RET_OK;
 }
 
@@ -90,7 +101,7 @@ rcl_guard_condition_fini(rcl_guard_condition_t * guard_condition)
     if (allocator.deallocate) {
       allocator.deallocate(guard_condition->impl, allocator.state);
     } else {
-      RCL_SET_ERROR_MSG("deallocate not set");
+      RCL_SET_ERROR_MSG_LITERAL("deallocate not set");
       result = RCL_RET_ERROR;
     }
   }
@@ -119,9 +130,57 @@ rcl_trigger_guard_condition(const rcl_guard_condition_t * guard_condition)
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
     return RCL_RET_ERROR;
   }
+  rcl_guard_condition_impl_t * impl = guard_condition->impl;
+  rcl_atomic_spin_lock(&impl->callback_lock);
+  rcl_event_callback_t callback = impl->on_trigger_callback;
+  const void * user_data = impl->user_data;
+  if (!callback) {
+    ++impl->unread_count;
+  }
+  rcl_atomic_spin_unlock(&impl->callback_lock);
+  // The callback is called without the lock, so that it may use the guard condition itself.
+  if (callback) {
+    callback(user_data, 1);
+  }
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_guard_condition_set_on_trigger_callback(
+  const rcl_guard_condition_t * guard_condition,
+  rcl_event_callback_t callback,
+  const void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(guard_condition, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    guard_condition->impl,
+    "guard condition implementation is invalid",
+    return RCL_RET_INVALID_ARGUMENT);
+  rcl_guard_condition_impl_t * impl = guard_condition->impl;
+  rcl_atomic_spin_lock(&impl->callback_lock);
+  impl->on_trigger_callback = callback;
+  impl->user_data = user_data;
+  size_t unread_count = 0;
+  if (callback) {
+    unread_count = impl->unread_count;
+    impl->unread_count = 0;
+  }
+  rcl_atomic_spin_unlock(&impl->callback_lock);
+  if (unread_count) {
+    callback(user_data, unread_count);
+  }
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_guard_condition_clear_unread_count(const rcl_guard_condition_t * guard_condition)
+{
+  rcl_guard_condition_impl_t * impl = guard_condition->impl;
+  rcl_atomic_spin_lock(&impl->callback_lock);
+  impl->unread_count = 0;
+  rcl_atomic_spin_unlock(&impl->callback_lock);
+}
+
 rmw_guard_condition_t *
 rcl_guard_condition_get_rmw_handle(const rcl_guard_condition_t * guard_condition)
 {
@@ -0,0 +1,486 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./intra_process.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "rmw/rmw.h"
+
+#include "./common.h"
+
+// Number of guard conditions a publisher triggers after each pass over the subscriptions.
+#define RCL_INTRA_PROCESS_TRIGGER_BATCH_SIZE 16
+
+struct rcl_intra_process_topic_t
+{
+  // Copy of the topic name, allocated along with the entry.
+  char * name;
+  const rosidl_message_type_support_t * type_support;
+  // Number of publishers and subscriptions registered with the topic, protected by
+  // __registry_lock.
+  size_t reference_count;
+  // Protects the publishers and subscriptions, only held while walking or changing them.
+  atomic_bool lock;
+  rcl_intra_process_publisher_t * publishers;
+  // Subscriptions of the topic, by increasing registration id.
+  rcl_intra_process_subscription_t ** subscriptions;
+  size_t subscription_count;
+  size_t subscription_capacity;
+  // Given to the next subscription of the topic.
+  uint64_t next_registration_id;
+  // Next topic in the registry, protected by __registry_lock.
+  struct rcl_intra_process_topic_t * next;
+};
+
+// Protects __topics, only held while looking up, adding or removing topics.
+static atomic_bool __registry_lock = ATOMIC_VAR_INIT(false);
+static rcl_intra_process_topic_t * __topics = NULL;
+
+rcl_ret_t
+rcl_impl_intra_process_queue_init(
+  rcl_intra_process_queue_t * queue,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(queue, RCL_RET_INVALID_ARGUMENT);
+  if (capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("intra-process queue capacity must be greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  // The cell index is computed with a mask, so use at least two cells and a power of two.
+  size_t rounded_capacity = 2;
+  while (rounded_capacity < capacity) {
+    if (rounded_capacity > SIZE_MAX / 2 / sizeof(rcl_intra_process_queue_cell_t)) {
+      RCL_SET_ERROR_MSG_LITERAL("intra-process queue capacity is too large");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+    rounded_capacity *= 2;
+  }
+  queue->cells = (rcl_intra_process_queue_cell_t *)allocator.allocate(
+    sizeof(rcl_intra_process_queue_cell_t) * rounded_capacity, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    queue->cells, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  size_t i;
+  for (i = 0; i < rounded_capacity; ++i) {
+    atomic_init(&queue->cells[i].sequence, i);
+    queue->cells[i].message = NULL;
+    queue->cells[i].pool = NULL;
+    queue->cells[i].stamp.source_timestamp = 0;
+    queue->cells[i].stamp.sequence_number = 0;
+  }
+  queue->mask = rounded_capacity - 1;
+  queue->capacity = capacity;
+  atomic_init(&queue->enqueue_position, 0);
+  atomic_init(&queue->dequeue_position, 0);
+  queue->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_intra_process_queue_fini(rcl_intra_process_queue_t * queue)
+{
+  if (queue->cells) {
+    queue->allocator.deallocate(queue->cells, queue->allocator.state);
+    queue->cells = NULL;
+  }
+}
+
+bool
+rcl_impl_intra_process_queue_enqueue(
+  rcl_intra_process_queue_t * queue,
+  const void * message,
+  rcl_message_pool_t * pool,
+  const rcl_intra_process_stamp_t * stamp)
+{
+  rcl_intra_process_queue_cell_t * cell;
+  uint64_t position = rcl_atomic_load_uint64_t(&queue->enqueue_position);
+  for (;;) {
+    cell = &queue->cells[position & queue->mask];
+    uint64_t sequence = rcl_atomic_load_uint64_t(&cell->sequence);
+    int64_t difference = (int64_t)(sequence - position);
+    if (difference == 0) {
+      if (position - rcl_atomic_load_uint64_t(&queue->dequeue_position) >= queue->capacity) {
+        // There may be more cells than the capacity, which is the limit.
+        return false;
+      }
+      // The cell is free for this position, try to claim it.
+      if (rcl_atomic_compare_exchange_strong_uint_least64_t(
+          &queue->enqueue_position, &position, position + 1))
+      {
+        break;
+      }
+    } else if (difference < 0) {
+      // The cell still holds a message from the previous lap, the queue is full.
+      return false;
+    } else {
+      position = rcl_atomic_load_uint64_t(&queue->enqueue_position);
+    }
+  }
+  cell->message = message;
+  cell->pool = pool;
+  cell->stamp = *stamp;
+  rcl_atomic_store(&cell->sequence, position + 1);
+  return true;
+}
+
+bool
+rcl_impl_intra_process_queue_dequeue(
+  rcl_intra_process_queue_t * queue,
+  const void ** message,
+  rcl_message_pool_t ** pool,
+  rcl_intra_process_stamp_t * stamp)
+{
+  rcl_intra_process_queue_cell_t * cell;
+  uint64_t position = rcl_atomic_load_uint64_t(&queue->dequeue_position);
+  for (;;) {
+    cell = &queue->cells[position & queue->mask];
+    uint64_t sequence = rcl_atomic_load_uint64_t(&cell->sequence);
+    int64_t difference = (int64_t)(sequence - (position + 1));
+    if (difference == 0) {
+      // The cell is full for this position, try to claim it.
+      if (rcl_atomic_compare_exchange_strong_uint_least64_t(
+          &queue->dequeue_position, &position, position + 1))
+      {
+        break;
+      }
+    } else if (difference < 0) {
+      // No message has been written to the cell yet, the queue is empty.
+      return false;
+    } else {
+      position = rcl_atomic_load_uint64_t(&queue->dequeue_position);
+    }
+  }
+  *message = cell->message;
+  *pool = cell->pool;
+  if (stamp) {
+    *stamp = cell->stamp;
+  }
+  // Make the cell available to the producers on the next lap.
+  rcl_atomic_store(&cell->sequence, position + queue->mask + 1);
+  return true;
+}
+
+// Find the topic with the name and type support, must be called with __registry_lock held.
+static rcl_intra_process_topic_t *
+__find_topic(const char * topic_name, const rosidl_message_type_support_t * type_support)
+{
+  rcl_intra_process_topic_t * topic;
+  for (topic = __topics; topic; topic = topic->next) {
+    if (topic->type_support == type_support && strcmp(topic->name, topic_name) == 0) {
+      return topic;
+    }
+  }
+  return NULL;
+}
+
+// Find or add the topic with the name and type support, and take a reference to it.
+static rcl_ret_t
+__acquire_topic(
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support,
+  rcl_intra_process_topic_t ** topic)
+{
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_intra_process_topic_t * created = NULL;
+  rcl_atomic_spin_lock(&__registry_lock);
+  rcl_intra_process_topic_t * found = __find_topic(topic_name, type_support);
+  if (!found) {
+    // Allocate without holding the lock, then look again since another thread may have added it.
+    rcl_atomic_spin_unlock(&__registry_lock);
+    size_t name_size = strlen(topic_name) + 1;
+    created = (rcl_intra_process_topic_t *)allocator.allocate(
+      sizeof(rcl_intra_process_topic_t) + name_size, allocator.state);
+    if (!created) {
+      RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+      return RCL_RET_BAD_ALLOC;
+    }
+    created->name = (char *)(created + 1);
+    memcpy(created->name, topic_name, name_size);
+    created->type_support = type_support;
+    created->reference_count = 0;
+    atomic_init(&created->lock, false);
+    created->publishers = NULL;
+    created->subscriptions = NULL;
+    created->subscription_count = 0;
+    created->subscription_capacity = 0;
+    created->next_registration_id = 0;
+    rcl_atomic_spin_lock(&__registry_lock);
+    found = __find_topic(topic_name, type_support);
+    if (!found) {
+      created->next = __topics;
+      __topics = created;
+      found = created;
+      created = NULL;
+    }
+  }
+  ++found->reference_count;
+  rcl_atomic_spin_unlock(&__registry_lock);
+  if (created) {
+    allocator.deallocate(created, allocator.state);
+  }
+  *topic = found;
+  return RCL_RET_OK;
+}
+
+// Give up a reference to the topic, and remove it from the registry after the last one.
+static void
+__release_topic(rcl_intra_process_topic_t * topic)
+{
+  rcl_atomic_spin_lock(&__registry_lock);
+  bool unused = --topic->reference_count == 0;
+  if (unused) {
+    rcl_intra_process_topic_t ** it = &__topics;
+    while (*it != topic) {
+      it = &(*it)->next;
+    }
+    *it = topic->next;
+  }
+  rcl_atomic_spin_unlock(&__registry_lock);
+  if (unused) {
+    rcl_allocator_t allocator = rcl_get_default_allocator();
+    if (topic->subscriptions) {
+      allocator.deallocate(topic->subscriptions, allocator.state);
+    }
+    allocator.deallocate(topic, allocator.state);
+  }
+}
+
+// Return the index of the first subscription of the topic with at least the registration id,
+// must be called with the lock of the topic held.
+static size_t
+__lower_bound_subscription(const rcl_intra_process_topic_t * topic, uint64_t registration_id)
+{
+  size_t first = 0;
+  size_t last = topic->subscription_count;
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (topic->subscriptions[middle]->registration_id < registration_id) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return first;
+}
+
+rcl_ret_t
+rcl_impl_intra_process_register_publisher(
+  rcl_intra_process_publisher_t * publisher,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support)
+{
+  rcl_intra_process_topic_t * topic;
+  rcl_ret_t ret = __acquire_topic(topic_name, type_support, &topic);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_atomic_spin_lock(&topic->lock);
+  publisher->next = topic->publishers;
+  topic->publishers = publisher;
+  publisher->topic = topic;
+  rcl_atomic_spin_unlock(&topic->lock);
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_intra_process_unregister_publisher(rcl_intra_process_publisher_t * publisher)
+{
+  rcl_intra_process_topic_t * topic = publisher->topic;
+  rcl_atomic_spin_lock(&topic->lock);
+  rcl_intra_process_publisher_t ** it = &topic->publishers;
+  while (*it != publisher) {
+    it = &(*it)->next;
+  }
+  *it = publisher->next;
+  rcl_atomic_spin_unlock(&topic->lock);
+  publisher->topic = NULL;
+  publisher->next = NULL;
+  __release_topic(topic);
+}
+
+rcl_ret_t
+rcl_impl_intra_process_register_subscription(rcl_intra_process_subscription_t * subscription)
+{
+  atomic_init(&subscription->trigger_holds, 0);
+  rcl_intra_process_topic_t * topic;
+  rcl_ret_t ret = __acquire_topic(subscription->topic_name, subscription->type_support, &topic);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_allocator_t allocator = rcl_get_default_allocator();
+  rcl_atomic_spin_lock(&topic->lock);
+  while (topic->subscription_count == topic->subscription_capacity) {
+    // Grow the subscriptions without holding the lock, unless another thread already did.
+    size_t capacity = topic->subscription_capacity;
+    rcl_atomic_spin_unlock(&topic->lock);
+    size_t grown_capacity = capacity ? capacity * 2 : 4;
+    rcl_intra_process_subscription_t ** unused =
+      (rcl_intra_process_subscription_t **)allocator.allocate(
+      sizeof(rcl_intra_process_subscription_t *) * grown_capacity, allocator.state);
+    if (!unused) {
+      RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+      __release_topic(topic);
+      return RCL_RET_BAD_ALLOC;
+    }
+    rcl_atomic_spin_lock(&topic->lock);
+    if (topic->subscription_capacity == capacity) {
+      rcl_intra_process_subscription_t ** grown = unused;
+      if (topic->subscription_count > 0) {
+        memcpy(
+          grown, topic->subscriptions,
+          sizeof(rcl_intra_process_subscription_t *) * topic->subscription_count);
+      }
+      unused = topic->subscriptions;
+      topic->subscriptions = grown;
+      topic->subscription_capacity = grown_capacity;
+    }
+    rcl_atomic_spin_unlock(&topic->lock);
+    if (unused) {
+      allocator.deallocate(unused, allocator.state);
+    }
+    rcl_atomic_spin_lock(&topic->lock);
+  }
+  subscription->registration_id = topic->next_registration_id++;
+  topic->subscriptions[topic->subscription_count++] = subscription;
+  subscription->topic = topic;
+  rcl_atomic_spin_unlock(&topic->lock);
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_intra_process_unregister_subscription(rcl_intra_process_subscription_t * subscription)
+{
+  rcl_intra_process_topic_t * topic = subscription->topic;
+  rcl_atomic_spin_lock(&topic->lock);
+  size_t index = __lower_bound_subscription(topic, subscription->registration_id);
+  memmove(
+    &topic->subscriptions[index], &topic->subscriptions[index + 1],
+    sizeof(rcl_intra_process_subscription_t *) * (topic->subscription_count - index - 1));
+  --topic->subscription_count;
+  rcl_atomic_spin_unlock(&topic->lock);
+  // No new holds can be taken once the subscription left the topic.
+  while (rcl_atomic_load_uint64_t(&subscription->trigger_holds) > 0) {
+    // Wait for the publishers to be done with the guard condition, without starving them.
+    rcl_impl_yield_thread();
+  }
+  subscription->topic = NULL;
+  __release_topic(topic);
+}
+
+// Trigger the guard conditions of the subscriptions and give up the holds on them.
+static rcl_ret_t
+__trigger_subscriptions(rcl_intra_process_subscription_t ** subscriptions, size_t count)
+{
+  rcl_ret_t result = RCL_RET_OK;
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    if (rcl_trigger_guard_condition(&subscriptions[i]->guard_condition) != RCL_RET_OK) {
+      result = RCL_RET_ERROR;  // rcl error state should already be set.
+    }
+    rcl_atomic_fetch_sub_uint64_t(&subscriptions[i]->trigger_holds, 1);
+  }
+  return result;
+}
+
+rcl_ret_t
+rcl_impl_intra_process_publish(
+  rcl_intra_process_topic_t * topic,
+  rcl_message_pool_t * pool,
+  const void * message,
+  const rcl_intra_process_stamp_t * stamp,
+  size_t * delivered_count)
+{
+  rcl_ret_t result = RCL_RET_OK;
+  *delivered_count = 0;
+  // The subscriptions are delivered to in batches, each under the lock of the topic, and their
+  // guard conditions are triggered without it.
+  // Registration ids only grow along the subscriptions, which tells where the next batch starts.
+  uint64_t resume_id = 0;
+  rcl_ret_t trigger_result = RCL_RET_OK;
+  bool done = false;
+  while (!done) {
+    rcl_intra_process_subscription_t * batch[RCL_INTRA_PROCESS_TRIGGER_BATCH_SIZE];
+    size_t batch_size = 0;
+    rcl_atomic_spin_lock(&topic->lock);
+    size_t i = __lower_bound_subscription(topic, resume_id);
+    for (; i < topic->subscription_count && batch_size < RCL_INTRA_PROCESS_TRIGGER_BATCH_SIZE;
+      ++i)
+    {
+      rcl_intra_process_subscription_t * subscription = topic->subscriptions[i];
+      resume_id = subscription->registration_id + 1;
+      if (rcl_impl_message_pool_retain(pool, message) != RCL_RET_OK) {
+        result = RCL_RET_ERROR;  // rcl error state should already be set.
+        break;
+      }
+      if (!rcl_impl_intra_process_queue_enqueue(&subscription->queue, message, pool, stamp)) {
+        // The subscription is not keeping up, drop the newest message rather than block.
+        if (rcl_impl_message_pool_release(pool, message) != RCL_RET_OK) {
+          result = RCL_RET_ERROR;  // rcl error state should already be set.
+          break;
+        }
+        continue;
+      }
+      ++(*delivered_count);
+      // The hold keeps the subscription from being finalized until it has been triggered.
+      rcl_atomic_fetch_add_uint64_t(&subscription->trigger_holds, 1);
+      batch[batch_size++] = subscription;
+    }
+    done = i >= topic->subscription_count;
+    rcl_atomic_spin_unlock(&topic->lock);
+    if (result != RCL_RET_OK) {
+      done = true;  // A message pool error, the remaining subscriptions are not delivered to.
+    }
+    if (__trigger_subscriptions(batch, batch_size) != RCL_RET_OK) {
+      trigger_result = RCL_RET_ERROR;
+    }
+  }
+  return result != RCL_RET_OK ? result : trigger_result;
+}
+
+bool
+rcl_impl_intra_process_is_duplicate(
+  const rcl_intra_process_subscription_t * subscription,
+  const rmw_gid_t * publisher_gid)
+{
+  rcl_intra_process_topic_t * topic = subscription->topic;
+  bool duplicate = false;
+  rcl_atomic_spin_lock(&topic->lock);
+  rcl_intra_process_publisher_t * publisher;
+  for (publisher = topic->publishers; publisher && !duplicate; publisher = publisher->next) {
+    // Gids of another middleware cannot be compared, and cannot be one of ours either.
+    if (publisher->gid.implementation_identifier != publisher_gid->implementation_identifier) {
+      continue;
+    }
+    if (rmw_compare_gids_equal(&publisher->gid, publisher_gid, &duplicate) != RMW_RET_OK) {
+      duplicate = false;  // Rather take the message twice than lose it.
+    }
+  }
+  rcl_atomic_spin_unlock(&topic->lock);
+  return duplicate;
+}
+
+#if __cplusplus
+}
+#endif
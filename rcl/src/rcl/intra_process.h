@@ -0,0 +1,263 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__INTRA_PROCESS_H_
+#define RCL__INTRA_PROCESS_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmw/types.h"
+#include "rosidl_generator_c/message_type_support.h"
+
+#include "rcl/allocator.h"
+#include "rcl/guard_condition.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+#include "./message_pool.h"
+#include "./stdatomic_helper.h"
+
+/// When and in which order a publisher sent an intra-process message.
+typedef struct rcl_intra_process_stamp_t
+{
+  /// Steady time at which the message was published, or 0 if unknown.
+  rcl_time_point_value_t source_timestamp;
+  /// Number of intra-process messages sent by the publisher so far, including this one.
+  uint64_t sequence_number;
+} rcl_intra_process_stamp_t;
+
+/// One slot of a rcl_intra_process_queue_t.
+typedef struct rcl_intra_process_queue_cell_t
+{
+  /// Position in the queue this cell is ready for, used to hand the cell over.
+  atomic_uint_least64_t sequence;
+  /// Message in the cell, a lent message of pool.
+  const void * message;
+  /// Pool which lent the message, used to release it.
+  rcl_message_pool_t * pool;
+  rcl_intra_process_stamp_t stamp;
+} rcl_intra_process_queue_cell_t;
+
+/// Bounded multi-producer multi-consumer queue of lent messages.
+/* The queue is lock-free, each cell carries a sequence number which tells
+ * producers and consumers whether it is free or full for their position.
+ * The number of cells is the capacity rounded up to a power of two.
+ */
+typedef struct rcl_intra_process_queue_t
+{
+  rcl_intra_process_queue_cell_t * cells;
+  /// Number of cells minus one.
+  size_t mask;
+  /// Number of messages the queue holds at most, which may be less than the number of cells.
+  size_t capacity;
+  atomic_uint_least64_t enqueue_position;
+  atomic_uint_least64_t dequeue_position;
+  rcl_allocator_t allocator;
+} rcl_intra_process_queue_t;
+
+/// Registry entry of a topic, which resolves its subscriptions for the publishers.
+/* Entries are keyed by topic name and type support, and live as long as a
+ * publisher or subscription is registered with them.
+ */
+typedef struct rcl_intra_process_topic_t rcl_intra_process_topic_t;
+
+/// Intra-process endpoint of a publisher, registered in the process wide registry.
+typedef struct rcl_intra_process_publisher_t
+{
+  /// Identifies the copies of intra-process messages which the publisher sent to the middleware.
+  rmw_gid_t gid;
+  /// Registry entry of the topic, or NULL while the publisher is not registered.
+  rcl_intra_process_topic_t * topic;
+  /// Next publisher of the topic.
+  struct rcl_intra_process_publisher_t * next;
+} rcl_intra_process_publisher_t;
+
+/// Intra-process endpoint of a subscription, registered in the process wide registry.
+typedef struct rcl_intra_process_subscription_t
+{
+  /// Topic name of the subscription, owned by the subscription.
+  const char * topic_name;
+  /// Type support of the subscription, matched by pointer with the publishers.
+  const rosidl_message_type_support_t * type_support;
+  /// Messages which have been delivered but not yet taken.
+  rcl_intra_process_queue_t queue;
+  /// Triggered each time a message is delivered.
+  rcl_guard_condition_t guard_condition;
+  /// Order in which the subscription was registered, increasing along the topic.
+  uint64_t registration_id;
+  /// Number of publishers which are about to trigger the guard condition.
+  atomic_uint_least64_t trigger_holds;
+  /// Registry entry of the topic, or NULL while the subscription is not registered.
+  rcl_intra_process_topic_t * topic;
+} rcl_intra_process_subscription_t;
+
+/// Allocate the cells of a queue which can hold at least capacity messages.
+/* \return RCL_RET_OK if the queue was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_intra_process_queue_init(
+  rcl_intra_process_queue_t * queue,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Free the cells of the queue, without releasing the messages still in it.
+void
+rcl_impl_intra_process_queue_fini(rcl_intra_process_queue_t * queue);
+
+/// Add a message to the queue, or return false if the queue is full.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+bool
+rcl_impl_intra_process_queue_enqueue(
+  rcl_intra_process_queue_t * queue,
+  const void * message,
+  rcl_message_pool_t * pool,
+  const rcl_intra_process_stamp_t * stamp);
+
+/// Remove the oldest message from the queue, or return false if the queue is empty.
+/* The stamp of the message is copied to stamp, unless it is NULL.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+bool
+rcl_impl_intra_process_queue_dequeue(
+  rcl_intra_process_queue_t * queue,
+  const void ** message,
+  rcl_message_pool_t ** pool,
+  rcl_intra_process_stamp_t * stamp);
+
+/// Add a publisher to the process wide registry, and look up the entry of its topic.
+/* The entry is looked up once here, so publishing does not have to match the
+ * topic name against each subscription.
+ * The registry allocates its entries with the default allocator, since they
+ * are shared by all publishers and subscriptions of the process.
+ *
+ * The gid of the publisher must be set before calling this function.
+ *
+ * This function allocates heap memory the first time a topic is registered.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the registry lock and the lock of the topic.
+ *
+ * \param[inout] publisher the publisher, whose topic is set
+ * \param[in] topic_name the name of the topic of the publisher
+ * \param[in] type_support the type support of the publisher
+ * \return RCL_RET_OK if the publisher was registered, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_intra_process_register_publisher(
+  rcl_intra_process_publisher_t * publisher,
+  const char * topic_name,
+  const rosidl_message_type_support_t * type_support);
+
+/// Remove a publisher from the process wide registry.
+/* The entry of the topic is deallocated once nothing is registered with it.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the registry lock and the lock of the topic.
+ */
+void
+rcl_impl_intra_process_unregister_publisher(rcl_intra_process_publisher_t * publisher);
+
+/// Add the subscription to the process wide registry.
+/* The topic name, type support, queue and guard condition of the subscription
+ * must be initialized before calling this function.
+ *
+ * This function allocates heap memory when the topic has no room for another subscription.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the registry lock and the lock of the topic.
+ *
+ * \return RCL_RET_OK if the subscription was registered, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_intra_process_register_subscription(rcl_intra_process_subscription_t * subscription);
+
+/// Remove the subscription from the process wide registry.
+/* After this function returns no more messages are delivered to the
+ * subscription, but messages may still be in its queue.
+ * If a publisher is still triggering the guard condition of the subscription,
+ * this function waits for it to finish, yielding the thread in between.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the registry lock and the lock of the topic.
+ */
+void
+rcl_impl_intra_process_unregister_subscription(rcl_intra_process_subscription_t * subscription);
+
+/// Deliver a lent message to each subscription registered with the topic.
+/* Each subscription which receives the message holds its own reference to it.
+ * If the queue of a subscription is full, the message is dropped for that
+ * subscription.
+ *
+ * The guard conditions of the subscriptions are triggered after the lock of
+ * the topic is released, since triggering them may call user callbacks.
+ *
+ * This function does not allocate heap memory, but can on errors.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the lock of the topic.
+ *
+ * \param[in] topic the registry entry of the topic of the publisher
+ * \param[in] pool the pool which lent the message
+ * \param[in] message the lent message
+ * \param[in] stamp the source time and sequence number given to each subscription
+ * \param[out] delivered_count the number of subscriptions which got the message
+ * \return RCL_RET_OK if the message was delivered to all matching subscriptions, or
+ *         RCL_RET_ERROR if triggering a guard condition failed.
+ */
+rcl_ret_t
+rcl_impl_intra_process_publish(
+  rcl_intra_process_topic_t * topic,
+  rcl_message_pool_t * pool,
+  const void * message,
+  const rcl_intra_process_stamp_t * stamp,
+  size_t * delivered_count);
+
+/// Return true if a middleware message was also delivered to the subscription intra-process.
+/* Publishers send the middleware copy of their intra-process messages with a
+ * gid of their own, so a message with the gid of a publisher registered with
+ * the topic of the subscription has already been delivered intra-process, or
+ * was dropped by the full queue of the subscription.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is not lock-free, it spins on the lock of the topic.
+ *
+ * \param[in] subscription a registered subscription
+ * \param[in] publisher_gid the gid of the publisher of the middleware message
+ */
+bool
+rcl_impl_intra_process_is_duplicate(
+  const rcl_intra_process_subscription_t * subscription,
+  const rmw_gid_t * publisher_gid);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__INTRA_PROCESS_H_
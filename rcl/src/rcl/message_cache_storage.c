@@ -0,0 +1,206 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./message_cache_storage.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "./common.h"
+
+rcl_message_cache_t
+rcl_impl_get_zero_initialized_message_cache()
+{
+  static rcl_message_cache_t null_cache = {0};
+  return null_cache;
+}
+
+rcl_ret_t
+rcl_impl_message_cache_init(
+  rcl_message_cache_t * cache,
+  size_t capacity,
+  size_t message_size,
+  uint64_t duration_ns,
+  rcl_message_copy_function_t message_copy,
+  rcl_message_fini_function_t message_fini,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(cache, RCL_RET_INVALID_ARGUMENT);
+  if (capacity == 0 || message_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("message cache depth and message size must be greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (message_fini && !message_copy) {
+    RCL_SET_ERROR_MSG_LITERAL("a message cache fini function requires a copy function");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (message_size > SIZE_MAX / capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("message cache is too large");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  cache->storage = (char *)allocator.allocate(message_size * capacity, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    cache->storage, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  cache->receive_times = (rcl_time_point_value_t *)allocator.allocate(
+    sizeof(rcl_time_point_value_t) * capacity, allocator.state);
+  if (!cache->receive_times) {
+    allocator.deallocate(cache->storage, allocator.state);
+    cache->storage = NULL;
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  // The copy function expects zero initialized storage.
+  memset(cache->storage, 0, message_size * capacity);
+  cache->message_size = message_size;
+  cache->capacity = capacity;
+  cache->duration_ns = duration_ns;
+  cache->message_copy = message_copy;
+  cache->message_fini = message_fini;
+  cache->head = 0;
+  cache->size = 0;
+  cache->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+static size_t
+__slot(const rcl_message_cache_t * cache, size_t index)
+{
+  return (cache->head + index) % cache->capacity;
+}
+
+// Drop the count oldest messages, finalizing them and zeroing their slots for the next copy.
+static void
+__drop_oldest(rcl_message_cache_t * cache, size_t count)
+{
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    char * message = cache->storage + cache->head * cache->message_size;
+    if (cache->message_fini) {
+      cache->message_fini(message);
+    }
+    if (cache->message_copy) {
+      memset(message, 0, cache->message_size);
+    }
+    cache->head = __slot(cache, 1);
+    --cache->size;
+  }
+}
+
+void
+rcl_impl_message_cache_fini(rcl_message_cache_t * cache)
+{
+  if (cache->storage) {
+    __drop_oldest(cache, cache->size);
+    cache->allocator.deallocate(cache->storage, cache->allocator.state);
+  }
+  if (cache->receive_times) {
+    cache->allocator.deallocate(cache->receive_times, cache->allocator.state);
+  }
+  *cache = rcl_impl_get_zero_initialized_message_cache();
+}
+
+rcl_ret_t
+rcl_impl_message_cache_insert(
+  rcl_message_cache_t * cache,
+  const void * message,
+  rcl_time_point_value_t receive_time)
+{
+  if (cache->size > 0) {
+    rcl_time_point_value_t newest = cache->receive_times[__slot(cache, cache->size - 1)];
+    if (receive_time < newest) {
+      receive_time = newest;
+    }
+  }
+  if (cache->size == cache->capacity) {
+    __drop_oldest(cache, 1);
+  }
+  size_t slot = __slot(cache, cache->size);
+  char * destination = cache->storage + slot * cache->message_size;
+  if (!cache->message_copy) {
+    memcpy(destination, message, cache->message_size);
+  } else if (!cache->message_copy(message, destination)) {
+    memset(destination, 0, cache->message_size);
+    RCL_SET_ERROR_MSG_LITERAL("copying the message into the cache failed");
+    return RCL_RET_ERROR;
+  }
+  cache->receive_times[slot] = receive_time;
+  ++cache->size;
+  if (cache->duration_ns > 0 && receive_time > cache->duration_ns) {
+    size_t expired = rcl_impl_message_cache_lower_bound(cache, receive_time - cache->duration_ns);
+    __drop_oldest(cache, expired);
+  }
+  return RCL_RET_OK;
+}
+
+size_t
+rcl_impl_message_cache_lower_bound(
+  const rcl_message_cache_t * cache,
+  rcl_time_point_value_t time)
+{
+  size_t low = 0;
+  size_t high = cache->size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (cache->receive_times[__slot(cache, middle)] < time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t
+rcl_impl_message_cache_upper_bound(
+  const rcl_message_cache_t * cache,
+  rcl_time_point_value_t time)
+{
+  size_t low = 0;
+  size_t high = cache->size;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (cache->receive_times[__slot(cache, middle)] <= time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+const void *
+rcl_impl_message_cache_at(
+  const rcl_message_cache_t * cache,
+  size_t index,
+  rcl_time_point_value_t * receive_time)
+{
+  size_t slot = __slot(cache, index);
+  if (receive_time) {
+    *receive_time = cache->receive_times[slot];
+  }
+  return cache->storage + slot * cache->message_size;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,130 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__MESSAGE_CACHE_STORAGE_H_
+#define RCL__MESSAGE_CACHE_STORAGE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+/// Ring of message copies, ordered by the time at which they were received.
+/* The messages are copied into storage which is allocated once, when the
+ * cache is initialized, either byte for byte or with a copy function.
+ * Each slot is zero initialized while it does not hold a message.
+ * Receive times never decrease from the oldest to the newest message, so
+ * messages are looked up by time with a binary search.
+ */
+typedef struct rcl_message_cache_t
+{
+  /// Contiguous storage for all of the messages.
+  char * storage;
+  /// Receive time of the message in each slot.
+  rcl_time_point_value_t * receive_times;
+  /// Size of each message in bytes.
+  size_t message_size;
+  /// Number of messages the cache can hold.
+  size_t capacity;
+  /// Maximum age of a message relative to the newest one, or 0 for no limit.
+  uint64_t duration_ns;
+  /// Function used to copy messages into the slots, or NULL for a shallow copy.
+  rcl_message_copy_function_t message_copy;
+  /// Function used to finalize a copy when it is dropped from the cache, or NULL.
+  rcl_message_fini_function_t message_fini;
+  /// Slot of the oldest message.
+  size_t head;
+  /// Number of cached messages.
+  size_t size;
+  /// Allocator used to allocate the storage and the receive times.
+  rcl_allocator_t allocator;
+} rcl_message_cache_t;
+
+/// Return a rcl_message_cache_t with members set to NULL or 0.
+rcl_message_cache_t
+rcl_impl_get_zero_initialized_message_cache(void);
+
+/// Allocate storage for capacity messages of message_size bytes each.
+/* message_fini must be NULL unless message_copy is set.
+ *
+ * \return RCL_RET_OK if the cache was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_message_cache_init(
+  rcl_message_cache_t * cache,
+  size_t capacity,
+  size_t message_size,
+  uint64_t duration_ns,
+  rcl_message_copy_function_t message_copy,
+  rcl_message_fini_function_t message_fini,
+  rcl_allocator_t allocator);
+
+/// Finalize the cached messages and free the storage of the cache.
+void
+rcl_impl_message_cache_fini(rcl_message_cache_t * cache);
+
+/// Copy a message into the cache as the newest one.
+/* The oldest message is dropped if the cache is full, and messages which are
+ * older than duration_ns relative to the new one are dropped.
+ * A receive time which is older than the newest message's is raised to it,
+ * so the cache stays ordered.
+ *
+ * This function does not allocate heap memory, but the copy function may.
+ *
+ * \return RCL_RET_OK if the message was cached, or
+ *         RCL_RET_ERROR if the copy function failed, in which case the
+ *         message is not cached.
+ */
+rcl_ret_t
+rcl_impl_message_cache_insert(
+  rcl_message_cache_t * cache,
+  const void * message,
+  rcl_time_point_value_t receive_time);
+
+/// Return the number of cached messages received before time.
+/* This is also the index of the first message received at or after time,
+ * with index 0 being the oldest message.
+ * The search takes O(log N) for N cached messages.
+ */
+size_t
+rcl_impl_message_cache_lower_bound(
+  const rcl_message_cache_t * cache,
+  rcl_time_point_value_t time);
+
+/// Return the number of cached messages received at or before time.
+size_t
+rcl_impl_message_cache_upper_bound(
+  const rcl_message_cache_t * cache,
+  rcl_time_point_value_t time);
+
+/// Return the message at index, with index 0 being the oldest, and its receive time.
+const void *
+rcl_impl_message_cache_at(
+  const rcl_message_cache_t * cache,
+  size_t index,
+  rcl_time_point_value_t * receive_time);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__MESSAGE_CACHE_STORAGE_H_
@@ -0,0 +1,238 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./message_pool.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "./common.h"
+
+// Each message is aligned to this, which is enough for any of the message field types.
+#define RCL_MESSAGE_POOL_ALIGNMENT 16
+
+rcl_message_pool_t
+rcl_impl_get_zero_initialized_message_pool()
+{
+  static rcl_message_pool_t null_pool = {0};
+  return null_pool;
+}
+
+rcl_ret_t
+rcl_impl_message_pool_init(
+  rcl_message_pool_t * pool,
+  size_t capacity,
+  size_t message_size,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(pool, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  pool->allocator = allocator;
+  pool->capacity = 0;
+  pool->storage = NULL;
+  pool->ref_counts = NULL;
+  atomic_init(&pool->lifetime_count, 1);
+  pool->allocated = false;
+  if (capacity == 0) {
+    pool->message_size = 0;
+    return RCL_RET_OK;
+  }
+  if (message_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("message size must be greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  pool->message_size =
+    (message_size + RCL_MESSAGE_POOL_ALIGNMENT - 1) & ~((size_t)RCL_MESSAGE_POOL_ALIGNMENT - 1);
+  if (capacity > SIZE_MAX / pool->message_size) {
+    RCL_SET_ERROR_MSG_LITERAL("message pool is too large");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  pool->storage = (char *)allocator.allocate(capacity * pool->message_size, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    pool->storage, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  pool->ref_counts = (atomic_uint_least64_t *)allocator.allocate(
+    sizeof(atomic_uint_least64_t) * capacity, allocator.state);
+  if (!pool->ref_counts) {
+    allocator.deallocate(pool->storage, allocator.state);
+    pool->storage = NULL;
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  memset(pool->storage, 0, capacity * pool->message_size);
+  size_t i;
+  for (i = 0; i < capacity; ++i) {
+    atomic_init(&pool->ref_counts[i], 0);
+  }
+  pool->capacity = capacity;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_message_pool_fini(rcl_message_pool_t * pool)
+{
+  if (!pool) {
+    return;
+  }
+  if (pool->storage) {
+    pool->allocator.deallocate(pool->storage, pool->allocator.state);
+    pool->storage = NULL;
+  }
+  if (pool->ref_counts) {
+    pool->allocator.deallocate(pool->ref_counts, pool->allocator.state);
+    pool->ref_counts = NULL;
+  }
+  pool->capacity = 0;
+}
+
+rcl_ret_t
+rcl_impl_message_pool_create(
+  size_t capacity,
+  size_t message_size,
+  rcl_allocator_t allocator,
+  rcl_message_pool_t ** pool)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(pool, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  rcl_message_pool_t * new_pool =
+    (rcl_message_pool_t *)allocator.allocate(sizeof(rcl_message_pool_t), allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    new_pool, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  *new_pool = rcl_impl_get_zero_initialized_message_pool();
+  rcl_ret_t ret = rcl_impl_message_pool_init(new_pool, capacity, message_size, allocator);
+  if (ret != RCL_RET_OK) {
+    allocator.deallocate(new_pool, allocator.state);
+    return ret;  // rcl error state should already be set.
+  }
+  new_pool->allocated = true;
+  *pool = new_pool;
+  return RCL_RET_OK;
+}
+
+// Drop one hold on the lifetime of the pool, and deallocate an allocated pool after the last one.
+static void
+__message_pool_drop_lifetime(rcl_message_pool_t * pool)
+{
+  uint64_t count = rcl_atomic_fetch_sub_uint64_t(&pool->lifetime_count, 1);
+  if (count == 1 && pool->allocated) {
+    rcl_allocator_t allocator = pool->allocator;
+    rcl_impl_message_pool_fini(pool);
+    allocator.deallocate(pool, allocator.state);
+  }
+}
+
+void
+rcl_impl_message_pool_destroy(rcl_message_pool_t * pool)
+{
+  if (!pool) {
+    return;
+  }
+  __message_pool_drop_lifetime(pool);
+}
+
+void *
+rcl_impl_message_pool_get_message(rcl_message_pool_t * pool, size_t index)
+{
+  return pool->storage + index * pool->message_size;
+}
+
+void *
+rcl_impl_message_pool_acquire(rcl_message_pool_t * pool)
+{
+  size_t i;
+  for (i = 0; i < pool->capacity; ++i) {
+    uint64_t expected = 0;
+    if (rcl_atomic_compare_exchange_strong_uint_least64_t(&pool->ref_counts[i], &expected, 1)) {
+      rcl_atomic_fetch_add_uint64_t(&pool->lifetime_count, 1);
+      return pool->storage + i * pool->message_size;
+    }
+  }
+  return NULL;
+}
+
+// Return the index of the message in the pool, or the capacity if it is not from the pool.
+static size_t
+__message_pool_index(const rcl_message_pool_t * pool, const void * message)
+{
+  const char * position = (const char *)message;
+  if (pool->capacity == 0 || position < pool->storage ||
+    position >= pool->storage + pool->capacity * pool->message_size ||
+    (size_t)(position - pool->storage) % pool->message_size != 0)
+  {
+    return pool->capacity;
+  }
+  return (size_t)(position - pool->storage) / pool->message_size;
+}
+
+bool
+rcl_impl_message_pool_is_lent(rcl_message_pool_t * pool, const void * message)
+{
+  size_t index = __message_pool_index(pool, message);
+  return index < pool->capacity && rcl_atomic_load_uint64_t(&pool->ref_counts[index]) > 0;
+}
+
+rcl_ret_t
+rcl_impl_message_pool_retain(rcl_message_pool_t * pool, const void * message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(message, RCL_RET_INVALID_ARGUMENT);
+  size_t index = __message_pool_index(pool, message);
+  if (index == pool->capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("message was not lent by this pool");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  uint64_t count = rcl_atomic_load_uint64_t(&pool->ref_counts[index]);
+  do {
+    if (count == 0) {
+      RCL_SET_ERROR_MSG_LITERAL("message is not currently lent out");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  } while (!rcl_atomic_compare_exchange_strong_uint_least64_t(
+    &pool->ref_counts[index], &count, count + 1));
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_impl_message_pool_release(rcl_message_pool_t * pool, const void * message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(message, RCL_RET_INVALID_ARGUMENT);
+  size_t index = __message_pool_index(pool, message);
+  if (index == pool->capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("message was not lent by this pool");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (rcl_atomic_load_uint64_t(&pool->ref_counts[index]) == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("message is not currently lent out");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  // Only a holder of the message may release it, so the count cannot drop to zero under us.
+  if (rcl_atomic_fetch_sub_uint64_t(&pool->ref_counts[index], 1) == 1) {
+    // The message went back to the pool, which may have been waiting for it to be deallocated.
+    __message_pool_drop_lifetime(pool);
+  }
+  return RCL_RET_OK;
+}
+
+#if __cplusplus
+}
+#endif
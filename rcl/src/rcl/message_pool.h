@@ -0,0 +1,181 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__MESSAGE_POOL_H_
+#define RCL__MESSAGE_POOL_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// Fixed size pool of storage for messages, used to lend messages to the user.
+/* All of the storage is allocated once, when the pool is initialized.
+ * The pool only hands out raw storage, it does not initialize or finalize
+ * the messages which are placed in it.
+ *
+ * Each message is reference counted, so that a lent message can be shared,
+ * e.g. with intra-process subscriptions, and it only goes back to the pool
+ * once every holder has released it.
+ *
+ * A pool made with rcl_impl_message_pool_create() is itself kept alive by
+ * its lent messages, so that holders in other entities can still release
+ * them after the owner of the pool is gone.
+ */
+typedef struct rcl_message_pool_t
+{
+  /// Contiguous storage for all of the messages, NULL if the pool is empty.
+  char * storage;
+  /// One reference count per message, 0 if the message is not lent out.
+  atomic_uint_least64_t * ref_counts;
+  /// Size of each message in bytes, rounded up for alignment.
+  size_t message_size;
+  /// Number of messages in the pool.
+  size_t capacity;
+  /// Allocator used to allocate the storage and the flags.
+  rcl_allocator_t allocator;
+  /// Number of messages lent out, plus one until the owner is done with the pool.
+  atomic_uint_least64_t lifetime_count;
+  /// True if the pool was allocated by rcl_impl_message_pool_create().
+  bool allocated;
+} rcl_message_pool_t;
+
+/// Return a rcl_message_pool_t with members set to NULL or 0.
+rcl_message_pool_t
+rcl_impl_get_zero_initialized_message_pool(void);
+
+/// Allocate storage for capacity messages of message_size bytes each.
+/* A capacity of 0 is allowed and results in an empty pool, from which
+ * acquiring a message always fails.
+ *
+ * This function is not thread-safe.
+ *
+ * \param[inout] pool zero initialized pool
+ * \param[in] capacity number of messages in the pool
+ * \param[in] message_size size of one message in bytes
+ * \param[in] allocator allocator used for the storage
+ * \return RCL_RET_OK if the pool was initialized successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_message_pool_init(
+  rcl_message_pool_t * pool,
+  size_t capacity,
+  size_t message_size,
+  rcl_allocator_t allocator);
+
+/// Deallocate the storage of the pool, messages which are still lent out become invalid.
+/* This function is not thread-safe. */
+void
+rcl_impl_message_pool_fini(rcl_message_pool_t * pool);
+
+/// Allocate and initialize a pool which lives until its last lent message is released.
+/* The pool is initialized as with rcl_impl_message_pool_init(), and must be
+ * given up with rcl_impl_message_pool_destroy() instead of being finalized.
+ *
+ * This function is not thread-safe.
+ *
+ * \param[in] capacity number of messages in the pool
+ * \param[in] message_size size of one message in bytes
+ * \param[in] allocator allocator used for the pool and its storage
+ * \param[out] pool set to the new pool
+ * \return RCL_RET_OK if the pool was created successfully, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_message_pool_create(
+  size_t capacity,
+  size_t message_size,
+  rcl_allocator_t allocator,
+  rcl_message_pool_t ** pool);
+
+/// Give up the owner's hold on a pool made with rcl_impl_message_pool_create().
+/* The pool is deallocated right away if no message is lent out, otherwise
+ * when the last lent message is released.
+ * The owner must not acquire messages from the pool after this call.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+void
+rcl_impl_message_pool_destroy(rcl_message_pool_t * pool);
+
+/// Return the storage of the message at index, which must be less than the capacity.
+/* This is used to construct or destruct every message of the pool, whether
+ * it is lent out or not.
+ *
+ * This function does not allocate heap memory.
+ */
+void *
+rcl_impl_message_pool_get_message(rcl_message_pool_t * pool, size_t index);
+
+/// Lend a message from the pool, or return NULL if all of them are in use.
+/* The returned message has a reference count of 1.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+void *
+rcl_impl_message_pool_acquire(rcl_message_pool_t * pool);
+
+/// Return true if the message was lent by the pool and has not been given back yet.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+bool
+rcl_impl_message_pool_is_lent(rcl_message_pool_t * pool, const void * message);
+
+/// Add a reference to a message which is currently lent out.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \return RCL_RET_OK if the reference was added, or
+ *         RCL_RET_INVALID_ARGUMENT if the message is not a lent message of this pool.
+ */
+rcl_ret_t
+rcl_impl_message_pool_retain(rcl_message_pool_t * pool, const void * message);
+
+/// Release a reference to a lent message, giving it back to the pool after the last one.
+/* If the pool was destroyed by its owner and this was its last lent message,
+ * the pool is deallocated and must not be used anymore.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \return RCL_RET_OK if the reference was released, or
+ *         RCL_RET_INVALID_ARGUMENT if the message is not a lent message of this pool.
+ */
+rcl_ret_t
+rcl_impl_message_pool_release(rcl_message_pool_t * pool, const void * message);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__MESSAGE_POOL_H_
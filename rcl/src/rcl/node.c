@@ -27,6 +27,7 @@ extern "C"
 #include "rmw/rmw.h"
 
 #include "./common.h"
+#include "./statistics_registry.h"
 
 typedef struct rcl_node_impl_t
 {
@@ -34,6 +35,7 @@ typedef struct rcl_node_impl_t
   rmw_node_t * rmw_node_handle;
   uint64_t rcl_instance_id;
   size_t actual_domain_id;
+  rcl_statistics_registry_t statistics_registry;
 } rcl_node_impl_t;
 
 rcl_node_t
@@ -103,12 +105,12 @@ rcl_node_init(rcl_node_t * node, const char * name, const rcl_node_options_t * o
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (node->impl) {
-    RCL_SET_ERROR_MSG("node already initialized, or struct memory was unintialized");
+    RCL_SET_ERROR_MSG_LITERAL("node already initialized, or struct memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
   // Make sure rcl has been initialized.
   if (!rcl_ok()) {
-    RCL_SET_ERROR_MSG("rcl_init() has not been called");
+    RCL_SET_ERROR_MSG_LITERAL("rcl_init() has not been called");
     return RCL_RET_NOT_INIT;
   }
   const rcl_allocator_t * allocator = &options->allocator;
@@ -123,7 +125,7 @@ rcl_node_init(rcl_node_t * node, const char * name, const rcl_node_options_t * o
   // node name
   size_t name_len = strlen(name);
   if (name_len == 0) {
-    RCL_SET_ERROR_MSG("node name cannot be empty string");
+    RCL_SET_ERROR_MSG_LITERAL("node name cannot be empty string");
     goto fail;
   }
   // node options (assume it is trivially copyable)
@@ -138,7 +140,7 @@ rcl_node_init(rcl_node_t * node, const char * name, const rcl_node_options_t * o
     if (ros_domain_id) {
       unsigned long number = strtoul(ros_domain_id, NULL, 0);  // NOLINT(runtime/int)
       if (number == ULONG_MAX) {
-        RCL_SET_ERROR_MSG("failed to interpret ROS_DOMAIN_ID as integral number");
+        RCL_SET_ERROR_MSG_LITERAL("failed to interpret ROS_DOMAIN_ID as integral number");
         goto fail;
       }
       domain_id = (size_t)number;
@@ -148,9 +150,12 @@ rcl_node_init(rcl_node_t * node, const char * name, const rcl_node_options_t * o
   }
   node->impl->actual_domain_id = domain_id;
   node->impl->rmw_node_handle = rmw_create_node(name, domain_id);
-  RCL_CHECK_FOR_NULL_WITH_MSG(
-    node->impl->rmw_node_handle, rmw_get_error_string_safe(), goto fail);
+  if (!node->impl->rmw_node_handle) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+    goto fail;
+  }
   node->impl->rcl_instance_id = rcl_get_instance_id();
+  rcl_impl_statistics_registry_init(&node->impl->statistics_registry);
   return RCL_RET_OK;
 fail:
   if (node->impl) {
@@ -227,7 +232,7 @@ rcl_node_get_name(const rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(node, NULL);
   RCL_CHECK_FOR_NULL_WITH_MSG(node->impl, "node implementation is invalid", return NULL);
   if (node->impl->rcl_instance_id != rcl_get_instance_id()) {
-    RCL_SET_ERROR_MSG("rcl node is invalid, rcl instance id does not match");
+    RCL_SET_ERROR_MSG_LITERAL("rcl node is invalid, rcl instance id does not match");
     return NULL;
   }
   return node->impl->rmw_node_handle->name;
@@ -239,7 +244,7 @@ rcl_node_get_options(const rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(node, NULL);
   RCL_CHECK_FOR_NULL_WITH_MSG(node->impl, "node implementation is invalid", return NULL);
   if (node->impl->rcl_instance_id != rcl_get_instance_id()) {
-    RCL_SET_ERROR_MSG("rcl node is invalid, rcl instance id does not match");
+    RCL_SET_ERROR_MSG_LITERAL("rcl node is invalid, rcl instance id does not match");
     return NULL;
   }
   return &node->impl->options;
@@ -253,7 +258,7 @@ rcl_node_get_domain_id(const rcl_node_t * node, size_t * domain_id)
   RCL_CHECK_FOR_NULL_WITH_MSG(
     node->impl, "node implementation is invalid", return RCL_RET_NODE_INVALID);
   if (node->impl->rcl_instance_id != rcl_get_instance_id()) {
-    RCL_SET_ERROR_MSG("rcl node is invalid, rcl instance id does not match");
+    RCL_SET_ERROR_MSG_LITERAL("rcl node is invalid, rcl instance id does not match");
     return RCL_RET_NODE_INVALID;
   }
   *domain_id = node->impl->actual_domain_id;
@@ -266,7 +271,7 @@ rcl_node_get_rmw_handle(const rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(node, NULL);
   RCL_CHECK_FOR_NULL_WITH_MSG(node->impl, "node implementation is invalid", return NULL);
   if (node->impl->rcl_instance_id != rcl_get_instance_id()) {
-    RCL_SET_ERROR_MSG("rcl node is invalid, rcl instance id does not match");
+    RCL_SET_ERROR_MSG_LITERAL("rcl node is invalid, rcl instance id does not match");
     return NULL;
   }
   return node->impl->rmw_node_handle;
@@ -280,6 +285,15 @@ rcl_node_get_rcl_instance_id(const rcl_node_t * node)
   return node->impl->rcl_instance_id;
 }
 
+rcl_statistics_registry_t *
+rcl_impl_node_get_statistics_registry(const rcl_node_t * node)
+{
+  if (!rcl_node_get_rmw_handle(node)) {
+    return NULL;  // error already set
+  }
+  return &node->impl->statistics_registry;
+}
+
 #if __cplusplus
 }
 #endif
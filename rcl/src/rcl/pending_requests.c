@@ -0,0 +1,275 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./pending_requests.h"
+
+#include <string.h>
+
+#include "./common.h"
+
+rcl_pending_requests_t
+rcl_impl_get_zero_initialized_pending_requests()
+{
+  static rcl_pending_requests_t null_requests = {0};
+  return null_requests;
+}
+
+rcl_ret_t
+rcl_impl_pending_requests_init(
+  rcl_pending_requests_t * requests,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(requests, RCL_RET_INVALID_ARGUMENT);
+  if (capacity == 0 || capacity > SIZE_MAX / 2 / sizeof(rcl_pending_request_t)) {
+    RCL_SET_ERROR_MSG_LITERAL("invalid number of pending requests");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  // Keep the load factor at or below one half.
+  size_t slot_count = 1;
+  while (slot_count < capacity * 2) {
+    slot_count <<= 1;
+  }
+  requests->slots = (rcl_pending_request_t *)allocator.allocate(
+    sizeof(rcl_pending_request_t) * slot_count, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    requests->slots, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  requests->deadline_heap = (size_t *)allocator.allocate(
+    sizeof(size_t) * capacity, allocator.state);
+  if (!requests->deadline_heap) {
+    allocator.deallocate(requests->slots, allocator.state);
+    requests->slots = NULL;
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  memset(requests->slots, 0, sizeof(rcl_pending_request_t) * slot_count);
+  requests->slot_mask = slot_count - 1;
+  requests->deadline_count = 0;
+  requests->size = 0;
+  requests->capacity = capacity;
+  requests->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_pending_requests_fini(rcl_pending_requests_t * requests)
+{
+  if (requests->slots) {
+    requests->allocator.deallocate(requests->slots, requests->allocator.state);
+    requests->slots = NULL;
+  }
+  if (requests->deadline_heap) {
+    requests->allocator.deallocate(requests->deadline_heap, requests->allocator.state);
+    requests->deadline_heap = NULL;
+  }
+  requests->size = 0;
+  requests->deadline_count = 0;
+  requests->capacity = 0;
+}
+
+// Return the slot at which the search for a sequence number starts.
+static size_t
+__home_slot(const rcl_pending_requests_t * requests, int64_t sequence_number)
+{
+  // Sequence numbers are consecutive, so mix them to spread them over the slots.
+  uint64_t hash = (uint64_t)sequence_number * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(hash ^ (hash >> 32)) & requests->slot_mask;
+}
+
+// Put a slot at a position of the heap, and tell the slot where it is.
+static void
+__heap_set(rcl_pending_requests_t * requests, size_t position, size_t slot)
+{
+  requests->deadline_heap[position] = slot;
+  requests->slots[slot].heap_index = position;
+}
+
+static rcl_time_point_value_t
+__heap_deadline(const rcl_pending_requests_t * requests, size_t position)
+{
+  return requests->slots[requests->deadline_heap[position]].deadline;
+}
+
+static void
+__heap_sift_up(rcl_pending_requests_t * requests, size_t position)
+{
+  size_t slot = requests->deadline_heap[position];
+  rcl_time_point_value_t deadline = requests->slots[slot].deadline;
+  while (position > 0) {
+    size_t parent = (position - 1) / 2;
+    if (__heap_deadline(requests, parent) <= deadline) {
+      break;
+    }
+    __heap_set(requests, position, requests->deadline_heap[parent]);
+    position = parent;
+  }
+  __heap_set(requests, position, slot);
+}
+
+static void
+__heap_sift_down(rcl_pending_requests_t * requests, size_t position)
+{
+  size_t slot = requests->deadline_heap[position];
+  rcl_time_point_value_t deadline = requests->slots[slot].deadline;
+  for (;;) {
+    size_t child = position * 2 + 1;
+    if (child >= requests->deadline_count) {
+      break;
+    }
+    if (child + 1 < requests->deadline_count &&
+      __heap_deadline(requests, child + 1) < __heap_deadline(requests, child))
+    {
+      ++child;
+    }
+    if (deadline <= __heap_deadline(requests, child)) {
+      break;
+    }
+    __heap_set(requests, position, requests->deadline_heap[child]);
+    position = child;
+  }
+  __heap_set(requests, position, slot);
+}
+
+static void
+__heap_remove(rcl_pending_requests_t * requests, size_t position)
+{
+  --requests->deadline_count;
+  if (position == requests->deadline_count) {
+    return;
+  }
+  __heap_set(requests, position, requests->deadline_heap[requests->deadline_count]);
+  if (position > 0 &&
+    __heap_deadline(requests, position) < __heap_deadline(requests, (position - 1) / 2))
+  {
+    __heap_sift_up(requests, position);
+  } else {
+    __heap_sift_down(requests, position);
+  }
+}
+
+bool
+rcl_impl_pending_requests_insert(
+  rcl_pending_requests_t * requests,
+  const rcl_pending_request_t * request)
+{
+  if (requests->size == requests->capacity) {
+    return false;
+  }
+  size_t slot = __home_slot(requests, request->sequence_number);
+  while (requests->slots[slot].used) {
+    slot = (slot + 1) & requests->slot_mask;
+  }
+  requests->slots[slot] = *request;
+  requests->slots[slot].used = true;
+  ++requests->size;
+  if (request->deadline) {
+    requests->deadline_heap[requests->deadline_count] = slot;
+    ++requests->deadline_count;
+    __heap_sift_up(requests, requests->deadline_count - 1);
+  }
+  return true;
+}
+
+// Remove the request in the slot, shifting the requests of the same probe sequence back.
+static void
+__remove_slot(rcl_pending_requests_t * requests, size_t slot, rcl_pending_request_t * removed)
+{
+  *removed = requests->slots[slot];
+  if (removed->deadline) {
+    __heap_remove(requests, removed->heap_index);
+  }
+  --requests->size;
+  size_t next = slot;
+  for (;;) {
+    next = (next + 1) & requests->slot_mask;
+    if (!requests->slots[next].used) {
+      break;
+    }
+    // The request in next can move into the hole unless its home lies cyclically after the hole.
+    size_t home = __home_slot(requests, requests->slots[next].sequence_number);
+    if (((next - home) & requests->slot_mask) < ((next - slot) & requests->slot_mask)) {
+      continue;
+    }
+    requests->slots[slot] = requests->slots[next];
+    if (requests->slots[slot].deadline) {
+      requests->deadline_heap[requests->slots[slot].heap_index] = slot;
+    }
+    slot = next;
+  }
+  requests->slots[slot].used = false;
+}
+
+bool
+rcl_impl_pending_requests_remove(
+  rcl_pending_requests_t * requests,
+  int64_t sequence_number,
+  rcl_pending_request_t * removed)
+{
+  if (requests->size == 0) {
+    return false;
+  }
+  size_t slot = __home_slot(requests, sequence_number);
+  while (requests->slots[slot].used) {
+    if (requests->slots[slot].sequence_number == sequence_number) {
+      __remove_slot(requests, slot, removed);
+      return true;
+    }
+    slot = (slot + 1) & requests->slot_mask;
+  }
+  return false;
+}
+
+bool
+rcl_impl_pending_requests_pop_expired(
+  rcl_pending_requests_t * requests,
+  rcl_time_point_value_t now,
+  rcl_pending_request_t * removed)
+{
+  if (requests->deadline_count == 0 || __heap_deadline(requests, 0) > now) {
+    return false;
+  }
+  __remove_slot(requests, requests->deadline_heap[0], removed);
+  return true;
+}
+
+bool
+rcl_impl_pending_requests_pop_any(
+  rcl_pending_requests_t * requests,
+  rcl_pending_request_t * removed)
+{
+  if (requests->size == 0) {
+    return false;
+  }
+  size_t slot = 0;
+  while (!requests->slots[slot].used) {
+    ++slot;
+  }
+  __remove_slot(requests, slot, removed);
+  return true;
+}
+
+rcl_time_point_value_t
+rcl_impl_pending_requests_next_deadline(const rcl_pending_requests_t * requests)
+{
+  return requests->deadline_count ? __heap_deadline(requests, 0) : 0;
+}
+
+#if __cplusplus
+}
+#endif
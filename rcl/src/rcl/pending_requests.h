@@ -0,0 +1,142 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__PENDING_REQUESTS_H_
+#define RCL__PENDING_REQUESTS_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/allocator.h"
+#include "rcl/client.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+/// A request which was sent and is waiting for its response.
+typedef struct rcl_pending_request_t
+{
+  int64_t sequence_number;
+  /// Steady time at which the request expires, or 0 if it never does.
+  rcl_time_point_value_t deadline;
+  rcl_client_response_callback_t callback;
+  const void * user_data;
+  /// Position of the request in the deadline heap, only valid if it has a deadline.
+  size_t heap_index;
+  bool used;
+} rcl_pending_request_t;
+
+/// Table of pending requests, keyed by sequence number, with a heap of their deadlines.
+/* The table uses open addressing with linear probing, and has at least twice
+ * as many slots as requests, so lookups stay short.
+ * Removed requests are replaced by shifting the requests after them back,
+ * so no tombstones are left behind.
+ * All of the storage is allocated once, when the table is initialized.
+ *
+ * The table is not thread-safe, the client protects it with a lock.
+ */
+typedef struct rcl_pending_requests_t
+{
+  rcl_pending_request_t * slots;
+  /// Number of slots minus 1, the number of slots is a power of two.
+  size_t slot_mask;
+  /// Indices of the slots of the requests with a deadline, ordered as a min-heap.
+  size_t * deadline_heap;
+  size_t deadline_count;
+  /// Number of pending requests.
+  size_t size;
+  /// Maximum number of pending requests.
+  size_t capacity;
+  /// Allocator used to allocate the slots and the heap.
+  rcl_allocator_t allocator;
+} rcl_pending_requests_t;
+
+/// Return a rcl_pending_requests_t with members set to NULL or 0.
+rcl_pending_requests_t
+rcl_impl_get_zero_initialized_pending_requests(void);
+
+/// Allocate a table for up to capacity pending requests.
+/* \return RCL_RET_OK if the table was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_pending_requests_init(
+  rcl_pending_requests_t * requests,
+  size_t capacity,
+  rcl_allocator_t allocator);
+
+/// Free the storage of the table, forgetting any pending requests.
+void
+rcl_impl_pending_requests_fini(rcl_pending_requests_t * requests);
+
+/// Add a request, or return false if the table is full.
+/* This function does not allocate heap memory.
+ *
+ * \param[in] requests the table
+ * \param[in] request the request, its heap_index and used members are ignored
+ * \return true if the request was added, false if the table is full.
+ */
+bool
+rcl_impl_pending_requests_insert(
+  rcl_pending_requests_t * requests,
+  const rcl_pending_request_t * request);
+
+/// Remove the request with the given sequence number, or return false if there is none.
+/* This function does not allocate heap memory.
+ *
+ * \param[in] requests the table
+ * \param[in] sequence_number the sequence number of the request
+ * \param[out] removed set to a copy of the removed request
+ */
+bool
+rcl_impl_pending_requests_remove(
+  rcl_pending_requests_t * requests,
+  int64_t sequence_number,
+  rcl_pending_request_t * removed);
+
+/// Remove the request with the earliest deadline if it is at or before now.
+/* This function does not allocate heap memory.
+ *
+ * \param[in] requests the table
+ * \param[in] now the steady time
+ * \param[out] removed set to a copy of the removed request
+ * \return true if a request expired, otherwise false.
+ */
+bool
+rcl_impl_pending_requests_pop_expired(
+  rcl_pending_requests_t * requests,
+  rcl_time_point_value_t now,
+  rcl_pending_request_t * removed);
+
+/// Remove any request, or return false if there is none, used to cancel all of them.
+bool
+rcl_impl_pending_requests_pop_any(
+  rcl_pending_requests_t * requests,
+  rcl_pending_request_t * removed);
+
+/// Return the earliest deadline, or 0 if no request has a deadline.
+rcl_time_point_value_t
+rcl_impl_pending_requests_next_deadline(const rcl_pending_requests_t * requests);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__PENDING_REQUESTS_H_
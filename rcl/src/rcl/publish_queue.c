@@ -0,0 +1,221 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./publish_queue.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "./common.h"
+
+rcl_publish_queue_t
+rcl_impl_get_zero_initialized_publish_queue()
+{
+  static rcl_publish_queue_t null_queue = {0};
+  return null_queue;
+}
+
+rcl_ret_t
+rcl_impl_publish_queue_init(
+  rcl_publish_queue_t * queue,
+  size_t capacity,
+  size_t message_size,
+  rcl_message_copy_function_t message_copy,
+  rcl_message_fini_function_t message_fini,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(queue, RCL_RET_INVALID_ARGUMENT);
+  if (capacity == 0 || message_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("publish queue capacity and message size must be greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (message_fini && !message_copy) {
+    RCL_SET_ERROR_MSG_LITERAL("a publish queue fini function requires a copy function");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (message_size > SIZE_MAX / capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("publish queue is too large");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  queue->storage = (char *)allocator.allocate(message_size * capacity, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    queue->storage, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  queue->sequences = (atomic_uint_least64_t *)allocator.allocate(
+    sizeof(atomic_uint_least64_t) * capacity, allocator.state);
+  queue->copy_failed = (bool *)allocator.allocate(sizeof(bool) * capacity, allocator.state);
+  if (!queue->sequences || !queue->copy_failed) {
+    if (queue->sequences) {
+      allocator.deallocate(queue->sequences, allocator.state);
+      queue->sequences = NULL;
+    }
+    if (queue->copy_failed) {
+      allocator.deallocate(queue->copy_failed, allocator.state);
+      queue->copy_failed = NULL;
+    }
+    allocator.deallocate(queue->storage, allocator.state);
+    queue->storage = NULL;
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    return RCL_RET_BAD_ALLOC;
+  }
+  // The copy function expects zero initialized storage.
+  memset(queue->storage, 0, message_size * capacity);
+  size_t i;
+  for (i = 0; i < capacity; ++i) {
+    atomic_init(&queue->sequences[i], i);
+    queue->copy_failed[i] = false;
+  }
+  queue->message_size = message_size;
+  queue->capacity = capacity;
+  queue->message_copy = message_copy;
+  queue->message_fini = message_fini;
+  atomic_init(&queue->enqueue_position, 0);
+  atomic_init(&queue->dequeue_position, 0);
+  queue->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_publish_queue_fini(rcl_publish_queue_t * queue)
+{
+  if (queue->storage) {
+    while (rcl_impl_publish_queue_pop(queue, NULL)) {
+      // Finalize the copies which were never published.
+    }
+    queue->allocator.deallocate(queue->storage, queue->allocator.state);
+    queue->storage = NULL;
+  }
+  if (queue->sequences) {
+    queue->allocator.deallocate(queue->sequences, queue->allocator.state);
+    queue->sequences = NULL;
+  }
+  if (queue->copy_failed) {
+    queue->allocator.deallocate(queue->copy_failed, queue->allocator.state);
+    queue->copy_failed = NULL;
+  }
+  queue->capacity = 0;
+}
+
+rcl_ret_t
+rcl_impl_publish_queue_push(
+  rcl_publish_queue_t * queue,
+  const void * message,
+  bool * pushed,
+  bool * was_empty)
+{
+  *pushed = false;
+  size_t index;
+  uint64_t position = rcl_atomic_load_uint64_t(&queue->enqueue_position);
+  for (;;) {
+    index = (size_t)(position % queue->capacity);
+    uint64_t sequence = rcl_atomic_load_uint64_t(&queue->sequences[index]);
+    int64_t difference = (int64_t)(sequence - position);
+    if (difference == 0) {
+      // The slot is free for this position, try to claim it.
+      if (rcl_atomic_compare_exchange_strong_uint_least64_t(
+          &queue->enqueue_position, &position, position + 1))
+      {
+        break;
+      }
+    } else if (difference < 0) {
+      // The slot still holds a message from the previous lap, the queue is full.
+      return RCL_RET_OK;
+    } else {
+      position = rcl_atomic_load_uint64_t(&queue->enqueue_position);
+    }
+  }
+  rcl_ret_t result = RCL_RET_OK;
+  char * slot = queue->storage + index * queue->message_size;
+  if (!queue->message_copy) {
+    memcpy(slot, message, queue->message_size);
+  } else if (!queue->message_copy(message, slot)) {
+    // The position is taken already, so the slot is handed over but skipped by the consumers.
+    memset(slot, 0, queue->message_size);
+    queue->copy_failed[index] = true;
+    RCL_SET_ERROR_MSG_LITERAL("copying the message into the publish queue failed");
+    result = RCL_RET_ERROR;
+  }
+  rcl_atomic_store(&queue->sequences[index], position + 1);
+  *pushed = true;
+  // If the consumers have caught up to this message, they may be waiting for it.
+  *was_empty = rcl_atomic_load_uint64_t(&queue->dequeue_position) >= position;
+  return result;
+}
+
+// Claim the oldest full slot, or return false if the queue is empty.
+static bool
+__claim_oldest(rcl_publish_queue_t * queue, uint64_t * position, size_t * index)
+{
+  for (;;) {
+    *index = (size_t)(*position % queue->capacity);
+    uint64_t sequence = rcl_atomic_load_uint64_t(&queue->sequences[*index]);
+    int64_t difference = (int64_t)(sequence - (*position + 1));
+    if (difference == 0) {
+      // The slot is full for this position, try to claim it.
+      if (rcl_atomic_compare_exchange_strong_uint_least64_t(
+          &queue->dequeue_position, position, *position + 1))
+      {
+        return true;
+      }
+    } else if (difference < 0) {
+      // No message has been written to the slot yet, the queue is empty.
+      return false;
+    } else {
+      *position = rcl_atomic_load_uint64_t(&queue->dequeue_position);
+    }
+  }
+}
+
+bool
+rcl_impl_publish_queue_pop(rcl_publish_queue_t * queue, void * message)
+{
+  size_t index;
+  uint64_t position = rcl_atomic_load_uint64_t(&queue->dequeue_position);
+  bool skipped = true;
+  while (skipped) {
+    if (!__claim_oldest(queue, &position, &index)) {
+      return false;
+    }
+    // A slot whose copy failed holds no message, so it is given back and the next one is tried.
+    skipped = queue->copy_failed[index];
+    queue->copy_failed[index] = false;
+    char * slot = queue->storage + index * queue->message_size;
+    if (!skipped) {
+      if (message) {
+        memcpy(message, slot, queue->message_size);
+      } else if (queue->message_fini) {
+        queue->message_fini(slot);
+      }
+      if (queue->message_copy) {
+        memset(slot, 0, queue->message_size);
+      }
+    }
+    // Make the slot available to the producers on the next lap.
+    rcl_atomic_store(&queue->sequences[index], position + queue->capacity);
+    position = rcl_atomic_load_uint64_t(&queue->dequeue_position);
+  }
+  return true;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__PUBLISH_QUEUE_H_
+#define RCL__PUBLISH_QUEUE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rcl/allocator.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// Bounded queue of message copies, waiting to be published.
+/* The messages are copied into storage which is allocated once, when the
+ * queue is initialized, either byte for byte or with a copy function.
+ * Each slot is zero initialized while it does not hold a message.
+ * The queue is lock-free, each slot carries a sequence number which tells
+ * producers and consumers whether it is free or full for their position.
+ */
+typedef struct rcl_publish_queue_t
+{
+  /// Contiguous storage for all of the messages.
+  char * storage;
+  /// One sequence number per slot.
+  atomic_uint_least64_t * sequences;
+  /// One flag per slot, set if copying the message into it failed.
+  bool * copy_failed;
+  /// Size of each message in bytes.
+  size_t message_size;
+  /// Number of messages the queue can hold.
+  size_t capacity;
+  /// Function used to copy messages into the slots, or NULL for a shallow copy.
+  rcl_message_copy_function_t message_copy;
+  /// Function used to finalize a copy which is discarded, or NULL.
+  rcl_message_fini_function_t message_fini;
+  atomic_uint_least64_t enqueue_position;
+  atomic_uint_least64_t dequeue_position;
+  /// Allocator used to allocate the storage and the sequence numbers.
+  rcl_allocator_t allocator;
+} rcl_publish_queue_t;
+
+/// Return a rcl_publish_queue_t with members set to NULL or 0.
+rcl_publish_queue_t
+rcl_impl_get_zero_initialized_publish_queue(void);
+
+/// Allocate storage for capacity messages of message_size bytes each.
+/* message_fini must be NULL unless message_copy is set.
+ *
+ * \return RCL_RET_OK if the queue was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_publish_queue_init(
+  rcl_publish_queue_t * queue,
+  size_t capacity,
+  size_t message_size,
+  rcl_message_copy_function_t message_copy,
+  rcl_message_fini_function_t message_fini,
+  rcl_allocator_t allocator);
+
+/// Finalize any queued messages and free the storage of the queue.
+void
+rcl_impl_publish_queue_fini(rcl_publish_queue_t * queue);
+
+/// Copy a message into the queue.
+/* pushed is set to false if the queue is full, in which case nothing else
+ * happens.
+ * If the message was added, was_empty is set to true when no other message
+ * was waiting in front of it, i.e. when a consumer might be idle.
+ *
+ * If the copy function fails, the slot which was claimed for the message is
+ * skipped by the consumers, and pushed is still set to true.
+ *
+ * This function does not allocate heap memory, but the copy function may.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \return RCL_RET_OK if the message was copied or the queue is full, or
+ *         RCL_RET_ERROR if the copy function failed.
+ */
+rcl_ret_t
+rcl_impl_publish_queue_push(
+  rcl_publish_queue_t * queue,
+  const void * message,
+  bool * pushed,
+  bool * was_empty);
+
+/// Move the oldest message out of the queue, or return false if the queue is empty.
+/* The message is moved byte for byte, so with a copy function the caller
+ * owns the copy afterwards, and must finalize it.
+ * If message is NULL the oldest message is discarded, and finalized, instead.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+bool
+rcl_impl_publish_queue_pop(rcl_publish_queue_t * queue, void * message);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__PUBLISH_QUEUE_H_
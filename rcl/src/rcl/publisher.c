@@ -21,15 +21,202 @@ extern "C"
 
 #include <string.h>
 
+#include "./change_filter.h"
 #include "./common.h"
+#include "./intra_process.h"
+#include "./message_pool.h"
+#include "./publish_queue.h"
+#include "./statistics_registry.h"
+#include "./throttle.h"
 #include "rmw/rmw.h"
 
+typedef struct rcl_publisher_async_impl_t
+{
+  rcl_publish_queue_t queue;
+  rcl_guard_condition_t guard_condition;
+  // Storage for the message being flushed, so the queue slot can be reused right away.
+  void * flush_message;
+  atomic_uint_least64_t enqueued;
+  atomic_uint_least64_t published;
+  atomic_uint_least64_t publish_errors;
+  atomic_uint_least64_t dropped_oldest;
+  atomic_uint_least64_t dropped_newest;
+  atomic_uint_least64_t blocked;
+} rcl_publisher_async_impl_t;
+
 typedef struct rcl_publisher_impl_t
 {
   rcl_publisher_options_t options;
   rmw_publisher_t * rmw_handle;
+  rcl_message_pool_t * loaned_message_pool;
+  // Sends loaned messages to the middleware, with a gid which lets local subscriptions
+  // recognize the messages they already got intra-process. NULL unless messages are lent.
+  rmw_publisher_t * loaned_rmw_handle;
+  // Registered while loaned_rmw_handle is set.
+  rcl_intra_process_publisher_t intra_process;
+  // NULL unless the publisher is asynchronous.
+  rcl_publisher_async_impl_t * async;
+  // NULL unless statistics are enabled.
+  rcl_publisher_statistics_impl_t * statistics;
+  rcl_throttle_t throttle;
+  rcl_change_filter_t change_filter;
+  // Number of loaned messages handed to the intra-process path.
+  atomic_uint_least64_t intra_process_sequence_number;
 } rcl_publisher_impl_t;
 
+// Read the steady clock once, if throttling, change detection or statistics need it.
+static rcl_time_point_value_t
+__publish_start(rcl_publisher_impl_t * impl)
+{
+  rcl_time_point_value_t now = 0;
+  if (!impl->statistics && !rcl_impl_throttle_needs_clock(&impl->throttle) &&
+    !rcl_impl_change_filter_needs_clock(&impl->change_filter))
+  {
+    return now;
+  }
+  if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+    rcl_reset_error();  // Throttling, change detection and statistics must not fail the publish.
+  }
+  return now;
+}
+
+static void
+__statistics_finish(
+  rcl_publisher_statistics_impl_t * statistics,
+  rcl_time_point_value_t start,
+  uint64_t message_count,
+  uint64_t error_count)
+{
+  rcl_time_point_value_t now = start;
+  if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+    rcl_reset_error();  // Statistics are best effort, and must not fail the publish.
+  }
+  rcl_impl_publisher_statistics_record(
+    statistics, now > start ? now - start : 0, message_count, error_count);
+}
+
+static void
+__async_fini(rcl_publisher_async_impl_t * async, rcl_allocator_t allocator)
+{
+  if (async->guard_condition.impl &&
+    rcl_guard_condition_fini(&async->guard_condition) != RCL_RET_OK)
+  {
+    // Finalizing is best effort, the rcl error state is already set.
+  }
+  rcl_impl_publish_queue_fini(&async->queue);
+  if (async->flush_message) {
+    allocator.deallocate(async->flush_message, allocator.state);
+  }
+  allocator.deallocate(async, allocator.state);
+}
+
+static rcl_ret_t
+__async_init(
+  rcl_publisher_async_impl_t ** async_out,
+  const rcl_publisher_options_t * options)
+{
+  const rcl_allocator_t * allocator = &options->allocator;
+  if (options->qos.depth == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("asynchronous publishers need a qos depth greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (options->async_message_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("asynchronous publishers need an async_message_size greater than 0");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  switch (options->async_overflow_policy) {
+    case RCL_PUBLISHER_OVERFLOW_DROP_OLDEST:
+    case RCL_PUBLISHER_OVERFLOW_DROP_NEWEST:
+    case RCL_PUBLISHER_OVERFLOW_BLOCK:
+      break;
+    default:
+      RCL_SET_ERROR_MSG_LITERAL("unknown async overflow policy");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_publisher_async_impl_t * async = (rcl_publisher_async_impl_t *)allocator->allocate(
+    sizeof(rcl_publisher_async_impl_t), allocator->state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(async, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  async->queue = rcl_impl_get_zero_initialized_publish_queue();
+  async->guard_condition = rcl_get_zero_initialized_guard_condition();
+  async->flush_message = NULL;
+  atomic_init(&async->enqueued, 0);
+  atomic_init(&async->published, 0);
+  atomic_init(&async->publish_errors, 0);
+  atomic_init(&async->dropped_oldest, 0);
+  atomic_init(&async->dropped_newest, 0);
+  atomic_init(&async->blocked, 0);
+  rcl_ret_t ret = rcl_impl_publish_queue_init(
+    &async->queue,
+    options->qos.depth,
+    options->async_message_size,
+    options->async_message_copy,
+    options->async_message_fini,
+    *allocator);
+  if (ret != RCL_RET_OK) {
+    goto fail;  // rcl error state should already be set.
+  }
+  async->flush_message = allocator->allocate(options->async_message_size, allocator->state);
+  if (!async->flush_message) {
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+    ret = RCL_RET_BAD_ALLOC;
+    goto fail;
+  }
+  rcl_guard_condition_options_t guard_condition_options =
+    rcl_guard_condition_get_default_options();
+  guard_condition_options.allocator = *allocator;
+  ret = rcl_guard_condition_init(&async->guard_condition, guard_condition_options);
+  if (ret != RCL_RET_OK) {
+    goto fail;  // rcl error state should already be set.
+  }
+  *async_out = async;
+  return RCL_RET_OK;
+fail:
+  __async_fini(async, *allocator);
+  return ret;
+}
+
+static rcl_ret_t
+__async_publish(
+  rcl_publisher_async_impl_t * async,
+  rcl_publisher_overflow_policy_t overflow_policy,
+  const void * ros_message)
+{
+  bool pushed = false;
+  bool was_empty = false;
+  bool waited = false;
+  rcl_ret_t result = RCL_RET_OK;
+  for (;;) {
+    result = rcl_impl_publish_queue_push(&async->queue, ros_message, &pushed, &was_empty);
+    if (pushed) {
+      break;
+    }
+    if (overflow_policy == RCL_PUBLISHER_OVERFLOW_DROP_NEWEST) {
+      rcl_atomic_fetch_add_uint64_t(&async->dropped_newest, 1);
+      return RCL_RET_OK;
+    }
+    if (overflow_policy == RCL_PUBLISHER_OVERFLOW_DROP_OLDEST) {
+      // The flusher may have made room in the meantime, in which case nothing is dropped.
+      if (rcl_impl_publish_queue_pop(&async->queue, NULL)) {
+        rcl_atomic_fetch_add_uint64_t(&async->dropped_oldest, 1);
+      }
+      continue;
+    }
+    if (!waited) {
+      waited = true;
+      rcl_atomic_fetch_add_uint64_t(&async->blocked, 1);
+    }
+    // The flushing thread needs time to make room, so do not keep the core busy.
+    rcl_impl_yield_thread();
+  }
+  if (result == RCL_RET_OK) {
+    rcl_atomic_fetch_add_uint64_t(&async->enqueued, 1);
+  }
+  if (was_empty && rcl_trigger_guard_condition(&async->guard_condition) != RCL_RET_OK) {
+    return RCL_RET_ERROR;  // rcl error state should already be set.
+  }
+  return result;  // rcl error state should already be set if copying failed.
+}
+
 rcl_publisher_t
 rcl_get_zero_initialized_publisher()
 {
@@ -49,16 +236,19 @@ rcl_publisher_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (!node->impl) {
-    RCL_SET_ERROR_MSG("invalid node");
+    RCL_SET_ERROR_MSG_LITERAL("invalid node");
     return RCL_RET_NODE_INVALID;
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(type_support, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(topic_name, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   if (publisher->impl) {
-    RCL_SET_ERROR_MSG("publisher already initialized, or memory was unintialized");
+    RCL_SET_ERROR_MSG_LITERAL("publisher already initialized, or memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
+  if (rcl_impl_validate_qos_profile(&options->qos) != RCL_RET_OK) {
+    return RCL_RET_INVALID_ARGUMENT;  // rcl error state should already be set.
+  }
   const rcl_allocator_t * allocator = &options->allocator;
   RCL_CHECK_FOR_NULL_WITH_MSG(
     allocator->allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
@@ -70,23 +260,127 @@ rcl_publisher_init(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     publisher->impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
   // Fill out implementation struct.
+  publisher->impl->loaned_message_pool = NULL;
+  publisher->impl->loaned_rmw_handle = NULL;
+  publisher->impl->intra_process.topic = NULL;
+  publisher->impl->rmw_handle = NULL;
+  publisher->impl->async = NULL;
+  publisher->impl->statistics = NULL;
+  atomic_init(&publisher->impl->change_filter.spare_key, 0);
+  atomic_init(&publisher->impl->intra_process_sequence_number, 0);
+  // loaned message pool, allocated on its own since subscriptions may outlive the publisher
+  rcl_ret_t ret = RCL_RET_OK;
+  if (options->loaned_message_pool_size > 0) {
+    ret = rcl_impl_message_pool_create(
+      options->loaned_message_pool_size,
+      options->loaned_message_size,
+      *allocator,
+      &publisher->impl->loaned_message_pool);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
+  // throttling
+  ret = rcl_impl_throttle_init(&publisher->impl->throttle, options);
+  if (ret != RCL_RET_OK) {
+    fail_ret = ret;
+    goto fail;  // rcl error state should already be set.
+  }
+  // change-only publishing
+  ret = rcl_impl_change_filter_init(&publisher->impl->change_filter, options);
+  if (ret != RCL_RET_OK) {
+    fail_ret = ret;
+    goto fail;  // rcl error state should already be set.
+  }
+  // asynchronous publishing queue
+  if (options->asynchronous) {
+    ret = __async_init(&publisher->impl->async, options);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
   // rmw handle (create rmw publisher)
   // TODO(wjwwood): pass along the allocator to rmw when it supports it
   publisher->impl->rmw_handle = rmw_create_publisher(
     rcl_node_get_rmw_handle(node),
     type_support,
     topic_name,
-    &rmw_qos_profile_default);
+    &options->qos);
   if (!publisher->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
     goto fail;
   }
+  // intra-process delivery of loaned messages
+  if (publisher->impl->loaned_message_pool) {
+    publisher->impl->loaned_rmw_handle = rmw_create_publisher(
+      rcl_node_get_rmw_handle(node),
+      type_support,
+      topic_name,
+      &options->qos);
+    if (!publisher->impl->loaned_rmw_handle) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      goto fail;
+    }
+    if (rmw_get_gid_for_publisher(
+        publisher->impl->loaned_rmw_handle, &publisher->impl->intra_process.gid) != RMW_RET_OK)
+    {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      goto fail;
+    }
+    ret = rcl_impl_intra_process_register_publisher(
+      &publisher->impl->intra_process,
+      publisher->impl->rmw_handle->topic_name,
+      type_support);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
+  // statistics
+  if (options->enable_statistics) {
+    publisher->impl->statistics = (rcl_publisher_statistics_impl_t *)allocator->allocate(
+      sizeof(rcl_publisher_statistics_impl_t), allocator->state);
+    if (!publisher->impl->statistics) {
+      RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+      fail_ret = RCL_RET_BAD_ALLOC;
+      goto fail;
+    }
+    rcl_impl_publisher_statistics_init(
+      publisher->impl->statistics, publisher->impl->rmw_handle->topic_name);
+    rcl_impl_statistics_registry_add_publisher(
+      rcl_impl_node_get_statistics_registry(node), publisher->impl->statistics);
+  }
   // options
   publisher->impl->options = *options;
   return RCL_RET_OK;
 fail:
   if (publisher->impl) {
+    if (publisher->impl->intra_process.topic) {
+      rcl_impl_intra_process_unregister_publisher(&publisher->impl->intra_process);
+    }
+    if (publisher->impl->loaned_rmw_handle &&
+      rmw_destroy_publisher(rcl_node_get_rmw_handle(node), publisher->impl->loaned_rmw_handle) !=
+      RMW_RET_OK)
+    {
+      // The original error is more useful, so only report the failure to init.
+    }
+    if (publisher->impl->rmw_handle &&
+      rmw_destroy_publisher(rcl_node_get_rmw_handle(node), publisher->impl->rmw_handle) !=
+      RMW_RET_OK)
+    {
+      // The original error is more useful, so only report the failure to init.
+    }
+    if (publisher->impl->async) {
+      __async_fini(publisher->impl->async, *allocator);
+    }
+    rcl_impl_message_pool_destroy(publisher->impl->loaned_message_pool);
+    if (rcl_impl_change_filter_fini(&publisher->impl->change_filter) != RCL_RET_OK) {
+      // The original error is more useful, so only report the failure to init.
+    }
     allocator->deallocate(publisher->impl, allocator->state);
+    publisher->impl = NULL;
   }
   return fail_ret;
 }
@@ -98,13 +392,39 @@ rcl_publisher_fini(rcl_publisher_t * publisher, rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (publisher->impl) {
+    rcl_allocator_t allocator = publisher->impl->options.allocator;
+    if (publisher->impl->statistics) {
+      rcl_statistics_registry_t * registry = rcl_impl_node_get_statistics_registry(node);
+      if (registry) {
+        rcl_impl_statistics_registry_remove_publisher(registry, publisher->impl->statistics);
+      } else {
+        result = RCL_RET_NODE_INVALID;  // rcl error state should already be set.
+      }
+      allocator.deallocate(publisher->impl->statistics, allocator.state);
+    }
+    if (publisher->impl->loaned_rmw_handle) {
+      rcl_impl_intra_process_unregister_publisher(&publisher->impl->intra_process);
+      if (rmw_destroy_publisher(
+          rcl_node_get_rmw_handle(node), publisher->impl->loaned_rmw_handle) != RMW_RET_OK)
+      {
+        RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+        result = RCL_RET_ERROR;
+      }
+    }
     rmw_ret_t ret =
       rmw_destroy_publisher(rcl_node_get_rmw_handle(node), publisher->impl->rmw_handle);
     if (ret != RMW_RET_OK) {
       RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
       result = RCL_RET_ERROR;
     }
-    rcl_allocator_t allocator = publisher->impl->options.allocator;
+    if (publisher->impl->async) {
+      __async_fini(publisher->impl->async, allocator);
+    }
+    // Messages still held by subscriptions keep the pool alive until they are returned.
+    rcl_impl_message_pool_destroy(publisher->impl->loaned_message_pool);
+    if (rcl_impl_change_filter_fini(&publisher->impl->change_filter) != RCL_RET_OK) {
+      result = RCL_RET_ERROR;  // rcl error state should already be set.
+    }
     allocator.deallocate(publisher->impl, allocator.state);
   }
   return result;
@@ -117,9 +437,37 @@ rcl_publisher_get_default_options()
   // Must set the allocator and qos after because they are not a compile time constant.
   default_options.qos = rmw_qos_profile_default;
   default_options.allocator = rcl_get_default_allocator();
+  default_options.loaned_message_pool_size = 0;
+  default_options.loaned_message_size = 0;
+  default_options.asynchronous = false;
+  default_options.async_message_size = 0;
+  default_options.async_message_copy = NULL;
+  default_options.async_message_fini = NULL;
+  default_options.async_overflow_policy = RCL_PUBLISHER_OVERFLOW_DROP_OLDEST;
+  default_options.throttle_mode = RCL_PUBLISHER_THROTTLE_NONE;
+  default_options.throttle_period_ns = 0;
+  default_options.throttle_keep_every_nth = 0;
+  default_options.throttle_burst = 0;
+  default_options.enable_statistics = false;
+  default_options.publish_changes_only = false;
+  default_options.change_only_message_key = NULL;
+  default_options.change_only_heartbeat_ns = 0;
   return default_options;
 }
 
+static rcl_ret_t
+__publish(const rcl_publisher_impl_t * impl, const void * ros_message)
+{
+  if (impl->async) {
+    return __async_publish(impl->async, impl->options.async_overflow_policy, ros_message);
+  }
+  if (rmw_publish(impl->rmw_handle, ros_message) != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+    return RCL_RET_ERROR;
+  }
+  return RCL_RET_OK;
+}
+
 rcl_ret_t
 rcl_publish(const rcl_publisher_t * publisher, const void * ros_message)
 {
@@ -127,13 +475,281 @@ rcl_publish(const rcl_publisher_t * publisher, const void * ros_message)
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_FOR_NULL_WITH_MSG(
     publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
-  if (rmw_publish(publisher->impl->rmw_handle, ros_message) != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
-    return RCL_RET_ERROR;
+  rcl_publisher_statistics_impl_t * statistics = publisher->impl->statistics;
+  rcl_time_point_value_t start = __publish_start(publisher->impl);
+  bool changed;
+  uint64_t hash;
+  rcl_ret_t ret = rcl_impl_change_filter_check(
+    &publisher->impl->change_filter, ros_message, start, &changed, &hash);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  if (!changed || !rcl_impl_throttle_admit(&publisher->impl->throttle, start)) {
+    return RCL_RET_OK;
+  }
+  ret = __publish(publisher->impl, ros_message);
+  if (ret == RCL_RET_OK) {
+    rcl_impl_change_filter_commit(&publisher->impl->change_filter, hash, start);
+  }
+  if (statistics) {
+    __statistics_finish(statistics, start, ret == RCL_RET_OK, ret != RCL_RET_OK);
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_publisher_flush_async_queue(
+  const rcl_publisher_t * publisher,
+  size_t max_messages,
+  size_t * flushed_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(flushed_count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  rcl_publisher_async_impl_t * async = publisher->impl->async;
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    async, "publisher is not asynchronous", return RCL_RET_INVALID_ARGUMENT);
+  rcl_ret_t result = RCL_RET_OK;
+  *flushed_count = 0;
+  while (max_messages == 0 || *flushed_count < max_messages) {
+    if (!rcl_impl_publish_queue_pop(&async->queue, async->flush_message)) {
+      break;
+    }
+    ++(*flushed_count);
+    rmw_ret_t ret = rmw_publish(publisher->impl->rmw_handle, async->flush_message);
+    // The copy was moved out of the queue, so it is finalized here.
+    if (publisher->impl->options.async_message_fini) {
+      publisher->impl->options.async_message_fini(async->flush_message);
+    }
+    if (ret != RMW_RET_OK) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      rcl_atomic_fetch_add_uint64_t(&async->publish_errors, 1);
+      result = RCL_RET_ERROR;
+      continue;
+    }
+    rcl_atomic_fetch_add_uint64_t(&async->published, 1);
+  }
+  return result;
+}
+
+rcl_ret_t
+rcl_publisher_get_unchanged_count(
+  const rcl_publisher_t * publisher,
+  uint64_t * unchanged_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(unchanged_count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  *unchanged_count =
+    rcl_atomic_load_uint64_t(&publisher->impl->change_filter.unchanged_count);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_publisher_get_suppressed_count(
+  const rcl_publisher_t * publisher,
+  uint64_t * suppressed_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(suppressed_count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  *suppressed_count = rcl_atomic_load_uint64_t(&publisher->impl->throttle.suppressed_count);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_publisher_get_statistics(
+  const rcl_publisher_t * publisher,
+  rcl_publisher_statistics_t * statistics)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl->statistics, "statistics are not enabled for this publisher",
+    return RCL_RET_INVALID_ARGUMENT);
+  rcl_impl_publisher_statistics_snapshot(publisher->impl->statistics, statistics);
+  return RCL_RET_OK;
+}
+
+const rcl_guard_condition_t *
+rcl_publisher_get_async_guard_condition(const rcl_publisher_t * publisher)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, NULL);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return NULL);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl->async, "publisher is not asynchronous", return NULL);
+  return &publisher->impl->async->guard_condition;
+}
+
+rcl_ret_t
+rcl_publisher_get_async_counters(
+  const rcl_publisher_t * publisher,
+  rcl_publisher_async_counters_t * counters)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(counters, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  rcl_publisher_async_impl_t * async = publisher->impl->async;
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    async, "publisher is not asynchronous", return RCL_RET_INVALID_ARGUMENT);
+  counters->enqueued = rcl_atomic_load_uint64_t(&async->enqueued);
+  counters->published = rcl_atomic_load_uint64_t(&async->published);
+  counters->publish_errors = rcl_atomic_load_uint64_t(&async->publish_errors);
+  counters->dropped_oldest = rcl_atomic_load_uint64_t(&async->dropped_oldest);
+  counters->dropped_newest = rcl_atomic_load_uint64_t(&async->dropped_newest);
+  counters->blocked = rcl_atomic_load_uint64_t(&async->blocked);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_publish_batch(
+  const rcl_publisher_t * publisher,
+  const void * const * ros_messages,
+  size_t count,
+  size_t * published_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(published_count, RCL_RET_INVALID_ARGUMENT);
+  *published_count = 0;
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  if (count == 0) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_messages, RCL_RET_INVALID_ARGUMENT);
+  size_t i;
+  for (i = 0; i < count; ++i) {
+    if (!ros_messages[i]) {
+      RCL_SET_ERROR_MSG_LITERAL("ros_messages argument contains a null message");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  }
+  rcl_publisher_statistics_impl_t * statistics = publisher->impl->statistics;
+  rcl_time_point_value_t start = __publish_start(publisher->impl);
+  rcl_ret_t ret = RCL_RET_OK;
+  bool changed;
+  uint64_t hash;
+  // The middleware has no batch publish, so each message is published on its own.
+  for (i = 0; i < count; ++i) {
+    ret = rcl_impl_change_filter_check(
+      &publisher->impl->change_filter, ros_messages[i], start, &changed, &hash);
+    if (ret != RCL_RET_OK) {
+      break;  // rcl error state should already be set.
+    }
+    if (!changed || !rcl_impl_throttle_admit(&publisher->impl->throttle, start)) {
+      continue;
+    }
+    ret = __publish(publisher->impl, ros_messages[i]);
+    if (ret != RCL_RET_OK) {
+      break;  // rcl error state should already be set.
+    }
+    rcl_impl_change_filter_commit(&publisher->impl->change_filter, hash, start);
+    ++(*published_count);
+  }
+  if (statistics) {
+    __statistics_finish(statistics, start, *published_count, ret != RCL_RET_OK);
+  }
+  return ret;
+}
+
+rcl_ret_t
+rcl_borrow_loaned_message(const rcl_publisher_t * publisher, void ** ros_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  if (!publisher->impl->loaned_message_pool) {
+    RCL_SET_ERROR_MSG_LITERAL("loaned messages are not enabled for this publisher");
+    return RCL_RET_PUBLISHER_LOAN_FAILED;
+  }
+  // The middleware cannot loan messages, so they always come from the pool of the publisher.
+  *ros_message = rcl_impl_message_pool_acquire(publisher->impl->loaned_message_pool);
+  if (!*ros_message) {
+    RCL_SET_ERROR_MSG_LITERAL("all loaned messages of the publisher are in use");
+    return RCL_RET_PUBLISHER_LOAN_FAILED;
   }
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_publish_loaned_message(const rcl_publisher_t * publisher, void * ros_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  rcl_message_pool_t * pool = publisher->impl->loaned_message_pool;
+  if (!pool || !rcl_impl_message_pool_is_lent(pool, ros_message)) {
+    RCL_SET_ERROR_MSG_LITERAL("message is not a loaned message of this publisher");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_publisher_statistics_impl_t * statistics = publisher->impl->statistics;
+  rcl_time_point_value_t start = __publish_start(publisher->impl);
+  bool changed;
+  uint64_t hash;
+  rcl_ret_t result = rcl_impl_change_filter_check(
+    &publisher->impl->change_filter, ros_message, start, &changed, &hash);
+  if (result != RCL_RET_OK || !changed ||
+    !rcl_impl_throttle_admit(&publisher->impl->throttle, start))
+  {
+    // The loan ends either way, an error of the key function is still reported.
+    rcl_ret_t ret = rcl_impl_message_pool_release(pool, ros_message);
+    return result != RCL_RET_OK ? result : ret;
+  }
+  // Hand the message to subscriptions in this process first, they hold their own references.
+  // A gap in the sequence numbers tells a subscription that its queue dropped messages.
+  rcl_intra_process_stamp_t stamp;
+  stamp.source_timestamp = start;
+  if (!stamp.source_timestamp && rcl_steady_time_now(&stamp.source_timestamp) != RCL_RET_OK) {
+    rcl_reset_error();  // The source time is informational, and must not fail the publish.
+  }
+  stamp.sequence_number =
+    rcl_atomic_fetch_add_uint64_t(&publisher->impl->intra_process_sequence_number, 1) + 1;
+  size_t delivered_count = 0;
+  result = rcl_impl_intra_process_publish(
+    publisher->impl->intra_process.topic,
+    pool,
+    ros_message,
+    &stamp,
+    &delivered_count);
+  if (rmw_publish(publisher->impl->loaned_rmw_handle, ros_message) != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+    result = RCL_RET_ERROR;
+  } else {
+    rcl_impl_change_filter_commit(&publisher->impl->change_filter, hash, start);
+  }
+  if (statistics) {
+    __statistics_finish(statistics, start, result == RCL_RET_OK, result != RCL_RET_OK);
+  }
+  rcl_ret_t ret = rcl_impl_message_pool_release(pool, ros_message);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  return result;
+}
+
+rcl_ret_t
+rcl_return_loaned_message(const rcl_publisher_t * publisher, void * ros_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(publisher, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    publisher->impl, "publisher is invalid", return RCL_RET_PUBLISHER_INVALID);
+  if (!publisher->impl->loaned_message_pool) {
+    RCL_SET_ERROR_MSG_LITERAL("message is not a loaned message of this publisher");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  return rcl_impl_message_pool_release(publisher->impl->loaned_message_pool, ros_message);
+}
+
 const char *
 rcl_publisher_get_topic_name(const rcl_publisher_t * publisher)
 {
@@ -66,7 +66,7 @@ rcl_init(int argc, char ** argv, rcl_allocator_t allocator)
     allocator.deallocate,
     "invalid allocator, deallocate not set", return RCL_RET_INVALID_ARGUMENT);
   if (rcl_atomic_exchange_bool(&__rcl_is_initialized, true)) {
-    RCL_SET_ERROR_MSG("rcl_init called while already initialized");
+    RCL_SET_ERROR_MSG_LITERAL("rcl_init called while already initialized");
     return RCL_RET_ALREADY_INIT;
   }
   // There is a race condition between the time __rcl_is_initialized is set true,
@@ -80,7 +80,7 @@ rcl_init(int argc, char ** argv, rcl_allocator_t allocator)
   __rcl_argc = argc;
   __rcl_argv = (char **)__rcl_allocator.allocate(sizeof(char *) * argc, __rcl_allocator.state);
   if (!__rcl_argv) {
-    RCL_SET_ERROR_MSG("allocation failed");
+    RCL_SET_ERROR_MSG_LITERAL("allocation failed");
     fail_ret = RCL_RET_BAD_ALLOC;
     goto fail;
   }
@@ -94,7 +94,7 @@ rcl_init(int argc, char ** argv, rcl_allocator_t allocator)
   if (rcl_atomic_load_uint64_t(&__rcl_instance_id) == 0) {
     // Roll over occurred.
     __rcl_next_unique_id--;  // roll back to avoid the next call succeeding.
-    RCL_SET_ERROR_MSG("unique rcl instance ids exhausted");
+    RCL_SET_ERROR_MSG_LITERAL("unique rcl instance ids exhausted");
     goto fail;
   }
   return RCL_RET_OK;
@@ -107,7 +107,7 @@ rcl_ret_t
 rcl_shutdown()
 {
   if (!rcl_ok()) {
-    RCL_SET_ERROR_MSG("rcl_shutdown called before rcl_init");
+    RCL_SET_ERROR_MSG_LITERAL("rcl_shutdown called before rcl_init");
     return RCL_RET_NOT_INIT;
   }
   __clean_up_init();
@@ -0,0 +1,295 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./response_cache.h"
+
+#include <string.h>
+
+#include "./common.h"
+
+// Offset of the response behind the entry struct, in the allocation of an entry.
+#define RCL_RESPONSE_CACHE_RESPONSE_OFFSET \
+  ((sizeof(rcl_response_cache_entry_t) + 15) & ~(size_t)15)
+
+// Upper bound for the number of buckets, so a huge cache does not get a huge table up front.
+#define RCL_RESPONSE_CACHE_MAX_BUCKETS ((size_t)1 << 16)
+
+rcl_response_cache_t
+rcl_impl_get_zero_initialized_response_cache()
+{
+  static rcl_response_cache_t null_cache = {0};
+  return null_cache;
+}
+
+rcl_ret_t
+rcl_impl_response_cache_init(
+  rcl_response_cache_t * cache,
+  size_t max_byte_count,
+  rcl_duration_value_t ttl_ns,
+  size_t response_size,
+  rcl_message_copy_function_t response_copy,
+  rcl_message_fini_function_t response_fini,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(cache, RCL_RET_INVALID_ARGUMENT);
+  if (max_byte_count == 0 || response_size == 0 || ttl_ns < 0 ||
+    response_size > SIZE_MAX - RCL_RESPONSE_CACHE_RESPONSE_OFFSET - 1)
+  {
+    RCL_SET_ERROR_MSG_LITERAL("invalid response cache size");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  // Size the table for the most entries which fit, i.e. those with a key of one byte.
+  size_t entry_count = max_byte_count / (RCL_RESPONSE_CACHE_RESPONSE_OFFSET + response_size + 1);
+  size_t bucket_count = 1;
+  while (bucket_count < entry_count && bucket_count < RCL_RESPONSE_CACHE_MAX_BUCKETS) {
+    bucket_count <<= 1;
+  }
+  cache->buckets = (rcl_response_cache_entry_t **)allocator.allocate(
+    sizeof(rcl_response_cache_entry_t *) * bucket_count, allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    cache->buckets, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  memset(cache->buckets, 0, sizeof(rcl_response_cache_entry_t *) * bucket_count);
+  cache->bucket_mask = bucket_count - 1;
+  cache->lru_head = NULL;
+  cache->lru_tail = NULL;
+  cache->byte_count = 0;
+  cache->max_byte_count = max_byte_count;
+  cache->ttl_ns = ttl_ns;
+  cache->response_size = response_size;
+  cache->response_copy = response_copy;
+  cache->response_fini = response_fini;
+  cache->allocator = allocator;
+  return RCL_RET_OK;
+}
+
+void
+rcl_impl_response_cache_fini(rcl_response_cache_t * cache)
+{
+  rcl_response_cache_entry_t * entry = cache->lru_head;
+  while (entry) {
+    rcl_response_cache_entry_t * next = entry->lru_next;
+    rcl_impl_response_cache_entry_destroy(cache, entry);
+    entry = next;
+  }
+  cache->lru_head = NULL;
+  cache->lru_tail = NULL;
+  cache->byte_count = 0;
+  if (cache->buckets) {
+    cache->allocator.deallocate(cache->buckets, cache->allocator.state);
+    cache->buckets = NULL;
+  }
+}
+
+// FNV-1a, the keys are short and hashed once per request.
+static uint64_t
+__hash(const uint8_t * key, size_t key_length)
+{
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  size_t i;
+  for (i = 0; i < key_length; ++i) {
+    hash ^= key[i];
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+static bool
+__is_expired(
+  const rcl_response_cache_t * cache,
+  const rcl_response_cache_entry_t * entry,
+  rcl_time_point_value_t now)
+{
+  return cache->ttl_ns > 0 && now > entry->stored_at &&
+         now - entry->stored_at > (rcl_time_point_value_t)cache->ttl_ns;
+}
+
+// Return the link in the bucket which points to the entry with the key, or to NULL if none does.
+static rcl_response_cache_entry_t **
+__find(rcl_response_cache_t * cache, uint64_t hash, const uint8_t * key, size_t key_length)
+{
+  rcl_response_cache_entry_t ** it = &cache->buckets[hash & cache->bucket_mask];
+  while (*it) {
+    if ((*it)->hash == hash && (*it)->key_length == key_length &&
+      memcmp((*it)->key, key, key_length) == 0)
+    {
+      break;
+    }
+    it = &(*it)->bucket_next;
+  }
+  return it;
+}
+
+static void
+__lru_unlink(rcl_response_cache_t * cache, rcl_response_cache_entry_t * entry)
+{
+  if (entry->lru_prev) {
+    entry->lru_prev->lru_next = entry->lru_next;
+  } else {
+    cache->lru_head = entry->lru_next;
+  }
+  if (entry->lru_next) {
+    entry->lru_next->lru_prev = entry->lru_prev;
+  } else {
+    cache->lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = NULL;
+  entry->lru_next = NULL;
+}
+
+static void
+__lru_push_front(rcl_response_cache_t * cache, rcl_response_cache_entry_t * entry)
+{
+  entry->lru_prev = NULL;
+  entry->lru_next = cache->lru_head;
+  if (cache->lru_head) {
+    cache->lru_head->lru_prev = entry;
+  } else {
+    cache->lru_tail = entry;
+  }
+  cache->lru_head = entry;
+}
+
+// Unlink the entry which the bucket link points to from the cache.
+static void
+__remove(rcl_response_cache_t * cache, rcl_response_cache_entry_t ** link)
+{
+  rcl_response_cache_entry_t * entry = *link;
+  *link = entry->bucket_next;
+  entry->bucket_next = NULL;
+  __lru_unlink(cache, entry);
+  cache->byte_count -= entry->byte_count;
+}
+
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_entry_create(
+  const rcl_response_cache_t * cache,
+  const uint8_t * key,
+  size_t key_length,
+  const void * ros_response,
+  rcl_time_point_value_t now)
+{
+  size_t key_offset = RCL_RESPONSE_CACHE_RESPONSE_OFFSET + cache->response_size;
+  if (key_length > SIZE_MAX - key_offset) {
+    RCL_SET_ERROR_MSG_LITERAL("request key is too large");
+    return NULL;
+  }
+  size_t byte_count = key_offset + key_length;
+  char * storage = (char *)cache->allocator.allocate(byte_count, cache->allocator.state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(storage, "allocating memory failed", return NULL);
+  memset(storage, 0, key_offset);
+  rcl_response_cache_entry_t * entry = (rcl_response_cache_entry_t *)storage;
+  entry->hash = __hash(key, key_length);
+  entry->stored_at = now;
+  entry->byte_count = byte_count;
+  entry->key_length = key_length;
+  entry->key = (const uint8_t *)(storage + key_offset);
+  entry->ros_response = storage + RCL_RESPONSE_CACHE_RESPONSE_OFFSET;
+  atomic_init(&entry->reference_count, 1);
+  memcpy(storage + key_offset, key, key_length);
+  if (!cache->response_copy) {
+    memcpy(entry->ros_response, ros_response, cache->response_size);
+  } else if (!cache->response_copy(ros_response, entry->ros_response)) {
+    cache->allocator.deallocate(storage, cache->allocator.state);
+    RCL_SET_ERROR_MSG_LITERAL("copying the response failed");
+    return NULL;
+  }
+  return entry;
+}
+
+void
+rcl_impl_response_cache_entry_destroy(
+  const rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry)
+{
+  if (cache->response_fini) {
+    cache->response_fini(entry->ros_response);
+  }
+  cache->allocator.deallocate(entry, cache->allocator.state);
+}
+
+void
+rcl_impl_response_cache_entry_release(
+  const rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry)
+{
+  if (rcl_atomic_fetch_sub_uint64_t(&entry->reference_count, 1) == 1) {
+    rcl_impl_response_cache_entry_destroy(cache, entry);
+  }
+}
+
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_lookup(
+  rcl_response_cache_t * cache,
+  const uint8_t * key,
+  size_t key_length,
+  rcl_time_point_value_t now)
+{
+  rcl_response_cache_entry_t * entry = *__find(cache, __hash(key, key_length), key, key_length);
+  // Expired entries are left for insert to replace or evict, so lookups never free memory.
+  if (!entry || __is_expired(cache, entry, now)) {
+    return NULL;
+  }
+  __lru_unlink(cache, entry);
+  __lru_push_front(cache, entry);
+  rcl_atomic_fetch_add_uint64_t(&entry->reference_count, 1);
+  return entry;
+}
+
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_insert(
+  rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry,
+  rcl_time_point_value_t now)
+{
+  rcl_response_cache_entry_t * removed = NULL;
+  rcl_response_cache_entry_t ** link = __find(cache, entry->hash, entry->key, entry->key_length);
+  if (*link) {
+    rcl_response_cache_entry_t * existing = *link;
+    if (!__is_expired(cache, existing, now)) {
+      // Another worker answered the same request first, keep its response.
+      __lru_unlink(cache, existing);
+      __lru_push_front(cache, existing);
+      entry->lru_next = NULL;
+      return entry;
+    }
+    __remove(cache, link);
+    existing->lru_next = removed;
+    removed = existing;
+  }
+  if (entry->byte_count > cache->max_byte_count) {
+    entry->lru_next = removed;
+    return entry;
+  }
+  while (cache->byte_count + entry->byte_count > cache->max_byte_count) {
+    rcl_response_cache_entry_t * victim = cache->lru_tail;
+    __remove(cache, __find(cache, victim->hash, victim->key, victim->key_length));
+    victim->lru_next = removed;
+    removed = victim;
+  }
+  rcl_response_cache_entry_t ** bucket = &cache->buckets[entry->hash & cache->bucket_mask];
+  entry->bucket_next = *bucket;
+  *bucket = entry;
+  __lru_push_front(cache, entry);
+  cache->byte_count += entry->byte_count;
+  return removed;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,176 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__RESPONSE_CACHE_H_
+#define RCL__RESPONSE_CACHE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rcl/allocator.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// A cached response, allocated together with its key and a copy of the response.
+typedef struct rcl_response_cache_entry_t
+{
+  /// Next entry in the same bucket.
+  struct rcl_response_cache_entry_t * bucket_next;
+  /// Neighbours in the list of entries, ordered from most to least recently used.
+  struct rcl_response_cache_entry_t * lru_prev;
+  struct rcl_response_cache_entry_t * lru_next;
+  uint64_t hash;
+  /// Steady time at which the response was stored.
+  rcl_time_point_value_t stored_at;
+  /// Bytes the entry counts against the size of the cache.
+  size_t byte_count;
+  size_t key_length;
+  const uint8_t * key;
+  void * ros_response;
+  /// Held by the cache while the entry is in it, and by each sender of the response.
+  atomic_uint_least64_t reference_count;
+} rcl_response_cache_entry_t;
+
+/// Responses of a service keyed by the bytes of their requests, evicted least recently used first.
+/* The table uses separate chaining with a fixed number of buckets, chosen
+ * from the size of the cache, so inserting never reallocates the buckets.
+ * Entries are allocated and released by the caller, outside of the lock
+ * which protects the cache, so that the copy and fini functions of the
+ * response are not called with the lock held.
+ *
+ * The cache is not thread-safe, the service protects it with a lock.
+ */
+typedef struct rcl_response_cache_t
+{
+  rcl_response_cache_entry_t ** buckets;
+  /// Number of buckets minus 1, the number of buckets is a power of two.
+  size_t bucket_mask;
+  /// Most and least recently used entries.
+  rcl_response_cache_entry_t * lru_head;
+  rcl_response_cache_entry_t * lru_tail;
+  /// Bytes used by all entries, at most max_byte_count.
+  size_t byte_count;
+  size_t max_byte_count;
+  /// Time after which a response is no longer used, or 0 for no limit.
+  rcl_duration_value_t ttl_ns;
+  /// Size of the C response struct.
+  size_t response_size;
+  /// Function used to copy responses into entries, or NULL for a shallow copy.
+  rcl_message_copy_function_t response_copy;
+  /// Function used to finalize copied responses, or NULL.
+  rcl_message_fini_function_t response_fini;
+  /// Allocator used to allocate the buckets and the entries.
+  rcl_allocator_t allocator;
+} rcl_response_cache_t;
+
+/// Return a rcl_response_cache_t with members set to NULL or 0.
+rcl_response_cache_t
+rcl_impl_get_zero_initialized_response_cache(void);
+
+/// Allocate the buckets of a cache holding responses of up to max_byte_count bytes in total.
+/* \return RCL_RET_OK if the cache was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if any arguments are invalid, or
+ *         RCL_RET_BAD_ALLOC if allocating memory failed.
+ */
+rcl_ret_t
+rcl_impl_response_cache_init(
+  rcl_response_cache_t * cache,
+  size_t max_byte_count,
+  rcl_duration_value_t ttl_ns,
+  size_t response_size,
+  rcl_message_copy_function_t response_copy,
+  rcl_message_fini_function_t response_fini,
+  rcl_allocator_t allocator);
+
+/// Destroy all entries and free the buckets.
+void
+rcl_impl_response_cache_fini(rcl_response_cache_t * cache);
+
+/// Allocate an entry holding a copy of the key and of the response, or return NULL.
+/* The cache is only read, so this can be called without holding its lock.
+ * The entry starts with one reference, which is handed to the cache by
+ * rcl_impl_response_cache_insert().
+ * The rcl error state is set if NULL is returned.
+ */
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_entry_create(
+  const rcl_response_cache_t * cache,
+  const uint8_t * key,
+  size_t key_length,
+  const void * ros_response,
+  rcl_time_point_value_t now);
+
+/// Finalize the response of an entry and deallocate it, regardless of its references.
+void
+rcl_impl_response_cache_entry_destroy(
+  const rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry);
+
+/// Give up a reference to an entry, and destroy it after the last one.
+/* Does not need the lock of the cache, since an entry which is referenced
+ * outside of the cache has already been removed from it, or is kept alive by
+ * the reference of the cache.
+ *
+ * This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free, unless the fini function of the response is not.
+ */
+void
+rcl_impl_response_cache_entry_release(
+  const rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry);
+
+/// Return the entry stored for the key, or NULL if there is none or it is too old.
+/* A found entry becomes the most recently used one, and gets a reference for
+ * the caller, so its response stays valid after the lock of the cache is
+ * released, even if the entry is evicted meanwhile.
+ * The caller must give the reference up with rcl_impl_response_cache_entry_release().
+ *
+ * This function does not allocate heap memory.
+ */
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_lookup(
+  rcl_response_cache_t * cache,
+  const uint8_t * key,
+  size_t key_length,
+  rcl_time_point_value_t now);
+
+/// Add an entry as the most recently used one, evicting entries to make room for it.
+/* If the key already has a response which is not too old, the existing one
+ * is kept, and the new entry is not added.
+ * The entries which were evicted, or not added, are returned as a list linked
+ * by lru_next, to be released by the caller after releasing the lock.
+ *
+ * This function does not allocate heap memory.
+ *
+ * \return the list of entries to destroy, or NULL.
+ */
+rcl_response_cache_entry_t *
+rcl_impl_response_cache_insert(
+  rcl_response_cache_t * cache,
+  rcl_response_cache_entry_t * entry,
+  rcl_time_point_value_t now);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__RESPONSE_CACHE_H_
@@ -0,0 +1,96 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "rcl/serialized_message.h"
+
+#include "./common.h"
+
+rcl_serialized_message_t
+rcl_get_zero_initialized_serialized_message()
+{
+  static rcl_serialized_message_t null_serialized_message = {0};
+  return null_serialized_message;
+}
+
+rcl_ret_t
+rcl_serialized_message_init(
+  rcl_serialized_message_t * serialized_message,
+  size_t capacity,
+  rcl_allocator_t allocator)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  if (serialized_message->buffer) {
+    RCL_SET_ERROR_MSG_LITERAL(
+      "serialized message already initialized, or memory was uninitialized");
+    return RCL_RET_ALREADY_INIT;
+  }
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    allocator.reallocate, "reallocate not set", return RCL_RET_INVALID_ARGUMENT);
+  serialized_message->buffer_length = 0;
+  serialized_message->buffer_capacity = 0;
+  serialized_message->allocator = allocator;
+  if (capacity > 0) {
+    serialized_message->buffer = (uint8_t *)allocator.allocate(capacity, allocator.state);
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      serialized_message->buffer, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+    serialized_message->buffer_capacity = capacity;
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_serialized_message_reserve(rcl_serialized_message_t * serialized_message, size_t capacity)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    serialized_message->allocator.reallocate,
+    "serialized message is not initialized", return RCL_RET_INVALID_ARGUMENT);
+  if (capacity <= serialized_message->buffer_capacity) {
+    return RCL_RET_OK;
+  }
+  rcl_allocator_t * allocator = &serialized_message->allocator;
+  uint8_t * new_buffer =
+    (uint8_t *)allocator->reallocate(serialized_message->buffer, capacity, allocator->state);
+  RCL_CHECK_FOR_NULL_WITH_MSG(new_buffer, "allocating memory failed", return RCL_RET_BAD_ALLOC);
+  serialized_message->buffer = new_buffer;
+  serialized_message->buffer_capacity = capacity;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_serialized_message_fini(rcl_serialized_message_t * serialized_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(serialized_message, RCL_RET_INVALID_ARGUMENT);
+  if (serialized_message->buffer) {
+    rcl_allocator_t allocator = serialized_message->allocator;
+    RCL_CHECK_FOR_NULL_WITH_MSG(
+      allocator.deallocate, "deallocate not set", return RCL_RET_INVALID_ARGUMENT);
+    allocator.deallocate(serialized_message->buffer, allocator.state);
+  }
+  *serialized_message = rcl_get_zero_initialized_serialized_message();
+  return RCL_RET_OK;
+}
+
+#if __cplusplus
+}
+#endif
@@ -22,12 +22,41 @@ extern "C"
 #include <string.h>
 
 #include "./common.h"
+#include "./intra_process.h"
+#include "./message_pool.h"
+#include "./response_cache.h"
+#include "./stdatomic_helper.h"
 #include "rmw/rmw.h"
 
+// Offset of the request message behind its rcl_service_request_t in a slot of the request pool.
+#define RCL_SERVICE_REQUEST_OFFSET ((sizeof(rcl_service_request_t) + 15) & ~(size_t)15)
+
 typedef struct rcl_service_impl_t
 {
   rcl_service_options_t options;
   rmw_service_t * rmw_handle;
+  // Slots of admitted requests, each a rcl_service_request_t followed by the request message.
+  // The first request_init_count messages are initialized.
+  rcl_message_pool_t request_pool;
+  size_t request_init_count;
+  // Admitted requests which no worker has taken yet.
+  rcl_intra_process_queue_t admitted_requests;
+  // Triggered each time a request is admitted.
+  rcl_guard_condition_t admission_guard_condition;
+  // Requests taken with rcl_take_request() and not answered yet, if max_requests_in_flight is set.
+  atomic_uint_least64_t requests_in_flight;
+  // Requests dropped because too many were in flight, or because they were too old.
+  atomic_uint_least64_t overloaded_count;
+  atomic_uint_least64_t expired_count;
+  // Responses to previous requests, protected by the lock.
+  rcl_response_cache_t response_cache;
+  atomic_bool response_cache_lock;
+  // Keys of the requests being taken by rcl_take_request() and by rcl_service_admit_requests(),
+  // each only used by the thread calling that function.
+  rcl_serialized_message_t take_request_key;
+  rcl_serialized_message_t admit_request_key;
+  atomic_uint_least64_t response_cache_hit_count;
+  atomic_uint_least64_t response_cache_miss_count;
 } rcl_service_impl_t;
 
 rcl_service_t
@@ -37,6 +66,193 @@ rcl_get_zero_initialized_service()
   return null_service;
 }
 
+// Finalize the admission queue and the initialized requests, and deallocate them.
+static rcl_ret_t
+__admission_fini(rcl_service_impl_t * impl)
+{
+  rcl_ret_t result = RCL_RET_OK;
+  // If init failed early the options are not set yet, but then no request was initialized.
+  if (impl->request_init_count > 0 && impl->options.request_fini) {
+    size_t i;
+    for (i = 0; i < impl->request_init_count; ++i) {
+      rcl_service_request_t * request =
+        (rcl_service_request_t *)rcl_impl_message_pool_get_message(&impl->request_pool, i);
+      impl->options.request_fini(request->ros_request);
+    }
+  }
+  impl->request_init_count = 0;
+  rcl_impl_message_pool_fini(&impl->request_pool);
+  rcl_impl_intra_process_queue_fini(&impl->admitted_requests);
+  if (impl->admission_guard_condition.impl &&
+    rcl_guard_condition_fini(&impl->admission_guard_condition) != RCL_RET_OK)
+  {
+    result = RCL_RET_ERROR;  // rcl error state should already be set.
+  }
+  return result;
+}
+
+// Allocate and initialize the admission queue, see rcl_service_admit_requests().
+static rcl_ret_t
+__admission_init(rcl_service_impl_t * impl, const rcl_service_options_t * options)
+{
+  if (options->request_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("request_size must be greater than 0 to admit requests");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  if (options->request_size > SIZE_MAX - RCL_SERVICE_REQUEST_OFFSET) {
+    RCL_SET_ERROR_MSG_LITERAL("request_size is too large");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_ret_t ret = rcl_impl_message_pool_init(
+    &impl->request_pool,
+    options->request_queue_size,
+    RCL_SERVICE_REQUEST_OFFSET + options->request_size,
+    options->allocator);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  ret = rcl_impl_intra_process_queue_init(
+    &impl->admitted_requests, options->request_queue_size, options->allocator);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_guard_condition_options_t guard_condition_options =
+    rcl_guard_condition_get_default_options();
+  guard_condition_options.allocator = options->allocator;
+  ret = rcl_guard_condition_init(&impl->admission_guard_condition, guard_condition_options);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  // Construct every request now, so admitting requests later does not have to.
+  for (; impl->request_init_count < options->request_queue_size; ++impl->request_init_count) {
+    rcl_service_request_t * request = (rcl_service_request_t *)rcl_impl_message_pool_get_message(
+      &impl->request_pool, impl->request_init_count);
+    request->ros_request = (char *)request + RCL_SERVICE_REQUEST_OFFSET;
+    if (options->request_init && !options->request_init(request->ros_request)) {
+      RCL_SET_ERROR_MSG_LITERAL("initializing a queued request failed");
+      return RCL_RET_BAD_ALLOC;
+    }
+  }
+  return RCL_RET_OK;
+}
+
+// Destroy the cached responses and deallocate the cache.
+static rcl_ret_t
+__response_cache_fini(rcl_service_impl_t * impl)
+{
+  rcl_impl_response_cache_fini(&impl->response_cache);
+  rcl_ret_t take_ret = rcl_serialized_message_fini(&impl->take_request_key);
+  rcl_ret_t admit_ret = rcl_serialized_message_fini(&impl->admit_request_key);
+  return take_ret != RCL_RET_OK ? take_ret : admit_ret;
+}
+
+// Return the current steady time, or 0 if the clock cannot be read.
+static rcl_time_point_value_t
+__steady_now()
+{
+  rcl_time_point_value_t now = 0;
+  if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+    rcl_reset_error();
+    return 0;
+  }
+  return now;
+}
+
+// Get the key of a request, written into buffer by the request_key option.
+static rcl_ret_t
+__get_request_key(
+  const rcl_service_impl_t * impl,
+  const void * ros_request,
+  rcl_serialized_message_t * buffer,
+  const uint8_t ** key,
+  size_t * key_length)
+{
+  buffer->buffer_length = 0;
+  rcl_ret_t ret = impl->options.request_key(ros_request, buffer);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  if (buffer->buffer_length > buffer->buffer_capacity) {
+    RCL_SET_ERROR_MSG_LITERAL("request key length exceeds its capacity");
+    return RCL_RET_ERROR;
+  }
+  *key = buffer->buffer;
+  *key_length = buffer->buffer_length;
+  return RCL_RET_OK;
+}
+
+// Send the cached response to a taken request, if there is one, without calling user code.
+static rcl_ret_t
+__send_cached_response(
+  rcl_service_impl_t * impl,
+  rcl_serialized_message_t * key_buffer,
+  rmw_request_id_t * request_header,
+  const void * ros_request,
+  bool * sent)
+{
+  *sent = false;
+  const uint8_t * key;
+  size_t key_length;
+  rcl_ret_t ret = __get_request_key(impl, ros_request, key_buffer, &key, &key_length);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  rcl_time_point_value_t now = __steady_now();
+  rcl_response_cache_entry_t * entry = NULL;
+  if (now) {
+    rcl_atomic_spin_lock(&impl->response_cache_lock);
+    entry = rcl_impl_response_cache_lookup(&impl->response_cache, key, key_length, now);
+    rcl_atomic_spin_unlock(&impl->response_cache_lock);
+  }
+  if (!entry) {
+    rcl_atomic_fetch_add_uint64_t(&impl->response_cache_miss_count, 1);
+    return RCL_RET_OK;
+  }
+  // The reference keeps the response alive while it is sent, even if it is evicted meanwhile.
+  rmw_ret_t rmw_ret = rmw_send_response(impl->rmw_handle, request_header, entry->ros_response);
+  rcl_impl_response_cache_entry_release(&impl->response_cache, entry);
+  *sent = true;
+  if (rmw_ret != RMW_RET_OK) {
+    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+    return RCL_RET_ERROR;
+  }
+  rcl_atomic_fetch_add_uint64_t(&impl->response_cache_hit_count, 1);
+  return RCL_RET_OK;
+}
+
+// Return true if rcl_take_request() counts the requests in flight, see max_requests_in_flight.
+static bool
+__limits_requests_in_flight(const rcl_service_impl_t * impl)
+{
+  return impl->options.max_requests_in_flight > 0 && impl->options.request_queue_size == 0;
+}
+
+// Count a taken request as in flight, or return false if the limit is reached.
+static bool
+__acquire_request_in_flight(rcl_service_impl_t * impl)
+{
+  uint64_t in_flight = rcl_atomic_load_uint64_t(&impl->requests_in_flight);
+  do {
+    if (in_flight >= impl->options.max_requests_in_flight) {
+      return false;
+    }
+  } while (!rcl_atomic_compare_exchange_strong_uint_least64_t(
+    &impl->requests_in_flight, &in_flight, in_flight + 1));
+  return true;
+}
+
+// Stop counting a request as in flight, saturating at 0.
+static void
+__release_request_in_flight(rcl_service_impl_t * impl)
+{
+  uint64_t in_flight = rcl_atomic_load_uint64_t(&impl->requests_in_flight);
+  while (in_flight > 0 && !rcl_atomic_compare_exchange_strong_uint_least64_t(
+      &impl->requests_in_flight, &in_flight, in_flight - 1))
+  {
+    // in_flight was updated to the current value, try again.
+  }
+}
+
 rcl_ret_t
 rcl_service_init(
   rcl_service_t * service,
@@ -49,16 +265,23 @@ rcl_service_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (!node->impl) {
-    RCL_SET_ERROR_MSG("invalid node");
+    RCL_SET_ERROR_MSG_LITERAL("invalid node");
     return RCL_RET_NODE_INVALID;
   }
   RCL_CHECK_ARGUMENT_FOR_NULL(type_support, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(service_name, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   if (service->impl) {
-    RCL_SET_ERROR_MSG("service already initialized, or memory was unintialized");
+    RCL_SET_ERROR_MSG_LITERAL("service already initialized, or memory was unintialized");
     return RCL_RET_ALREADY_INIT;
   }
+  if (rcl_impl_validate_qos_profile(&options->qos) != RCL_RET_OK) {
+    return RCL_RET_INVALID_ARGUMENT;  // rcl error state should already be set.
+  }
+  if (options->max_request_age_ns < 0) {
+    RCL_SET_ERROR_MSG_LITERAL("max_request_age_ns must not be negative");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
   const rcl_allocator_t * allocator = &options->allocator;
   RCL_CHECK_FOR_NULL_WITH_MSG(
     allocator->allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
@@ -70,23 +293,85 @@ rcl_service_init(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     service->impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
   // Fill out implementation struct.
+  service->impl->request_pool = rcl_impl_get_zero_initialized_message_pool();
+  service->impl->request_init_count = 0;
+  memset(&service->impl->admitted_requests, 0, sizeof(rcl_intra_process_queue_t));
+  service->impl->admission_guard_condition = rcl_get_zero_initialized_guard_condition();
+  atomic_init(&service->impl->requests_in_flight, 0);
+  atomic_init(&service->impl->overloaded_count, 0);
+  atomic_init(&service->impl->expired_count, 0);
+  service->impl->response_cache = rcl_impl_get_zero_initialized_response_cache();
+  atomic_init(&service->impl->response_cache_lock, false);
+  service->impl->take_request_key = rcl_get_zero_initialized_serialized_message();
+  service->impl->admit_request_key = rcl_get_zero_initialized_serialized_message();
+  atomic_init(&service->impl->response_cache_hit_count, 0);
+  atomic_init(&service->impl->response_cache_miss_count, 0);
   // rmw handle (create rmw service)
   // TODO(wjwwood): pass along the allocator to rmw when it supports it
   service->impl->rmw_handle = rmw_create_service(
     rcl_node_get_rmw_handle(node),
     type_support,
     service_name,
-    &rmw_qos_profile_default);
+    &options->qos);
   if (!service->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
     goto fail;
   }
   // options
   service->impl->options = *options;
+  // admission queue
+  if (options->request_queue_size > 0) {
+    rcl_ret_t ret = __admission_init(service->impl, options);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
+  // response cache
+  if (options->response_cache_size > 0) {
+    if (!options->request_key) {
+      RCL_SET_ERROR_MSG_LITERAL("request_key must be set to cache responses");
+      fail_ret = RCL_RET_INVALID_ARGUMENT;
+      goto fail;
+    }
+    if (options->response_fini && !options->response_copy) {
+      RCL_SET_ERROR_MSG_LITERAL("response_fini requires response_copy");
+      fail_ret = RCL_RET_INVALID_ARGUMENT;
+      goto fail;
+    }
+    rcl_ret_t ret = rcl_impl_response_cache_init(
+      &service->impl->response_cache,
+      options->response_cache_size,
+      options->response_cache_ttl_ns,
+      options->response_size,
+      options->response_copy,
+      options->response_fini,
+      options->allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+    ret = rcl_serialized_message_init(&service->impl->take_request_key, 0, options->allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+    ret = rcl_serialized_message_init(&service->impl->admit_request_key, 0, options->allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
   return RCL_RET_OK;
 fail:
   if (service->impl) {
+    (void)__response_cache_fini(service->impl);
+    (void)__admission_fini(service->impl);
+    if (service->impl->rmw_handle) {
+      (void)rmw_destroy_service(service->impl->rmw_handle);
+    }
     allocator->deallocate(service->impl, allocator->state);
+    service->impl = NULL;
   }
   return fail_ret;
 }
@@ -98,6 +383,11 @@ rcl_service_fini(rcl_service_t * service, rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (service->impl) {
+    // Requests which are still admitted are dropped without a response.
+    result = __admission_fini(service->impl);
+    if (__response_cache_fini(service->impl) != RCL_RET_OK) {
+      result = RCL_RET_ERROR;  // rcl error state should already be set.
+    }
     rmw_ret_t ret =
       rmw_destroy_service(service->impl->rmw_handle);
     if (ret != RMW_RET_OK) {
@@ -162,15 +452,33 @@ rcl_take_request(
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_request, RCL_RET_INVALID_ARGUMENT);
 
   bool taken = false;
-  if (rmw_take_request(
-      service->impl->rmw_handle, request_header, ros_request, &taken) != RMW_RET_OK)
+  bool answered = false;
+  do {
+    if (rmw_take_request(
+        service->impl->rmw_handle, request_header, ros_request, &taken) != RMW_RET_OK)
+    {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      return RCL_RET_ERROR;
+    }
+    if (!taken) {
+      // Nothing to take is expected when polling, so no error message is set.
+      return RCL_RET_SERVICE_TAKE_FAILED;
+    }
+    // Requests answered from the cache are never seen by the caller, so take the next one.
+    if (service->impl->options.response_cache_size > 0) {
+      rcl_ret_t ret = __send_cached_response(
+        service->impl, &service->impl->take_request_key, request_header, ros_request, &answered);
+      if (ret != RCL_RET_OK) {
+        return ret;  // rcl error state should already be set.
+      }
+    }
+  } while (answered);
+  if (__limits_requests_in_flight(service->impl) &&
+    !__acquire_request_in_flight(service->impl))
   {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
-    return RCL_RET_ERROR;
-  }
-  if (!taken) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
-    return RCL_RET_CLIENT_TAKE_FAILED;
+    // Drop the request without doing any work for it, the client will time out.
+    rcl_atomic_fetch_add_uint64_t(&service->impl->overloaded_count, 1);
+    return RCL_RET_SERVICE_REQUEST_SHED;
   }
   return RCL_RET_OK;
 }
@@ -187,6 +495,10 @@ rcl_send_response(
   RCL_CHECK_ARGUMENT_FOR_NULL(request_header, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(ros_response, RCL_RET_INVALID_ARGUMENT);
 
+  // The request is answered even if sending fails, so it is no longer in flight.
+  if (__limits_requests_in_flight(service->impl)) {
+    __release_request_in_flight(service->impl);
+  }
   if (rmw_send_response(
       service->impl->rmw_handle, request_header, ros_response) != RMW_RET_OK)
   {
@@ -197,6 +509,240 @@ rcl_send_response(
   return RCL_RET_OK;
 }
 
+rcl_ret_t
+rcl_service_abandon_request(const rcl_service_t * service)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  if (__limits_requests_in_flight(service->impl)) {
+    __release_request_in_flight(service->impl);
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_service_admit_requests(const rcl_service_t * service, size_t * admitted_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  rcl_service_impl_t * impl = service->impl;
+  if (admitted_count) {
+    *admitted_count = 0;
+  }
+  if (impl->request_pool.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("the admission queue is not enabled for this service");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  for (;;) {
+    rcl_service_request_t * request =
+      (rcl_service_request_t *)rcl_impl_message_pool_acquire(&impl->request_pool);
+    if (!request) {
+      // Back-pressure is expected under load, so no error message is set.
+      return RCL_RET_SERVICE_QUEUE_FULL;
+    }
+    bool taken = false;
+    if (rmw_take_request(
+        impl->rmw_handle, &request->request_header, request->ros_request, &taken) != RMW_RET_OK)
+    {
+      (void)rcl_impl_message_pool_release(&impl->request_pool, request);
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      return RCL_RET_ERROR;
+    }
+    if (!taken) {
+      (void)rcl_impl_message_pool_release(&impl->request_pool, request);
+      return RCL_RET_OK;
+    }
+    if (impl->options.response_cache_size > 0) {
+      bool answered;
+      rcl_ret_t ret = __send_cached_response(
+        impl, &impl->admit_request_key, &request->request_header, request->ros_request,
+        &answered);
+      if (ret != RCL_RET_OK || answered) {
+        // Answered requests give their place in the queue back right away.
+        (void)rcl_impl_message_pool_release(&impl->request_pool, request);
+        if (ret != RCL_RET_OK) {
+          return ret;  // rcl error state should already be set.
+        }
+        continue;
+      }
+    }
+    if (rcl_steady_time_now(&request->admitted_timestamp) != RCL_RET_OK) {
+      request->admitted_timestamp = 0;
+      rcl_reset_error();  // The timestamp is informational, and must not lose the request.
+    }
+    // The queue holds as many requests as the pool, so there is always room.
+    (void)rcl_impl_intra_process_queue_enqueue(
+      &impl->admitted_requests, request, &impl->request_pool, NULL);
+    if (admitted_count) {
+      ++(*admitted_count);
+    }
+    if (rcl_trigger_guard_condition(&impl->admission_guard_condition) != RCL_RET_OK) {
+      return RCL_RET_ERROR;  // rcl error state should already be set.
+    }
+  }
+}
+
+rcl_ret_t
+rcl_service_take_admitted_request(
+  const rcl_service_t * service,
+  rcl_service_request_t ** request)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(request, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  if (service->impl->request_pool.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("the admission queue is not enabled for this service");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_service_impl_t * impl = service->impl;
+  rcl_time_point_value_t max_age = (rcl_time_point_value_t)impl->options.max_request_age_ns;
+  rcl_time_point_value_t now = 0;
+  for (;;) {
+    const void * message;
+    rcl_message_pool_t * pool;
+    if (!rcl_impl_intra_process_queue_dequeue(&impl->admitted_requests, &message, &pool, NULL)) {
+      // Nothing to take is expected when polling, so no error message is set.
+      return RCL_RET_SERVICE_TAKE_FAILED;
+    }
+    rcl_service_request_t * admitted = (rcl_service_request_t *)message;
+    if (max_age > 0 && admitted->admitted_timestamp) {
+      if (!now && rcl_steady_time_now(&now) != RCL_RET_OK) {
+        rcl_reset_error();  // Without a clock no request is considered too old.
+      }
+      if (now > admitted->admitted_timestamp && now - admitted->admitted_timestamp > max_age) {
+        // Drop the request before a worker does any work for it, the client will time out.
+        (void)rcl_impl_message_pool_release(&impl->request_pool, admitted);
+        rcl_atomic_fetch_add_uint64_t(&impl->expired_count, 1);
+        continue;
+      }
+    }
+    *request = admitted;
+    return RCL_RET_OK;
+  }
+}
+
+rcl_ret_t
+rcl_service_release_admitted_request(
+  const rcl_service_t * service,
+  rcl_service_request_t * request)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(request, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  // The request stays initialized, so its memory is reused by the next admitted request.
+  return rcl_impl_message_pool_release(&service->impl->request_pool, request);
+}
+
+rcl_ret_t
+rcl_service_get_shed_request_counts(
+  const rcl_service_t * service,
+  uint64_t * overloaded_count,
+  uint64_t * expired_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  if (overloaded_count) {
+    *overloaded_count = rcl_atomic_load_uint64_t(&service->impl->overloaded_count);
+  }
+  if (expired_count) {
+    *expired_count = rcl_atomic_load_uint64_t(&service->impl->expired_count);
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_service_cache_response(
+  const rcl_service_t * service,
+  const void * ros_request,
+  const void * ros_response)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_request, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_response, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  rcl_service_impl_t * impl = service->impl;
+  if (impl->options.response_cache_size == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("the response cache is not enabled for this service");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  rcl_time_point_value_t now = __steady_now();
+  if (!now) {
+    return RCL_RET_OK;  // Without a clock the age of the response is unknown, skip it.
+  }
+  // This can be called from any worker, so the key is written into a buffer of its own.
+  rcl_serialized_message_t key_buffer = rcl_get_zero_initialized_serialized_message();
+  rcl_ret_t ret = rcl_serialized_message_init(&key_buffer, 0, impl->options.allocator);
+  if (ret != RCL_RET_OK) {
+    return ret;  // rcl error state should already be set.
+  }
+  const uint8_t * key;
+  size_t key_length;
+  ret = __get_request_key(impl, ros_request, &key_buffer, &key, &key_length);
+  rcl_response_cache_entry_t * entry = NULL;
+  if (ret == RCL_RET_OK) {
+    entry = rcl_impl_response_cache_entry_create(
+      &impl->response_cache, key, key_length, ros_response, now);
+    if (!entry) {
+      ret = RCL_RET_BAD_ALLOC;  // rcl error state should already be set.
+    }
+  }
+  rcl_ret_t fini_ret = rcl_serialized_message_fini(&key_buffer);
+  if (ret != RCL_RET_OK || fini_ret != RCL_RET_OK) {
+    if (entry) {
+      rcl_impl_response_cache_entry_destroy(&impl->response_cache, entry);
+    }
+    return ret != RCL_RET_OK ? ret : fini_ret;  // rcl error state should already be set.
+  }
+  rcl_atomic_spin_lock(&impl->response_cache_lock);
+  rcl_response_cache_entry_t * removed =
+    rcl_impl_response_cache_insert(&impl->response_cache, entry, now);
+  rcl_atomic_spin_unlock(&impl->response_cache_lock);
+  // Finalize the evicted responses outside of the lock, unless they are still being sent.
+  while (removed) {
+    rcl_response_cache_entry_t * next = removed->lru_next;
+    rcl_impl_response_cache_entry_release(&impl->response_cache, removed);
+    removed = next;
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_service_get_response_cache_counts(
+  const rcl_service_t * service,
+  uint64_t * hit_count,
+  uint64_t * miss_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return RCL_RET_SERVICE_INVALID);
+  if (hit_count) {
+    *hit_count = rcl_atomic_load_uint64_t(&service->impl->response_cache_hit_count);
+  }
+  if (miss_count) {
+    *miss_count = rcl_atomic_load_uint64_t(&service->impl->response_cache_miss_count);
+  }
+  return RCL_RET_OK;
+}
+
+const rcl_guard_condition_t *
+rcl_service_get_admission_guard_condition(const rcl_service_t * service)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(service, NULL);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    service->impl, "service is invalid", return NULL);
+  if (service->impl->request_pool.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("the admission queue is not enabled for this service");
+    return NULL;
+  }
+  return &service->impl->admission_guard_condition;
+}
+
 #if __cplusplus
 }
 #endif
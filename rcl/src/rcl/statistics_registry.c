@@ -0,0 +1,296 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./statistics_registry.h"
+
+#include "./common.h"
+
+void
+rcl_impl_statistics_registry_init(rcl_statistics_registry_t * registry)
+{
+  atomic_init(&registry->lock, false);
+  registry->publishers = NULL;
+  registry->subscriptions = NULL;
+}
+
+void
+rcl_impl_statistics_registry_add_publisher(
+  rcl_statistics_registry_t * registry,
+  rcl_publisher_statistics_impl_t * statistics)
+{
+  rcl_atomic_spin_lock(&registry->lock);
+  statistics->next = registry->publishers;
+  registry->publishers = statistics;
+  rcl_atomic_spin_unlock(&registry->lock);
+}
+
+void
+rcl_impl_statistics_registry_remove_publisher(
+  rcl_statistics_registry_t * registry,
+  rcl_publisher_statistics_impl_t * statistics)
+{
+  rcl_atomic_spin_lock(&registry->lock);
+  rcl_publisher_statistics_impl_t ** it = &registry->publishers;
+  while (*it) {
+    if (*it == statistics) {
+      *it = statistics->next;
+      break;
+    }
+    it = &(*it)->next;
+  }
+  rcl_atomic_spin_unlock(&registry->lock);
+  statistics->next = NULL;
+}
+
+void
+rcl_impl_statistics_registry_add_subscription(
+  rcl_statistics_registry_t * registry,
+  rcl_subscription_statistics_impl_t * statistics)
+{
+  rcl_atomic_spin_lock(&registry->lock);
+  statistics->next = registry->subscriptions;
+  registry->subscriptions = statistics;
+  rcl_atomic_spin_unlock(&registry->lock);
+}
+
+void
+rcl_impl_statistics_registry_remove_subscription(
+  rcl_statistics_registry_t * registry,
+  rcl_subscription_statistics_impl_t * statistics)
+{
+  rcl_atomic_spin_lock(&registry->lock);
+  rcl_subscription_statistics_impl_t ** it = &registry->subscriptions;
+  while (*it) {
+    if (*it == statistics) {
+      *it = statistics->next;
+      break;
+    }
+    it = &(*it)->next;
+  }
+  rcl_atomic_spin_unlock(&registry->lock);
+  statistics->next = NULL;
+}
+
+void
+rcl_impl_publisher_statistics_init(
+  rcl_publisher_statistics_impl_t * statistics,
+  const char * topic_name)
+{
+  statistics->topic_name = topic_name;
+  atomic_init(&statistics->message_count, 0);
+  atomic_init(&statistics->error_count, 0);
+  atomic_init(&statistics->total_latency_ns, 0);
+  size_t i;
+  for (i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    atomic_init(&statistics->latency_histogram[i], 0);
+  }
+  statistics->next = NULL;
+}
+
+size_t
+rcl_impl_statistics_latency_bucket(rcl_time_point_value_t duration_ns)
+{
+  rcl_time_point_value_t duration_us = duration_ns / 1000;
+  size_t bucket = 0;
+  while (duration_us > 0 && bucket < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE - 1) {
+    duration_us >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+void
+rcl_impl_publisher_statistics_record(
+  rcl_publisher_statistics_impl_t * statistics,
+  rcl_time_point_value_t duration_ns,
+  uint64_t message_count,
+  uint64_t error_count)
+{
+  if (message_count) {
+    rcl_atomic_fetch_add_uint64_t(&statistics->message_count, message_count);
+  }
+  if (error_count) {
+    rcl_atomic_fetch_add_uint64_t(&statistics->error_count, error_count);
+  }
+  rcl_atomic_fetch_add_uint64_t(&statistics->total_latency_ns, duration_ns);
+  rcl_atomic_fetch_add_uint64_t(
+    &statistics->latency_histogram[rcl_impl_statistics_latency_bucket(duration_ns)], 1);
+}
+
+void
+rcl_impl_publisher_statistics_snapshot(
+  rcl_publisher_statistics_impl_t * statistics,
+  rcl_publisher_statistics_t * snapshot)
+{
+  snapshot->topic_name = statistics->topic_name;
+  snapshot->message_count = rcl_atomic_load_uint64_t(&statistics->message_count);
+  snapshot->error_count = rcl_atomic_load_uint64_t(&statistics->error_count);
+  snapshot->total_latency_ns = rcl_atomic_load_uint64_t(&statistics->total_latency_ns);
+  size_t i;
+  for (i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    snapshot->latency_histogram[i] = rcl_atomic_load_uint64_t(&statistics->latency_histogram[i]);
+  }
+}
+
+void
+rcl_impl_subscription_statistics_init(
+  rcl_subscription_statistics_impl_t * statistics,
+  const char * topic_name)
+{
+  statistics->topic_name = topic_name;
+  atomic_init(&statistics->take_count, 0);
+  atomic_init(&statistics->empty_take_count, 0);
+  atomic_init(&statistics->dropped_count, 0);
+  atomic_init(&statistics->aged_count, 0);
+  atomic_init(&statistics->total_age_ns, 0);
+  size_t i;
+  for (i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    atomic_init(&statistics->age_histogram[i], 0);
+    atomic_init(&statistics->inter_arrival_histogram[i], 0);
+  }
+  statistics->last_receive_time = 0;
+  statistics->last_publisher = NULL;
+  statistics->last_sequence_number = 0;
+  statistics->next = NULL;
+}
+
+void
+rcl_impl_subscription_statistics_record_empty_take(
+  rcl_subscription_statistics_impl_t * statistics)
+{
+  rcl_atomic_fetch_add_uint64_t(&statistics->empty_take_count, 1);
+}
+
+void
+rcl_impl_subscription_statistics_record_take(
+  rcl_subscription_statistics_impl_t * statistics,
+  rcl_time_point_value_t receive_time,
+  rcl_time_point_value_t source_timestamp)
+{
+  rcl_atomic_fetch_add_uint64_t(&statistics->take_count, 1);
+  if (statistics->last_receive_time) {
+    rcl_time_point_value_t inter_arrival = receive_time > statistics->last_receive_time ?
+      receive_time - statistics->last_receive_time : 0;
+    rcl_atomic_fetch_add_uint64_t(
+      &statistics->inter_arrival_histogram[rcl_impl_statistics_latency_bucket(inter_arrival)], 1);
+  }
+  statistics->last_receive_time = receive_time;
+  if (source_timestamp && receive_time) {
+    rcl_time_point_value_t age =
+      receive_time > source_timestamp ? receive_time - source_timestamp : 0;
+    rcl_atomic_fetch_add_uint64_t(&statistics->aged_count, 1);
+    rcl_atomic_fetch_add_uint64_t(&statistics->total_age_ns, age);
+    rcl_atomic_fetch_add_uint64_t(
+      &statistics->age_histogram[rcl_impl_statistics_latency_bucket(age)], 1);
+  }
+}
+
+void
+rcl_impl_subscription_statistics_record_sequence(
+  rcl_subscription_statistics_impl_t * statistics,
+  const void * publisher,
+  uint64_t sequence_number)
+{
+  // Messages of one publisher leave the queue in order, so a jump means messages were lost.
+  if (publisher == statistics->last_publisher &&
+    sequence_number > statistics->last_sequence_number + 1)
+  {
+    rcl_atomic_fetch_add_uint64_t(
+      &statistics->dropped_count, sequence_number - statistics->last_sequence_number - 1);
+  }
+  statistics->last_publisher = publisher;
+  statistics->last_sequence_number = sequence_number;
+}
+
+void
+rcl_impl_subscription_statistics_snapshot(
+  rcl_subscription_statistics_impl_t * statistics,
+  rcl_subscription_statistics_t * snapshot)
+{
+  snapshot->topic_name = statistics->topic_name;
+  snapshot->take_count = rcl_atomic_load_uint64_t(&statistics->take_count);
+  snapshot->empty_take_count = rcl_atomic_load_uint64_t(&statistics->empty_take_count);
+  snapshot->dropped_count = rcl_atomic_load_uint64_t(&statistics->dropped_count);
+  snapshot->aged_count = rcl_atomic_load_uint64_t(&statistics->aged_count);
+  snapshot->total_age_ns = rcl_atomic_load_uint64_t(&statistics->total_age_ns);
+  size_t i;
+  for (i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    snapshot->age_histogram[i] = rcl_atomic_load_uint64_t(&statistics->age_histogram[i]);
+    snapshot->inter_arrival_histogram[i] =
+      rcl_atomic_load_uint64_t(&statistics->inter_arrival_histogram[i]);
+  }
+}
+
+rcl_ret_t
+rcl_node_get_publisher_statistics(
+  const rcl_node_t * node,
+  rcl_publisher_statistics_t * statistics,
+  size_t capacity,
+  size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  if (capacity > 0) {
+    RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  }
+  rcl_statistics_registry_t * registry = rcl_impl_node_get_statistics_registry(node);
+  RCL_CHECK_FOR_NULL_WITH_MSG(registry, "invalid node", return RCL_RET_NODE_INVALID);
+  *count = 0;
+  rcl_atomic_spin_lock(&registry->lock);
+  rcl_publisher_statistics_impl_t * it;
+  for (it = registry->publishers; it; it = it->next) {
+    if (*count < capacity) {
+      rcl_impl_publisher_statistics_snapshot(it, &statistics[*count]);
+    }
+    ++(*count);
+  }
+  rcl_atomic_spin_unlock(&registry->lock);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_node_get_subscription_statistics(
+  const rcl_node_t * node,
+  rcl_subscription_statistics_t * statistics,
+  size_t capacity,
+  size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  if (capacity > 0) {
+    RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  }
+  rcl_statistics_registry_t * registry = rcl_impl_node_get_statistics_registry(node);
+  RCL_CHECK_FOR_NULL_WITH_MSG(registry, "invalid node", return RCL_RET_NODE_INVALID);
+  *count = 0;
+  rcl_atomic_spin_lock(&registry->lock);
+  rcl_subscription_statistics_impl_t * it;
+  for (it = registry->subscriptions; it; it = it->next) {
+    if (*count < capacity) {
+      rcl_impl_subscription_statistics_snapshot(it, &statistics[*count]);
+    }
+    ++(*count);
+  }
+  rcl_atomic_spin_unlock(&registry->lock);
+  return RCL_RET_OK;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,200 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__STATISTICS_REGISTRY_H_
+#define RCL__STATISTICS_REGISTRY_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stddef.h>
+
+#include "rcl/node.h"
+#include "rcl/statistics.h"
+#include "rcl/time.h"
+
+#include "./stdatomic_helper.h"
+
+/// Statistics of one publisher, updated with atomic operations only.
+typedef struct rcl_publisher_statistics_impl_t
+{
+  /// Topic name of the publisher, owned by the publisher.
+  const char * topic_name;
+  atomic_uint_least64_t message_count;
+  atomic_uint_least64_t error_count;
+  atomic_uint_least64_t total_latency_ns;
+  atomic_uint_least64_t latency_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+  /// Next publisher of the same node.
+  struct rcl_publisher_statistics_impl_t * next;
+} rcl_publisher_statistics_impl_t;
+
+/// Statistics of one subscription, updated with atomic operations only.
+typedef struct rcl_subscription_statistics_impl_t
+{
+  /// Topic name of the subscription, owned by the subscription.
+  const char * topic_name;
+  atomic_uint_least64_t take_count;
+  atomic_uint_least64_t empty_take_count;
+  atomic_uint_least64_t dropped_count;
+  atomic_uint_least64_t aged_count;
+  atomic_uint_least64_t total_age_ns;
+  atomic_uint_least64_t age_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+  atomic_uint_least64_t inter_arrival_histogram[RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE];
+  // The following are only used by the thread taking from the subscription.
+  /// Receive time of the previous taken message, or 0 before the first one.
+  rcl_time_point_value_t last_receive_time;
+  /// Publisher of the previous message with a sequence number, identified by its pool.
+  const void * last_publisher;
+  uint64_t last_sequence_number;
+  /// Next subscription of the same node.
+  struct rcl_subscription_statistics_impl_t * next;
+} rcl_subscription_statistics_impl_t;
+
+/// List of the statistics of the entities of a node.
+typedef struct rcl_statistics_registry_t
+{
+  /// Protects the list, only held while walking or changing it.
+  atomic_bool lock;
+  rcl_publisher_statistics_impl_t * publishers;
+  rcl_subscription_statistics_impl_t * subscriptions;
+} rcl_statistics_registry_t;
+
+/// Return the statistics registry of the node, or NULL if the node is invalid.
+/* This function is implemented in node.c, where the node struct is defined. */
+rcl_statistics_registry_t *
+rcl_impl_node_get_statistics_registry(const rcl_node_t * node);
+
+/// Initialize an empty registry.
+void
+rcl_impl_statistics_registry_init(rcl_statistics_registry_t * registry);
+
+/// Add the statistics of a publisher to the registry.
+void
+rcl_impl_statistics_registry_add_publisher(
+  rcl_statistics_registry_t * registry,
+  rcl_publisher_statistics_impl_t * statistics);
+
+/// Remove the statistics of a publisher from the registry.
+void
+rcl_impl_statistics_registry_remove_publisher(
+  rcl_statistics_registry_t * registry,
+  rcl_publisher_statistics_impl_t * statistics);
+
+/// Add the statistics of a subscription to the registry.
+void
+rcl_impl_statistics_registry_add_subscription(
+  rcl_statistics_registry_t * registry,
+  rcl_subscription_statistics_impl_t * statistics);
+
+/// Remove the statistics of a subscription from the registry.
+void
+rcl_impl_statistics_registry_remove_subscription(
+  rcl_statistics_registry_t * registry,
+  rcl_subscription_statistics_impl_t * statistics);
+
+/// Set all counters to 0.
+void
+rcl_impl_publisher_statistics_init(
+  rcl_publisher_statistics_impl_t * statistics,
+  const char * topic_name);
+
+/// Return the index of the histogram bucket for a duration in nanoseconds.
+size_t
+rcl_impl_statistics_latency_bucket(rcl_time_point_value_t duration_ns);
+
+/// Record the outcome of one publish call.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] statistics the statistics of the publisher
+ * \param[in] duration_ns the duration of the publish call
+ * \param[in] message_count number of messages which were published
+ * \param[in] error_count number of messages which failed to be published
+ */
+void
+rcl_impl_publisher_statistics_record(
+  rcl_publisher_statistics_impl_t * statistics,
+  rcl_time_point_value_t duration_ns,
+  uint64_t message_count,
+  uint64_t error_count);
+
+/// Copy the current counters into a snapshot.
+void
+rcl_impl_publisher_statistics_snapshot(
+  rcl_publisher_statistics_impl_t * statistics,
+  rcl_publisher_statistics_t * snapshot);
+
+/// Set all counters to 0.
+void
+rcl_impl_subscription_statistics_init(
+  rcl_subscription_statistics_impl_t * statistics,
+  const char * topic_name);
+
+/// Record a take call which found no message.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ */
+void
+rcl_impl_subscription_statistics_record_empty_take(
+  rcl_subscription_statistics_impl_t * statistics);
+
+/// Record a taken message.
+/* This function does not allocate heap memory.
+ * This function is not thread-safe with itself.
+ * This function is lock-free.
+ *
+ * \param[in] statistics the statistics of the subscription
+ * \param[in] receive_time the steady time at which the message was taken
+ * \param[in] source_timestamp the steady time at which it was published, or 0 if unknown
+ */
+void
+rcl_impl_subscription_statistics_record_take(
+  rcl_subscription_statistics_impl_t * statistics,
+  rcl_time_point_value_t receive_time,
+  rcl_time_point_value_t source_timestamp);
+
+/// Check the sequence number of a message for a gap, and count the messages in it as dropped.
+/* This is called for each message with a sequence number which leaves the
+ * queue of the subscription, including those which are skipped, so skipped
+ * messages are not counted as dropped.
+ *
+ * This function does not allocate heap memory.
+ * This function is not thread-safe with itself.
+ * This function is lock-free.
+ *
+ * \param[in] statistics the statistics of the subscription
+ * \param[in] publisher identifies the publisher the sequence number belongs to
+ * \param[in] sequence_number the sequence number of the message
+ */
+void
+rcl_impl_subscription_statistics_record_sequence(
+  rcl_subscription_statistics_impl_t * statistics,
+  const void * publisher,
+  uint64_t sequence_number);
+
+/// Copy the current counters into a snapshot.
+void
+rcl_impl_subscription_statistics_snapshot(
+  rcl_subscription_statistics_impl_t * statistics,
+  rcl_subscription_statistics_t * snapshot);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__STATISTICS_REGISTRY_H_
@@ -36,6 +36,10 @@
 
 #define rcl_atomic_exchange(object, out, desired) (out) = atomic_exchange(object, desired)
 
+#define rcl_atomic_fetch_add(object, out, operand) (out) = atomic_fetch_add(object, operand)
+
+#define rcl_atomic_fetch_sub(object, out, operand) (out) = atomic_fetch_sub(object, operand)
+
 #define rcl_atomic_store(object, desired) atomic_store(object, desired)
 
 #else  // !defined(WIN32)
@@ -49,6 +53,10 @@
 
 #define rcl_atomic_exchange(object, out, desired) rcl_win32_atomic_exchange(object, out, desired)
 
+#define rcl_atomic_fetch_add(object, out, operand) rcl_win32_atomic_fetch_add(object, out, operand)
+
+#define rcl_atomic_fetch_sub(object, out, operand) rcl_win32_atomic_fetch_sub(object, out, operand)
+
 #define rcl_atomic_store(object, desired) rcl_win32_atomic_store(object, desired)
 
 #endif  // !defined(WIN32)
@@ -118,6 +126,30 @@ rcl_atomic_exchange_uint64_t(atomic_uint_least64_t * a_uint64_t, uint64_t desire
   return result;
 }
 
+static inline int64_t
+rcl_atomic_fetch_add_int64_t(atomic_int_least64_t * a_int64_t, int64_t operand)
+{
+  int64_t result;
+  rcl_atomic_fetch_add(a_int64_t, result, operand);
+  return result;
+}
+
+static inline uint64_t
+rcl_atomic_fetch_add_uint64_t(atomic_uint_least64_t * a_uint64_t, uint64_t operand)
+{
+  uint64_t result;
+  rcl_atomic_fetch_add(a_uint64_t, result, operand);
+  return result;
+}
+
+static inline uint64_t
+rcl_atomic_fetch_sub_uint64_t(atomic_uint_least64_t * a_uint64_t, uint64_t operand)
+{
+  uint64_t result;
+  rcl_atomic_fetch_sub(a_uint64_t, result, operand);
+  return result;
+}
+
 static inline uint64_t
 rcl_atomic_exchange_uintptr_t(atomic_uintptr_t * a_uintptr_t, uintptr_t desired)
 {
@@ -126,4 +158,19 @@ rcl_atomic_exchange_uintptr_t(atomic_uintptr_t * a_uintptr_t, uintptr_t desired)
   return result;
 }
 
+// Acquire a spin lock, only meant for short critical sections which never block.
+static inline void
+rcl_atomic_spin_lock(atomic_bool * lock)
+{
+  while (rcl_atomic_exchange_bool(lock, true)) {
+    // Spin until the holder releases the lock.
+  }
+}
+
+static inline void
+rcl_atomic_spin_unlock(atomic_bool * lock)
+{
+  rcl_atomic_store(lock, false);
+}
+
 #endif  // RCL__STDATOMIC_HELPER_H_
@@ -18,16 +18,161 @@ extern "C"
 #endif
 
 #include "rcl/subscription.h"
+#include "rcl/message_cache.h"
+
+#include <string.h>
 
 #include "rmw/rmw.h"
 #include "./common.h"
+#include "./content_filter.h"
+#include "./intra_process.h"
+#include "./message_cache_storage.h"
+#include "./message_pool.h"
+#include "./statistics_registry.h"
+#include "./stdatomic_helper.h"
+
+// An intra-process message which has been taken but not yet returned.
+typedef struct rcl_intra_process_held_message_t
+{
+  const void * message;
+  rcl_message_pool_t * pool;
+} rcl_intra_process_held_message_t;
 
 typedef struct rcl_subscription_impl_t
 {
   rcl_subscription_options_t options;
   rmw_subscription_t * rmw_handle;
+  bool intra_process_enabled;
+  rcl_intra_process_subscription_t intra_process;
+  // One slot per message of the intra-process queue depth, empty slots are NULL.
+  rcl_intra_process_held_message_t * intra_process_held_messages;
+  // Number of messages discarded because of the keep_latest_only option.
+  atomic_uint_least64_t skipped_count;
+  // Storage is NULL unless the cache is enabled.
+  rcl_message_cache_t cache;
+  rcl_content_filter_t content_filter;
+  // Messages for rcl_take_pooled_message(), the first take_pool_init_count are initialized.
+  rcl_message_pool_t take_pool;
+  size_t take_pool_init_count;
+  // NULL unless statistics are enabled.
+  rcl_subscription_statistics_impl_t * statistics;
 } rcl_subscription_impl_t;
 
+// Read the steady clock for a receive time, which is 0 if the clock cannot be read.
+static rcl_time_point_value_t
+__receive_time()
+{
+  rcl_time_point_value_t now = 0;
+  if (rcl_steady_time_now(&now) != RCL_RET_OK) {
+    rcl_reset_error();  // Receive times are informational, and must not fail the take.
+  }
+  return now;
+}
+
+// Record a taken message in the statistics and the cache, and read its receive time if asked to.
+// The clock is only read if one of them needs it.
+static void
+__message_taken(
+  rcl_subscription_impl_t * impl,
+  const void * ros_message,
+  rcl_time_point_value_t source_timestamp,
+  rcl_time_point_value_t * received_timestamp)
+{
+  if (!received_timestamp && !impl->statistics && !impl->cache.storage) {
+    return;
+  }
+  rcl_time_point_value_t now = __receive_time();
+  if (received_timestamp) {
+    *received_timestamp = now;
+  }
+  if (impl->statistics) {
+    rcl_impl_subscription_statistics_record_take(impl->statistics, now, source_timestamp);
+  }
+  if (impl->cache.storage) {
+    // A time of 0 is raised to the newest cached time, so the cache stays ordered.
+    if (rcl_impl_message_cache_insert(&impl->cache, ros_message, now) != RCL_RET_OK) {
+      rcl_reset_error();  // The message was still taken, it is only missing from the cache.
+    }
+  }
+}
+
+// Count a take call which found no message, if statistics are enabled.
+static void
+__empty_take(rcl_subscription_impl_t * impl)
+{
+  if (impl->statistics) {
+    rcl_impl_subscription_statistics_record_empty_take(impl->statistics);
+  }
+}
+
+// Take newer messages into a taken message until none are left, so only the latest remains.
+static rcl_ret_t
+__take_latest(
+  rcl_subscription_impl_t * impl,
+  void * ros_message,
+  rmw_message_info_t * message_info)
+{
+  rcl_ret_t result = RCL_RET_OK;
+  uint64_t skipped_count = 0;
+  rmw_message_info_t newer_message_info;
+  for (;;) {
+    bool taken = false;
+    // The middleware cannot take serialized messages, so older messages are
+    // deserialized only to be skipped.
+    if (rmw_take_with_info(impl->rmw_handle, ros_message, &taken, &newer_message_info) !=
+      RMW_RET_OK)
+    {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      result = RCL_RET_ERROR;
+      break;
+    }
+    if (!taken) {
+      break;
+    }
+    *message_info = newer_message_info;
+    ++skipped_count;
+  }
+  if (skipped_count) {
+    rcl_atomic_fetch_add_uint64_t(&impl->skipped_count, skipped_count);
+  }
+  return result;
+}
+
+// Finalize the initialized messages of the take pool and deallocate it.
+static void
+__take_pool_fini(rcl_subscription_impl_t * impl)
+{
+  // If init failed early the options are not set yet, but then no message was initialized.
+  if (impl->take_pool_init_count > 0 && impl->options.take_message_fini) {
+    size_t i;
+    for (i = 0; i < impl->take_pool_init_count; ++i) {
+      impl->options.take_message_fini(rcl_impl_message_pool_get_message(&impl->take_pool, i));
+    }
+  }
+  impl->take_pool_init_count = 0;
+  rcl_impl_message_pool_fini(&impl->take_pool);
+}
+
+// Give back every intra-process message which is queued or held by the subscription.
+static void
+__release_intra_process_messages(rcl_subscription_impl_t * impl)
+{
+  const void * message;
+  rcl_message_pool_t * pool;
+  while (rcl_impl_intra_process_queue_dequeue(&impl->intra_process.queue, &message, &pool, NULL)) {
+    (void)rcl_impl_message_pool_release(pool, message);
+  }
+  size_t i;
+  for (i = 0; i < impl->options.intra_process_depth; ++i) {
+    rcl_intra_process_held_message_t * held = &impl->intra_process_held_messages[i];
+    if (held->message) {
+      (void)rcl_impl_message_pool_release(held->pool, held->message);
+      held->message = NULL;
+      held->pool = NULL;
+    }
+  }
+}
+
 rcl_subscription_t
 rcl_get_zero_initialized_subscription()
 {
@@ -50,9 +195,12 @@ rcl_subscription_init(
   RCL_CHECK_ARGUMENT_FOR_NULL(topic_name, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(options, RCL_RET_INVALID_ARGUMENT);
   if (subscription->impl) {
-    RCL_SET_ERROR_MSG("subscription already initialized, or memory was uninitialized");
+    RCL_SET_ERROR_MSG_LITERAL("subscription already initialized, or memory was uninitialized");
     return RCL_RET_ALREADY_INIT;
   }
+  if (rcl_impl_validate_qos_profile(&options->qos) != RCL_RET_OK) {
+    return RCL_RET_INVALID_ARGUMENT;  // rcl error state should already be set.
+  }
   const rcl_allocator_t * allocator = &options->allocator;
   RCL_CHECK_FOR_NULL_WITH_MSG(
     allocator->allocate, "allocate not set", return RCL_RET_INVALID_ARGUMENT);
@@ -64,13 +212,23 @@ rcl_subscription_init(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     subscription->impl, "allocating memory failed", return RCL_RET_BAD_ALLOC);
   // Fill out the implemenation struct.
+  subscription->impl->intra_process_enabled = false;
+  memset(&subscription->impl->intra_process, 0, sizeof(rcl_intra_process_subscription_t));
+  subscription->impl->intra_process.guard_condition = rcl_get_zero_initialized_guard_condition();
+  subscription->impl->intra_process_held_messages = NULL;
+  atomic_init(&subscription->impl->skipped_count, 0);
+  subscription->impl->cache = rcl_impl_get_zero_initialized_message_cache();
+  subscription->impl->statistics = NULL;
+  subscription->impl->content_filter = rcl_impl_get_zero_initialized_content_filter();
+  subscription->impl->take_pool = rcl_impl_get_zero_initialized_message_pool();
+  subscription->impl->take_pool_init_count = 0;
   // rmw_handle
   // TODO(wjwwood): pass allocator once supported in rmw api.
   subscription->impl->rmw_handle = rmw_create_subscription(
     rcl_node_get_rmw_handle(node),
     type_support,
     topic_name,
-    &rmw_qos_profile_default,
+    &options->qos,
     options->ignore_local_publications);
   if (!subscription->impl->rmw_handle) {
     RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
@@ -78,10 +236,141 @@ rcl_subscription_init(
   }
   // options
   subscription->impl->options = *options;
+  // intra-process delivery
+  if (options->intra_process_depth > 0) {
+    rcl_intra_process_subscription_t * intra_process = &subscription->impl->intra_process;
+    intra_process->topic_name = subscription->impl->rmw_handle->topic_name;
+    intra_process->type_support = type_support;
+    rcl_ret_t ret = rcl_impl_intra_process_queue_init(
+      &intra_process->queue, options->intra_process_depth, *allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+    rcl_guard_condition_options_t guard_condition_options =
+      rcl_guard_condition_get_default_options();
+    guard_condition_options.allocator = *allocator;
+    ret = rcl_guard_condition_init(&intra_process->guard_condition, guard_condition_options);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+    subscription->impl->intra_process_held_messages =
+      (rcl_intra_process_held_message_t *)allocator->allocate(
+      sizeof(rcl_intra_process_held_message_t) * options->intra_process_depth, allocator->state);
+    if (!subscription->impl->intra_process_held_messages) {
+      RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+      fail_ret = RCL_RET_BAD_ALLOC;
+      goto fail;
+    }
+    memset(
+      subscription->impl->intra_process_held_messages, 0,
+      sizeof(rcl_intra_process_held_message_t) * options->intra_process_depth);
+    subscription->impl->intra_process_enabled = true;
+  }
+  // message cache
+  if (options->cache_depth > 0) {
+    rcl_ret_t ret = rcl_impl_message_cache_init(
+      &subscription->impl->cache,
+      options->cache_depth,
+      options->cache_message_size,
+      options->cache_duration_ns,
+      options->cache_message_copy,
+      options->cache_message_fini,
+      *allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
+  // content filter
+  rcl_ret_t filter_ret = rcl_impl_content_filter_init(
+    &subscription->impl->content_filter,
+    options->content_filter,
+    options->content_filter_size,
+    *allocator);
+  if (filter_ret != RCL_RET_OK) {
+    fail_ret = filter_ret;
+    goto fail;  // rcl error state should already be set.
+  }
+  // take pool
+  if (options->take_message_pool_size > 0) {
+    rcl_ret_t ret = rcl_impl_message_pool_init(
+      &subscription->impl->take_pool,
+      options->take_message_pool_size,
+      options->take_message_size,
+      *allocator);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+    // Construct every message now, so taking into them later does not have to.
+    if (options->take_message_init) {
+      for (; subscription->impl->take_pool_init_count < options->take_message_pool_size;
+        ++subscription->impl->take_pool_init_count)
+      {
+        void * message = rcl_impl_message_pool_get_message(
+          &subscription->impl->take_pool, subscription->impl->take_pool_init_count);
+        if (!options->take_message_init(message)) {
+          RCL_SET_ERROR_MSG_LITERAL("initializing a pooled message failed");
+          fail_ret = RCL_RET_BAD_ALLOC;
+          goto fail;
+        }
+      }
+    } else {
+      subscription->impl->take_pool_init_count = options->take_message_pool_size;
+    }
+  }
+  // statistics
+  if (options->enable_statistics) {
+    subscription->impl->statistics =
+      (rcl_subscription_statistics_impl_t *)allocator->allocate(
+      sizeof(rcl_subscription_statistics_impl_t), allocator->state);
+    if (!subscription->impl->statistics) {
+      RCL_SET_ERROR_MSG_LITERAL("allocating memory failed");
+      fail_ret = RCL_RET_BAD_ALLOC;
+      goto fail;
+    }
+    rcl_impl_subscription_statistics_init(
+      subscription->impl->statistics, subscription->impl->rmw_handle->topic_name);
+    rcl_impl_statistics_registry_add_subscription(
+      rcl_impl_node_get_statistics_registry(node), subscription->impl->statistics);
+  }
+  // Register last, so publishers never see a half made subscription.
+  if (subscription->impl->intra_process_enabled) {
+    rcl_ret_t ret =
+      rcl_impl_intra_process_register_subscription(&subscription->impl->intra_process);
+    if (ret != RCL_RET_OK) {
+      fail_ret = ret;
+      goto fail;  // rcl error state should already be set.
+    }
+  }
   return RCL_RET_OK;
 fail:
   if (subscription->impl) {
+    if (subscription->impl->statistics) {
+      rcl_impl_statistics_registry_remove_subscription(
+        rcl_impl_node_get_statistics_registry(node), subscription->impl->statistics);
+      allocator->deallocate(subscription->impl->statistics, allocator->state);
+    }
+    if (subscription->impl->intra_process.guard_condition.impl &&
+      rcl_guard_condition_fini(&subscription->impl->intra_process.guard_condition) != RCL_RET_OK)
+    {
+      // The original error is more useful, so only report the failure to init.
+    }
+    rcl_impl_intra_process_queue_fini(&subscription->impl->intra_process.queue);
+    if (subscription->impl->intra_process_held_messages) {
+      allocator->deallocate(subscription->impl->intra_process_held_messages, allocator->state);
+    }
+    rcl_impl_message_cache_fini(&subscription->impl->cache);
+    rcl_impl_content_filter_fini(&subscription->impl->content_filter);
+    __take_pool_fini(subscription->impl);
+    if (subscription->impl->rmw_handle) {
+      (void)rmw_destroy_subscription(
+        rcl_node_get_rmw_handle(node), subscription->impl->rmw_handle);
+    }
     allocator->deallocate(subscription->impl, allocator->state);
+    subscription->impl = NULL;
   }
   return fail_ret;
 }
@@ -93,13 +382,37 @@ rcl_subscription_fini(rcl_subscription_t * subscription, rcl_node_t * node)
   RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(node, RCL_RET_INVALID_ARGUMENT);
   if (subscription->impl) {
+    rcl_allocator_t allocator = subscription->impl->options.allocator;
+    if (subscription->impl->intra_process_enabled) {
+      rcl_impl_intra_process_unregister_subscription(&subscription->impl->intra_process);
+      __release_intra_process_messages(subscription->impl);
+      if (rcl_guard_condition_fini(&subscription->impl->intra_process.guard_condition) !=
+        RCL_RET_OK)
+      {
+        result = RCL_RET_ERROR;  // rcl error state should already be set.
+      }
+      rcl_impl_intra_process_queue_fini(&subscription->impl->intra_process.queue);
+      allocator.deallocate(subscription->impl->intra_process_held_messages, allocator.state);
+    }
+    rcl_impl_message_cache_fini(&subscription->impl->cache);
+    rcl_impl_content_filter_fini(&subscription->impl->content_filter);
+    __take_pool_fini(subscription->impl);
+    if (subscription->impl->statistics) {
+      rcl_statistics_registry_t * registry = rcl_impl_node_get_statistics_registry(node);
+      if (registry) {
+        rcl_impl_statistics_registry_remove_subscription(
+          registry, subscription->impl->statistics);
+      } else {
+        result = RCL_RET_NODE_INVALID;  // rcl error state should already be set.
+      }
+      allocator.deallocate(subscription->impl->statistics, allocator.state);
+    }
     rmw_ret_t ret =
       rmw_destroy_subscription(rcl_node_get_rmw_handle(node), subscription->impl->rmw_handle);
     if (ret != RMW_RET_OK) {
       RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
       result = RCL_RET_ERROR;
     }
-    rcl_allocator_t allocator = subscription->impl->options.allocator;
     allocator.deallocate(subscription->impl, allocator.state);
   }
   return result;
@@ -110,6 +423,20 @@ rcl_subscription_get_default_options()
 {
   static rcl_subscription_options_t default_options = {
     .ignore_local_publications = false,
+    .intra_process_depth = 0,
+    .keep_latest_only = false,
+    .content_filter = NULL,
+    .content_filter_size = 0,
+    .cache_depth = 0,
+    .cache_message_size = 0,
+    .cache_message_copy = NULL,
+    .cache_message_fini = NULL,
+    .cache_duration_ns = 0,
+    .take_message_pool_size = 0,
+    .take_message_size = 0,
+    .take_message_init = NULL,
+    .take_message_fini = NULL,
+    .enable_statistics = false,
   };
   // Must set the allocator and qos after because they are not a compile time constant.
   default_options.qos = rmw_qos_profile_default;
@@ -117,6 +444,74 @@ rcl_subscription_get_default_options()
   return default_options;
 }
 
+// Take a message from the middleware, the arguments must already be checked.
+static rcl_ret_t
+__take(
+  rcl_subscription_impl_t * impl,
+  void * ros_message,
+  rmw_message_info_t * message_info,
+  rcl_time_point_value_t * received_timestamp)
+{
+  // If message_info is NULL, use a place holder which can be discarded.
+  rmw_message_info_t dummy_message_info;
+  rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
+  // Take messages until one passes the content filter.
+  for (;;) {
+    // Call rmw_take_with_info.
+    bool taken = false;
+    rmw_ret_t ret =
+      rmw_take_with_info(impl->rmw_handle, ros_message, &taken, message_info_local);
+    if (ret != RMW_RET_OK) {
+      RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+      return RCL_RET_ERROR;
+    }
+    if (!taken) {
+      // Nothing to take is expected when polling, so no error message is set.
+      return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+    }
+    if (impl->options.keep_latest_only) {
+      rcl_ret_t latest_ret = __take_latest(impl, ros_message, message_info_local);
+      if (latest_ret != RCL_RET_OK) {
+        return latest_ret;  // rcl error state should already be set.
+      }
+    }
+    // Loaned messages of publishers in this process were already delivered intra-process.
+    if (impl->intra_process_enabled &&
+      rcl_impl_intra_process_is_duplicate(&impl->intra_process, &message_info_local->publisher_gid))
+    {
+      continue;
+    }
+    // The middleware cannot take serialized messages, so filtered messages are
+    // deserialized as well.
+    if (rcl_impl_content_filter_accept(&impl->content_filter, ros_message)) {
+      break;
+    }
+  }
+  __message_taken(impl, ros_message, 0, received_timestamp);
+  return RCL_RET_OK;
+}
+
+// Take a message like __take() and fill in all of its meta-data, counting an empty take.
+static rcl_ret_t
+__take_with_info(
+  rcl_subscription_impl_t * impl,
+  void * ros_message,
+  rcl_message_info_t * message_info)
+{
+  rcl_ret_t ret = __take(
+    impl, ros_message, &message_info->rmw_message_info, &message_info->received_timestamp);
+  if (ret != RCL_RET_OK) {
+    if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+      __empty_take(impl);
+    }
+    return ret;
+  }
+  // The middleware does not pass these along with the message, only intra-process delivery does.
+  message_info->source_timestamp = 0;
+  message_info->publication_sequence_number = 0;
+  return RCL_RET_OK;
+}
+
 rcl_ret_t
 rcl_take(
   const rcl_subscription_t * subscription,
@@ -130,24 +525,436 @@ rcl_take(
   RCL_CHECK_FOR_NULL_WITH_MSG(
     subscription->impl->rmw_handle,
     "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
-  // If message_info is NULL, use a place holder which can be discarded.
-  rmw_message_info_t dummy_message_info;
-  rmw_message_info_t * message_info_local = message_info ? message_info : &dummy_message_info;
-  // Call rmw_take_with_info.
-  bool taken = false;
-  rmw_ret_t ret =
-    rmw_take_with_info(subscription->impl->rmw_handle, ros_message, &taken, message_info_local);
-  if (ret != RMW_RET_OK) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
-    return RCL_RET_ERROR;
+  rcl_ret_t ret = __take(subscription->impl, ros_message, message_info, NULL);
+  if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+    __empty_take(subscription->impl);
   }
-  if (!taken) {
-    RCL_SET_ERROR_MSG(rmw_get_error_string_safe());
+  return ret;
+}
+
+rcl_ret_t
+rcl_take_with_info(
+  const rcl_subscription_t * subscription,
+  void * ros_message,
+  rcl_message_info_t * message_info)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(message_info, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl->rmw_handle,
+    "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  return __take_with_info(subscription->impl, ros_message, message_info);
+}
+
+rcl_ret_t
+rcl_take_pooled_message(
+  const rcl_subscription_t * subscription,
+  void ** ros_message,
+  rcl_message_info_t * message_info)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl->rmw_handle,
+    "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  rcl_subscription_impl_t * impl = subscription->impl;
+  if (impl->take_pool.capacity == 0) {
+    RCL_SET_ERROR_MSG_LITERAL("the take message pool is not enabled for this subscription");
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  void * message = rcl_impl_message_pool_acquire(&impl->take_pool);
+  if (!message) {
+    RCL_SET_ERROR_MSG_LITERAL("all pooled messages of the subscription are in use");
+    return RCL_RET_SUBSCRIPTION_POOL_EXHAUSTED;
+  }
+  rcl_message_info_t dummy_message_info;
+  rcl_ret_t ret = __take_with_info(
+    impl, message, message_info ? message_info : &dummy_message_info);
+  if (ret != RCL_RET_OK) {
+    (void)rcl_impl_message_pool_release(&impl->take_pool, message);
+    return ret;  // rcl error state should already be set, unless nothing was taken.
+  }
+  *ros_message = message;
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_return_pooled_message(const rcl_subscription_t * subscription, void * ros_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  // The message stays initialized, so its memory is reused by the next take.
+  return rcl_impl_message_pool_release(&subscription->impl->take_pool, ros_message);
+}
+
+rcl_ret_t
+rcl_take_batch(
+  const rcl_subscription_t * subscription,
+  void * const * ros_messages,
+  rmw_message_info_t * message_infos,
+  size_t capacity,
+  size_t * taken_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(taken_count, RCL_RET_INVALID_ARGUMENT);
+  *taken_count = 0;
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl->rmw_handle,
+    "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  if (capacity == 0) {
+    return RCL_RET_OK;
+  }
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_messages, RCL_RET_INVALID_ARGUMENT);
+  size_t i;
+  for (i = 0; i < capacity; ++i) {
+    if (!ros_messages[i]) {
+      RCL_SET_ERROR_MSG_LITERAL("ros_messages argument contains a null message");
+      return RCL_RET_INVALID_ARGUMENT;
+    }
+  }
+  // The middleware has no batch take, so each message is taken on its own.
+  for (i = 0; i < capacity; ++i) {
+    rcl_ret_t ret = __take(
+      subscription->impl, ros_messages[i], message_infos ? &message_infos[i] : NULL, NULL);
+    if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+      break;
+    }
+    if (ret != RCL_RET_OK) {
+      return ret;  // rcl error state should already be set.
+    }
+    ++(*taken_count);
+    if (subscription->impl->options.keep_latest_only) {
+      // Only the latest message is taken, the rest of the array is left unused.
+      break;
+    }
+  }
+  if (*taken_count == 0) {
+    // Nothing to take is expected when polling, so no error message is set.
+    __empty_take(subscription->impl);
     return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
   }
   return RCL_RET_OK;
 }
 
+const rcl_guard_condition_t *
+rcl_subscription_get_intra_process_guard_condition(const rcl_subscription_t * subscription)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, NULL);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return NULL);
+  if (!subscription->impl->intra_process_enabled) {
+    RCL_SET_ERROR_MSG_LITERAL("intra-process delivery is not enabled for this subscription");
+    return NULL;
+  }
+  return &subscription->impl->intra_process.guard_condition;
+}
+
+rcl_ret_t
+rcl_subscription_set_on_new_message_callback(
+  const rcl_subscription_t * subscription,
+  rcl_event_callback_t callback,
+  const void * user_data)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  // The middleware has no listeners, so only intra-process messages can be reported.
+  if (!subscription->impl->intra_process_enabled) {
+    RCL_SET_ERROR_MSG_LITERAL("intra-process delivery is not enabled for this subscription");
+    return RCL_RET_UNSUPPORTED;
+  }
+  // The guard condition is triggered once for each delivered message.
+  return rcl_guard_condition_set_on_trigger_callback(
+    &subscription->impl->intra_process.guard_condition, callback, user_data);
+}
+
+bool
+rcl_subscription_can_loan_messages(const rcl_subscription_t * subscription)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, false);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return false);
+  // The middleware cannot loan messages, so only intra-process messages are lent.
+  return subscription->impl->intra_process_enabled;
+}
+
+// Dequeue the next intra-process message, or the latest one with the keep_latest_only option.
+static bool
+__dequeue_intra_process(
+  rcl_subscription_impl_t * impl,
+  const void ** message,
+  rcl_message_pool_t ** pool,
+  rcl_intra_process_stamp_t * stamp)
+{
+  if (!rcl_impl_intra_process_queue_dequeue(&impl->intra_process.queue, message, pool, stamp)) {
+    return false;
+  }
+  if (impl->statistics) {
+    rcl_impl_subscription_statistics_record_sequence(
+      impl->statistics, *pool, stamp->sequence_number);
+  }
+  if (impl->options.keep_latest_only) {
+    // Give any older messages back to their publishers right away.
+    const void * newer_message;
+    rcl_message_pool_t * newer_pool;
+    uint64_t skipped_count = 0;
+    while (rcl_impl_intra_process_queue_dequeue(
+        &impl->intra_process.queue, &newer_message, &newer_pool, stamp))
+    {
+      (void)rcl_impl_message_pool_release(*pool, *message);
+      *message = newer_message;
+      *pool = newer_pool;
+      ++skipped_count;
+      if (impl->statistics) {
+        rcl_impl_subscription_statistics_record_sequence(
+          impl->statistics, *pool, stamp->sequence_number);
+      }
+    }
+    if (skipped_count) {
+      rcl_atomic_fetch_add_uint64_t(&impl->skipped_count, skipped_count);
+    }
+  }
+  return true;
+}
+
+rcl_ret_t
+rcl_take_loaned_message(
+  const rcl_subscription_t * subscription,
+  const void ** loaned_message,
+  rcl_message_info_t * message_info)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(loaned_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  rcl_subscription_impl_t * impl = subscription->impl;
+  if (!impl->intra_process_enabled) {
+    RCL_SET_ERROR_MSG_LITERAL("this subscription cannot take loaned messages");
+    return RCL_RET_UNSUPPORTED;
+  }
+  // Find a slot to remember the message in, before taking it from the queue.
+  rcl_intra_process_held_message_t * held = NULL;
+  size_t i;
+  for (i = 0; i < impl->options.intra_process_depth; ++i) {
+    if (!impl->intra_process_held_messages[i].message) {
+      held = &impl->intra_process_held_messages[i];
+      break;
+    }
+  }
+  if (!held) {
+    RCL_SET_ERROR_MSG_LITERAL("too many loaned messages are held, return some first");
+    return RCL_RET_ERROR;
+  }
+  const void * message;
+  rcl_message_pool_t * pool;
+  rcl_intra_process_stamp_t stamp;
+  // Filtered messages go back to their publishers right away.
+  for (;;) {
+    if (!__dequeue_intra_process(impl, &message, &pool, &stamp)) {
+      __empty_take(impl);
+      return RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+    }
+    if (rcl_impl_content_filter_accept(&impl->content_filter, message)) {
+      break;
+    }
+    (void)rcl_impl_message_pool_release(pool, message);
+  }
+  held->message = message;
+  held->pool = pool;
+  *loaned_message = message;
+  __message_taken(
+    impl, message, stamp.source_timestamp,
+    message_info ? &message_info->received_timestamp : NULL);
+  if (message_info) {
+    memset(
+      &message_info->rmw_message_info.publisher_gid, 0,
+      sizeof(message_info->rmw_message_info.publisher_gid));
+    message_info->rmw_message_info.from_intra_process = true;
+    message_info->source_timestamp = stamp.source_timestamp;
+    message_info->publication_sequence_number = stamp.sequence_number;
+  }
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_return_loaned_message_from_subscription(
+  const rcl_subscription_t * subscription,
+  const void * loaned_message)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(loaned_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  rcl_subscription_impl_t * impl = subscription->impl;
+  size_t i;
+  for (i = 0; impl->intra_process_enabled && i < impl->options.intra_process_depth; ++i) {
+    rcl_intra_process_held_message_t * held = &impl->intra_process_held_messages[i];
+    if (held->message == loaned_message) {
+      rcl_message_pool_t * pool = held->pool;
+      held->message = NULL;
+      held->pool = NULL;
+      return rcl_impl_message_pool_release(pool, loaned_message);
+    }
+  }
+  RCL_SET_ERROR_MSG_LITERAL("message was not taken from this subscription");
+  return RCL_RET_INVALID_ARGUMENT;
+}
+
+rcl_ret_t
+rcl_subscription_get_filtered_count(
+  const rcl_subscription_t * subscription,
+  uint64_t * filtered_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(filtered_count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  *filtered_count = rcl_atomic_load_uint64_t(&subscription->impl->content_filter.filtered_count);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_subscription_get_skipped_count(
+  const rcl_subscription_t * subscription,
+  uint64_t * skipped_count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(skipped_count, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  *skipped_count = rcl_atomic_load_uint64_t(&subscription->impl->skipped_count);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_subscription_get_statistics(
+  const rcl_subscription_t * subscription,
+  rcl_subscription_statistics_t * statistics)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(statistics, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl->statistics, "statistics are not enabled for this subscription",
+    return RCL_RET_INVALID_ARGUMENT);
+  rcl_impl_subscription_statistics_snapshot(subscription->impl->statistics, statistics);
+  return RCL_RET_OK;
+}
+
+// Return the cache of the subscription, or NULL with the error state set.
+static const rcl_message_cache_t *
+__get_cache(const rcl_subscription_t * subscription)
+{
+  if (!subscription->impl->cache.storage) {
+    RCL_SET_ERROR_MSG_LITERAL("the subscription has no message cache");
+    return NULL;
+  }
+  return &subscription->impl->cache;
+}
+
+rcl_ret_t
+rcl_message_cache_lookup(
+  const rcl_subscription_t * subscription,
+  rcl_time_point_value_t time,
+  rcl_message_cache_match_t match,
+  const void ** ros_message,
+  rcl_time_point_value_t * receive_time)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(ros_message, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  const rcl_message_cache_t * cache = __get_cache(subscription);
+  if (!cache) {
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  size_t index;
+  switch (match) {
+    case RCL_MESSAGE_CACHE_BEFORE:
+      index = rcl_impl_message_cache_upper_bound(cache, time);
+      if (index == 0) {
+        return RCL_RET_SUBSCRIPTION_CACHE_MISS;
+      }
+      --index;
+      break;
+    case RCL_MESSAGE_CACHE_AFTER:
+      index = rcl_impl_message_cache_lower_bound(cache, time);
+      if (index == cache->size) {
+        return RCL_RET_SUBSCRIPTION_CACHE_MISS;
+      }
+      break;
+    case RCL_MESSAGE_CACHE_NEAREST:
+      if (cache->size == 0) {
+        return RCL_RET_SUBSCRIPTION_CACHE_MISS;
+      }
+      index = rcl_impl_message_cache_lower_bound(cache, time);
+      // Either the first message at or after the time, or the one before it is nearest.
+      if (index == cache->size) {
+        --index;
+      } else if (index > 0) {
+        rcl_time_point_value_t before;
+        rcl_time_point_value_t after;
+        rcl_impl_message_cache_at(cache, index - 1, &before);
+        rcl_impl_message_cache_at(cache, index, &after);
+        if (time - before <= after - time) {
+          --index;  // On a tie the older message wins.
+        }
+      }
+      break;
+    default:
+      RCL_SET_ERROR_MSG_LITERAL("unknown message cache match");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  *ros_message = rcl_impl_message_cache_at(cache, index, receive_time);
+  return RCL_RET_OK;
+}
+
+rcl_ret_t
+rcl_message_cache_get_range(
+  const rcl_subscription_t * subscription,
+  rcl_time_point_value_t start,
+  rcl_time_point_value_t end,
+  const void ** ros_messages,
+  rcl_time_point_value_t * receive_times,
+  size_t capacity,
+  size_t * count)
+{
+  RCL_CHECK_ARGUMENT_FOR_NULL(subscription, RCL_RET_INVALID_ARGUMENT);
+  RCL_CHECK_ARGUMENT_FOR_NULL(count, RCL_RET_INVALID_ARGUMENT);
+  if (capacity > 0) {
+    RCL_CHECK_ARGUMENT_FOR_NULL(ros_messages, RCL_RET_INVALID_ARGUMENT);
+  }
+  RCL_CHECK_FOR_NULL_WITH_MSG(
+    subscription->impl, "subscription is invalid", return RCL_RET_SUBSCRIPTION_INVALID);
+  const rcl_message_cache_t * cache = __get_cache(subscription);
+  if (!cache) {
+    return RCL_RET_INVALID_ARGUMENT;
+  }
+  *count = 0;
+  if (start > end) {
+    return RCL_RET_OK;
+  }
+  size_t first = rcl_impl_message_cache_lower_bound(cache, start);
+  size_t last = rcl_impl_message_cache_upper_bound(cache, end);
+  *count = last - first;
+  size_t i;
+  for (i = 0; i < *count && i < capacity; ++i) {
+    ros_messages[i] = rcl_impl_message_cache_at(
+      cache, first + i, receive_times ? &receive_times[i] : NULL);
+  }
+  return RCL_RET_OK;
+}
+
 const char *
 rcl_subscription_get_topic_name(const rcl_subscription_t * subscription)
 {
@@ -0,0 +1,100 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include "./throttle.h"
+
+#include "./common.h"
+
+rcl_ret_t
+rcl_impl_throttle_init(rcl_throttle_t * throttle, const rcl_publisher_options_t * options)
+{
+  throttle->mode = options->throttle_mode;
+  throttle->period_ns = options->throttle_period_ns;
+  throttle->keep_every_nth = options->throttle_keep_every_nth;
+  throttle->burst = options->throttle_burst;
+  switch (throttle->mode) {
+    case RCL_PUBLISHER_THROTTLE_NONE:
+      break;
+    case RCL_PUBLISHER_THROTTLE_MAX_RATE:
+      if (throttle->period_ns == 0) {
+        RCL_SET_ERROR_MSG_LITERAL("throttle_period_ns must be greater than 0 to limit the rate");
+        return RCL_RET_INVALID_ARGUMENT;
+      }
+      throttle->burst = 1;
+      break;
+    case RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH:
+      if (throttle->keep_every_nth == 0) {
+        RCL_SET_ERROR_MSG_LITERAL("throttle_keep_every_nth must be greater than 0");
+        return RCL_RET_INVALID_ARGUMENT;
+      }
+      break;
+    case RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET:
+      if (throttle->period_ns == 0 || throttle->burst == 0) {
+        RCL_SET_ERROR_MSG_LITERAL("throttle_period_ns and throttle_burst must be greater than 0");
+        return RCL_RET_INVALID_ARGUMENT;
+      }
+      break;
+    default:
+      RCL_SET_ERROR_MSG_LITERAL("unknown throttle mode");
+      return RCL_RET_INVALID_ARGUMENT;
+  }
+  atomic_init(&throttle->state, 0);
+  atomic_init(&throttle->suppressed_count, 0);
+  return RCL_RET_OK;
+}
+
+bool
+rcl_impl_throttle_needs_clock(const rcl_throttle_t * throttle)
+{
+  return throttle->mode == RCL_PUBLISHER_THROTTLE_MAX_RATE ||
+         throttle->mode == RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET;
+}
+
+bool
+rcl_impl_throttle_admit(rcl_throttle_t * throttle, rcl_time_point_value_t now)
+{
+  if (throttle->mode == RCL_PUBLISHER_THROTTLE_NONE) {
+    return true;
+  }
+  if (throttle->mode == RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH) {
+    uint64_t index = rcl_atomic_fetch_add_uint64_t(&throttle->state, 1);
+    if (index % throttle->keep_every_nth == 0) {
+      return true;
+    }
+    rcl_atomic_fetch_add_uint64_t(&throttle->suppressed_count, 1);
+    return false;
+  }
+  // A message conforms if the bucket has a token left, i.e. if the theoretical
+  // arrival time is less than burst periods ahead of now.
+  uint64_t tolerance = (throttle->burst - 1) * throttle->period_ns;
+  uint64_t arrival_time = rcl_atomic_load_uint64_t(&throttle->state);
+  do {
+    if (now + tolerance < arrival_time) {
+      rcl_atomic_fetch_add_uint64_t(&throttle->suppressed_count, 1);
+      return false;
+    }
+  } while (!rcl_atomic_compare_exchange_strong_uint_least64_t(
+    &throttle->state, &arrival_time,
+    (arrival_time > now ? arrival_time : now) + throttle->period_ns));
+  return true;
+}
+
+#if __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RCL__THROTTLE_H_
+#define RCL__THROTTLE_H_
+
+#if __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+
+#include "rcl/publisher.h"
+#include "rcl/time.h"
+#include "rcl/types.h"
+
+#include "./stdatomic_helper.h"
+
+/// State of the throttling of a publisher.
+/* The state is a single atomic value, so admitting a message is lock-free:
+ *   - for RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH it counts the messages
+ *   - for the other modes it is the theoretical arrival time of the generic
+ *     cell rate algorithm, i.e. the time at which the bucket would be full
+ *     again, which makes the max rate mode a token bucket with a burst of 1
+ */
+typedef struct rcl_throttle_t
+{
+  rcl_publisher_throttle_mode_t mode;
+  /// Time it takes to earn one token, in nanoseconds.
+  uint64_t period_ns;
+  uint64_t keep_every_nth;
+  /// Number of tokens the bucket holds.
+  uint64_t burst;
+  atomic_uint_least64_t state;
+  atomic_uint_least64_t suppressed_count;
+} rcl_throttle_t;
+
+/// Validate the throttle options and initialize the throttle from them.
+/* \return RCL_RET_OK if the throttle was initialized, or
+ *         RCL_RET_INVALID_ARGUMENT if the options are invalid.
+ */
+rcl_ret_t
+rcl_impl_throttle_init(rcl_throttle_t * throttle, const rcl_publisher_options_t * options);
+
+/// Return true if rcl_impl_throttle_admit() needs the current time.
+bool
+rcl_impl_throttle_needs_clock(const rcl_throttle_t * throttle);
+
+/// Return true if a message may be published now, otherwise count it as suppressed.
+/* This function does not allocate heap memory.
+ * This function is thread-safe.
+ * This function is lock-free.
+ *
+ * \param[in] throttle the throttle of the publisher
+ * \param[in] now the steady time, only used if rcl_impl_throttle_needs_clock()
+ */
+bool
+rcl_impl_throttle_admit(rcl_throttle_t * throttle, rcl_time_point_value_t now);
+
+#if __cplusplus
+}
+#endif
+
+#endif  // RCL__THROTTLE_H_
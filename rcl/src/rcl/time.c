@@ -104,7 +104,7 @@ rcl_fini_ros_time_source(rcl_time_source_t * time_source)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(time_source, RCL_RET_INVALID_ARGUMENT);
   if (time_source->type != RCL_ROS_TIME) {
-    RCL_SET_ERROR_MSG("time_source not of type RCL_ROS_TIME");
+    RCL_SET_ERROR_MSG_LITERAL("time_source not of type RCL_ROS_TIME");
     return RCL_RET_ERROR;
   }
   free((rcl_ros_time_source_storage_t *)time_source->data);
@@ -126,7 +126,7 @@ rcl_fini_steady_time_source(rcl_time_source_t * time_source)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(time_source, RCL_RET_INVALID_ARGUMENT);
   if (time_source->type != RCL_STEADY_TIME) {
-    RCL_SET_ERROR_MSG("time_source not of type RCL_STEADY_TIME");
+    RCL_SET_ERROR_MSG_LITERAL("time_source not of type RCL_STEADY_TIME");
     return RCL_RET_ERROR;
   }
   return RCL_RET_OK;
@@ -147,7 +147,7 @@ rcl_fini_system_time_source(rcl_time_source_t * time_source)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(time_source, RCL_RET_INVALID_ARGUMENT);
   if (time_source->type != RCL_SYSTEM_TIME) {
-    RCL_SET_ERROR_MSG("time_source not of type RCL_SYSTEM_TIME");
+    RCL_SET_ERROR_MSG_LITERAL("time_source not of type RCL_SYSTEM_TIME");
     return RCL_RET_ERROR;
   }
   return RCL_RET_OK;
@@ -250,7 +250,7 @@ rcl_difference_times(rcl_time_point_t * start, rcl_time_point_t * finish,
   rcl_duration_t * delta)
 {
   if (start->time_source->type != finish->time_source->type) {
-    RCL_SET_ERROR_MSG("Cannot difference between time points with time_sources types.");
+    RCL_SET_ERROR_MSG_LITERAL("Cannot difference between time points with time_sources types.");
     return RCL_RET_ERROR;
   }
   if (finish->nanoseconds < start->nanoseconds) {
@@ -269,7 +269,7 @@ rcl_get_time_point_now(rcl_time_point_t * time_point)
     return time_point->time_source->get_now(time_point->time_source->data,
              &(time_point->nanoseconds));
   }
-  RCL_SET_ERROR_MSG("time_source is not initialized or does not have get_now registered.");
+  RCL_SET_ERROR_MSG_LITERAL("time_source is not initialized or does not have get_now registered.");
   return RCL_RET_ERROR;
 }
 
@@ -278,13 +278,13 @@ rcl_enable_ros_time_override(rcl_time_source_t * time_source)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(time_source, RCL_RET_INVALID_ARGUMENT);
   if (time_source->type != RCL_ROS_TIME) {
-    RCL_SET_ERROR_MSG("Time source is not RCL_ROS_TIME cannot enable override.")
+    RCL_SET_ERROR_MSG_LITERAL("Time source is not RCL_ROS_TIME cannot enable override.");
     return RCL_RET_ERROR;
   }
   rcl_ros_time_source_storage_t * storage = \
     (rcl_ros_time_source_storage_t *)time_source->data;
   if (!storage) {
-    RCL_SET_ERROR_MSG("Storage not initialized, cannot enable.")
+    RCL_SET_ERROR_MSG_LITERAL("Storage not initialized, cannot enable.");
     return RCL_RET_ERROR;
   }
   storage->active = true;
@@ -301,7 +301,7 @@ rcl_disable_ros_time_override(rcl_time_source_t * time_source)
   rcl_ros_time_source_storage_t * storage = \
     (rcl_ros_time_source_storage_t *)time_source->data;
   if (!storage) {
-    RCL_SET_ERROR_MSG("Storage not initialized, cannot disable.")
+    RCL_SET_ERROR_MSG_LITERAL("Storage not initialized, cannot disable.");
     return RCL_RET_ERROR;
   }
   storage->active = false;
@@ -321,7 +321,7 @@ rcl_is_enabled_ros_time_override(
   rcl_ros_time_source_storage_t * storage = \
     (rcl_ros_time_source_storage_t *)time_source->data;
   if (!storage) {
-    RCL_SET_ERROR_MSG("Storage not initialized, cannot query.")
+    RCL_SET_ERROR_MSG_LITERAL("Storage not initialized, cannot query.");
     return RCL_RET_ERROR;
   }
   *is_enabled = storage->active;
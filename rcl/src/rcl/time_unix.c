@@ -63,7 +63,7 @@ rcl_system_time_now(rcl_time_point_value_t * now)
   clock_gettime(CLOCK_REALTIME, &timespec_now);
 #endif  // defined(__MACH__)
   if (__WOULD_BE_NEGATIVE(timespec_now.tv_sec, timespec_now.tv_nsec)) {
-    RCL_SET_ERROR_MSG("unexpected negative time");
+    RCL_SET_ERROR_MSG_LITERAL("unexpected negative time");
     return RCL_RET_ERROR;
   }
   *now = RCL_S_TO_NS(timespec_now.tv_sec) + timespec_now.tv_nsec;
@@ -94,7 +94,7 @@ rcl_steady_time_now(rcl_time_point_value_t * now)
 #endif  // defined(CLOCK_MONOTONIC_RAW)
 #endif  // defined(__MACH__)
   if (__WOULD_BE_NEGATIVE(timespec_now.tv_sec, timespec_now.tv_nsec)) {
-    RCL_SET_ERROR_MSG("unexpected negative time");
+    RCL_SET_ERROR_MSG_LITERAL("unexpected negative time");
     return RCL_RET_ERROR;
   }
   *now = RCL_S_TO_NS(timespec_now.tv_sec) + timespec_now.tv_nsec;
@@ -52,7 +52,7 @@ rcl_timer_init(
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
   if (timer->impl) {
-    RCL_SET_ERROR_MSG("timer already initailized, or memory was uninitialized");
+    RCL_SET_ERROR_MSG_LITERAL("timer already initailized, or memory was uninitialized");
     return RCL_RET_ALREADY_INIT;
   }
   rcl_time_point_value_t now_steady;
@@ -95,7 +95,7 @@ rcl_timer_call(rcl_timer_t * timer)
   RCL_CHECK_ARGUMENT_FOR_NULL(timer, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_FOR_NULL_WITH_MSG(timer->impl, "timer is invalid", return RCL_RET_TIMER_INVALID);
   if (rcl_atomic_load_bool(&timer->impl->canceled)) {
-    RCL_SET_ERROR_MSG("timer is canceled");
+    RCL_SET_ERROR_MSG_LITERAL("timer is canceled");
     return RCL_RET_TIMER_CANCELED;
   }
   rcl_time_point_value_t now_steady;
@@ -116,7 +116,7 @@ rcl_wait_set_init(
   rcl_ret_t fail_ret = RCL_RET_ERROR;
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   if (__wait_set_is_valid(wait_set)) {
-    RCL_SET_ERROR_MSG("wait_set already initialized, or memory was uninitialized.");
+    RCL_SET_ERROR_MSG_LITERAL("wait_set already initialized, or memory was uninitialized.");
     return RCL_RET_ALREADY_INIT;
   }
   RCL_CHECK_FOR_NULL_WITH_MSG(
@@ -234,7 +234,7 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   RCL_CHECK_ARGUMENT_FOR_NULL(allocator, RCL_RET_INVALID_ARGUMENT);
   if (!__wait_set_is_valid(wait_set)) {
-    RCL_SET_ERROR_MSG("wait set is invalid");
+    RCL_SET_ERROR_MSG_LITERAL("wait set is invalid");
     return RCL_RET_WAIT_SET_INVALID;
   }
   *allocator = wait_set->impl->allocator;
@@ -245,11 +245,11 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT); \
   RCL_CHECK_ARGUMENT_FOR_NULL(Type, RCL_RET_INVALID_ARGUMENT); \
   if (!__wait_set_is_valid(wait_set)) { \
-    RCL_SET_ERROR_MSG("wait set is invalid"); \
+    RCL_SET_ERROR_MSG_LITERAL("wait set is invalid"); \
     return RCL_RET_WAIT_SET_INVALID; \
   } \
   if (!(wait_set->impl->Type ## _index < wait_set->size_of_ ## Type ## s)) { \
-    RCL_SET_ERROR_MSG(#Type "s set is full"); \
+    RCL_SET_ERROR_MSG_LITERAL(#Type "s set is full"); \
     return RCL_RET_WAIT_SET_FULL; \
   } \
   size_t current_index = wait_set->impl->Type ## _index++; \
@@ -258,15 +258,16 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
 #define SET_ADD_RMW(Type, RMWStorage, RMWCount) \
   /* Also place into rmw storage. */ \
   rmw_ ## Type ## _t * rmw_handle = rcl_ ## Type ## _get_rmw_handle(Type); \
-  RCL_CHECK_FOR_NULL_WITH_MSG( \
-    rmw_handle, rcl_get_error_string_safe(), return RCL_RET_ERROR); \
+  if (!rmw_handle) { \
+    return RCL_RET_ERROR;  /* rcl error state should already be set. */ \
+  } \
   wait_set->impl->RMWStorage[current_index] = rmw_handle->data; \
   wait_set->impl->RMWCount++;
 
 #define SET_CLEAR(Type) \
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT); \
   if (!__wait_set_is_valid(wait_set)) { \
-    RCL_SET_ERROR_MSG("wait set is invalid"); \
+    RCL_SET_ERROR_MSG_LITERAL("wait set is invalid"); \
     return RCL_RET_WAIT_SET_INVALID; \
   } \
   memset( \
@@ -323,7 +324,7 @@ rcl_wait_set_get_allocator(const rcl_wait_set_t * wait_set, rcl_allocator_t * al
   if (!wait_set->impl->RMWStorage) { \
     allocator.deallocate((void *)wait_set->Type ## s, allocator.state); \
     wait_set->size_of_ ## Type ## s = 0; \
-    RCL_SET_ERROR_MSG("allocating memory failed"); \
+    RCL_SET_ERROR_MSG_LITERAL("allocating memory failed"); \
     return RCL_RET_BAD_ALLOC; \
   } \
 
@@ -502,13 +503,13 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
 {
   RCL_CHECK_ARGUMENT_FOR_NULL(wait_set, RCL_RET_INVALID_ARGUMENT);
   if (!__wait_set_is_valid(wait_set)) {
-    RCL_SET_ERROR_MSG("wait set is invalid");
+    RCL_SET_ERROR_MSG_LITERAL("wait set is invalid");
     return RCL_RET_WAIT_SET_INVALID;
   }
   if (wait_set->size_of_subscriptions == 0 && wait_set->size_of_guard_conditions == 0 &&
     wait_set->size_of_clients == 0 && wait_set->size_of_services == 0)
   {
-    RCL_SET_ERROR_MSG("wait set is empty");
+    RCL_SET_ERROR_MSG_LITERAL("wait set is empty");
     return RCL_RET_WAIT_SET_EMPTY;
   }
   // Calculate the timeout argument.
@@ -608,6 +609,9 @@ rcl_wait(rcl_wait_set_t * wait_set, int64_t timeout)
     assert(i < wait_set->impl->rmw_guard_conditions.guard_condition_count);  // Defensive.
     if (!wait_set->impl->rmw_guard_conditions.guard_conditions[i]) {
       wait_set->guard_conditions[i] = NULL;
+    } else {
+      // The trigger was reported here, so it is not passed to a callback set later.
+      rcl_impl_guard_condition_clear_unread_count(wait_set->guard_conditions[i]);
     }
   }
   // Set corresponding rcl client handles NULL.
@@ -14,6 +14,13 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "rcl/client.h"
 
 #include "rcl/rcl.h"
@@ -174,6 +181,15 @@ TEST_F(TestClientFixture, test_client_init_fini) {
 
   // An allocator with an invalid realloc will probably work (so we will not test it).
 
+  // Try passing options with a keep last history of depth 0 with init.
+  client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options_with_invalid_qos = rcl_client_get_default_options();
+  client_options_with_invalid_qos.qos.history = RMW_QOS_POLICY_KEEP_LAST_HISTORY;
+  client_options_with_invalid_qos.qos.depth = 0;
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic_name, &client_options_with_invalid_qos);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+
   // Try passing options with a failing allocator with init.
   client = rcl_get_zero_initialized_client();
   rcl_client_options_t client_options_with_failing_allocator;
@@ -186,3 +202,260 @@ TEST_F(TestClientFixture, test_client_init_fini) {
   EXPECT_EQ(RCL_RET_BAD_ALLOC, ret) << rcl_get_error_string_safe();
   rcl_reset_error();
 }
+
+/* Testing that asynchronous requests expire, and are completed when the client is finalized.
+ */
+TEST_F(TestClientFixture, test_client_async_timeout) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  const char * topic_name = "add_two_ints_async_timeout";
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  client_options.max_pending_requests = 2;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic_name, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    if (client.impl) {
+      rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  });
+  struct completion_t
+  {
+    int64_t sequence_number;
+    rcl_ret_t result;
+  };
+  std::vector<completion_t> completions;
+  completions.reserve(2);
+  auto callback = [](
+    const void * user_data, int64_t sequence_number, const void * ros_response, rcl_ret_t result)
+    {
+      EXPECT_EQ(nullptr, ros_response);
+      static_cast<std::vector<completion_t> *>(const_cast<void *>(user_data))->push_back(
+        {sequence_number, result});
+    };
+  example_interfaces__srv__AddTwoInts_Request req;
+  example_interfaces__srv__AddTwoInts_Request__init(&req);
+  // There is no service, so neither request gets a response.
+  int64_t expiring_sequence_number = 0;
+  ret = rcl_send_request_async(
+    &client, &req, RCL_MS_TO_NS(10), callback, &completions, &expiring_sequence_number);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  int64_t waiting_sequence_number = 0;
+  ret = rcl_send_request_async(&client, &req, 0, callback, &completions, &waiting_sequence_number);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  int64_t sequence_number = 0;
+  ret = rcl_send_request_async(&client, &req, 0, callback, &completions, &sequence_number);
+  EXPECT_EQ(RCL_RET_CLIENT_PENDING_REQUESTS_FULL, ret);
+  rcl_reset_error();
+  size_t pending_count = 0;
+  ret = rcl_client_get_pending_request_count(&client, &pending_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, pending_count);
+  int64_t next_timeout_ns = 0;
+  ret = rcl_client_expire_pending_requests(&client, &next_timeout_ns);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_TRUE(completions.empty());
+  EXPECT_GE(RCL_MS_TO_NS(10), next_timeout_ns);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ret = rcl_client_expire_pending_requests(&client, &next_timeout_ns);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(1u, completions.size());
+  EXPECT_EQ(expiring_sequence_number, completions[0].sequence_number);
+  EXPECT_EQ(RCL_RET_TIMEOUT, completions[0].result);
+  EXPECT_EQ(-1, next_timeout_ns);
+  // The request without a timeout is completed when the client goes away.
+  ret = rcl_client_fini(&client, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(2u, completions.size());
+  EXPECT_EQ(waiting_sequence_number, completions[1].sequence_number);
+  EXPECT_EQ(RCL_RET_CLIENT_INVALID, completions[1].result);
+}
+
+/* Test that asynchronous requests sent by many threads all reserve a slot of the table.
+ *
+ * Like test_client_concurrent_send, this relies on the send function of the
+ * tested middleware being thread-safe for one client.
+ */
+TEST_F(TestClientFixture, test_client_async_concurrent_send) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  const char * topic_name = "add_two_ints_async_concurrent_send";
+  const size_t thread_count = 4;
+  const size_t requests_per_thread = 50;
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  client_options.max_pending_requests = thread_count * requests_per_thread;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic_name, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    if (client.impl) {
+      rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  });
+  std::atomic<size_t> completed_count(0);
+  auto callback = [](
+    const void * user_data, int64_t sequence_number, const void * ros_response, rcl_ret_t result)
+    {
+      (void)sequence_number;
+      EXPECT_EQ(nullptr, ros_response);
+      EXPECT_EQ(RCL_RET_CLIENT_INVALID, result);
+      ++*static_cast<std::atomic<size_t> *>(const_cast<void *>(user_data));
+    };
+  example_interfaces__srv__AddTwoInts_Request req;
+  example_interfaces__srv__AddTwoInts_Request__init(&req);
+  std::atomic<size_t> sent_count(0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&]() {
+        for (size_t i = 0; i < requests_per_thread; ++i) {
+          int64_t sequence_number = 0;
+          // The request is only read, so the threads can share it.
+          if (rcl_send_request_async(
+              &client, &req, 0, callback, &completed_count, &sequence_number) == RCL_RET_OK)
+          {
+            ++sent_count;
+          }
+        }
+      });
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(thread_count * requests_per_thread, sent_count.load());
+  size_t pending_count = 0;
+  ret = rcl_client_get_pending_request_count(&client, &pending_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(thread_count * requests_per_thread, pending_count);
+  int64_t sequence_number = 0;
+  ret = rcl_send_request_async(&client, &req, 0, callback, &completed_count, &sequence_number);
+  EXPECT_EQ(RCL_RET_CLIENT_PENDING_REQUESTS_FULL, ret);
+  rcl_reset_error();
+  ret = rcl_client_fini(&client, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(thread_count * requests_per_thread, completed_count.load());
+}
+
+/* Measure the request rate of one client shared by a growing number of threads.
+ *
+ * Every request must get its own sequence number and be counted exactly once,
+ * which rcl only guarantees if the send function of the tested middleware is
+ * thread-safe for one client.
+ * The rates are recorded as test properties, and not checked, since they
+ * depend on the middleware and on the load of the machine.
+ */
+TEST_F(TestClientFixture, test_client_concurrent_send) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  const char * topic_name = "add_two_ints_concurrent_send";
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic_name, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  example_interfaces__srv__AddTwoInts_Request req;
+  example_interfaces__srv__AddTwoInts_Request__init(&req);
+  req.a = 1;
+  req.b = 2;
+  const size_t requests_per_thread = 1000;
+  std::set<int64_t> sequence_numbers;
+  uint64_t expected_count = 0;
+  for (size_t thread_count : {1u, 2u, 4u, 8u}) {
+    std::vector<std::vector<int64_t>> sent(thread_count);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < thread_count; ++t) {
+      sent[t].reserve(requests_per_thread);
+      threads.emplace_back([&client, &req, &sent, t, requests_per_thread]() {
+          for (size_t i = 0; i < requests_per_thread; ++i) {
+            int64_t sequence_number = 0;
+            // The request is only read, so the threads can share it.
+            if (rcl_send_request(&client, &req, &sequence_number) == RCL_RET_OK) {
+              sent[t].push_back(sequence_number);
+            }
+          }
+        });
+    }
+    for (std::thread & thread : threads) {
+      thread.join();
+    }
+    auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+    for (const std::vector<int64_t> & numbers : sent) {
+      ASSERT_EQ(requests_per_thread, numbers.size());
+      for (int64_t sequence_number : numbers) {
+        EXPECT_TRUE(sequence_numbers.insert(sequence_number).second) <<
+          "duplicate sequence number " << sequence_number;
+      }
+    }
+    expected_count += thread_count * requests_per_thread;
+    uint64_t sent_count = 0;
+    ret = rcl_client_get_sent_request_count(&client, &sent_count);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(expected_count, sent_count);
+    double requests_per_second = duration_us > 0 ?
+      1e6 * static_cast<double>(thread_count * requests_per_thread) / duration_us : 0.0;
+    RecordProperty(
+      "threads_" + std::to_string(thread_count) + "_requests_per_second",
+      static_cast<int>(requests_per_second));
+  }
+}
+
+/* Test that a batch of requests is sent and counted.
+ */
+TEST_F(TestClientFixture, test_client_send_request_batch) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  const char * topic_name = "add_two_ints_batch";
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic_name, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  example_interfaces__srv__AddTwoInts_Request req;
+  example_interfaces__srv__AddTwoInts_Request__init(&req);
+  const void * requests[] = {&req, &req, &req};
+  int64_t sequence_numbers[3] = {0, 0, 0};
+  size_t sent_count = 0;
+  ret = rcl_send_request_batch(&client, requests, 3, sequence_numbers, &sent_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3u, sent_count);
+  EXPECT_LT(sequence_numbers[0], sequence_numbers[1]);
+  EXPECT_LT(sequence_numbers[1], sequence_numbers[2]);
+  uint64_t count = 0;
+  ret = rcl_client_get_sent_request_count(&client, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3u, count);
+  // A null request is rejected before anything is sent.
+  requests[1] = nullptr;
+  ret = rcl_send_request_batch(&client, requests, 3, sequence_numbers, &sent_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  EXPECT_EQ(0u, sent_count);
+  // The pipelined batch needs the table of pending requests.
+  ret = rcl_send_request_batch_async(
+    &client, requests, 1, 0, [](const void *, int64_t, const void *, rcl_ret_t) {},
+    nullptr, sequence_numbers, &sent_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  example_interfaces__srv__AddTwoInts_Request__fini(&req);
+}
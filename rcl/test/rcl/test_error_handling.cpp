@@ -0,0 +1,101 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "rcl/error_handling.h"
+
+#include "../memory_tools/memory_tools.hpp"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+class CLASSNAME (TestErrorHandlingFixture, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    set_on_unexpected_malloc_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED MALLOC";});
+    set_on_unexpected_realloc_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED REALLOC";});
+    set_on_unexpected_free_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED FREE";});
+    start_memory_checking();
+  }
+
+  void TearDown()
+  {
+    assert_no_malloc_end();
+    assert_no_realloc_end();
+    assert_no_free_end();
+    stop_memory_checking();
+    set_on_unexpected_malloc_callback(nullptr);
+    set_on_unexpected_realloc_callback(nullptr);
+    set_on_unexpected_free_callback(nullptr);
+  }
+};
+
+/* Tests that literal error messages are only formatted when they are read.
+ */
+TEST_F(CLASSNAME(TestErrorHandlingFixture, RMW_IMPLEMENTATION), test_literal_error) {
+  stop_memory_checking();
+  rcl_reset_error();
+  EXPECT_FALSE(rcl_error_is_set());
+  // Setting and resetting a literal error message should not allocate.
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  RCL_SET_ERROR_MSG_LITERAL("first literal error");
+  bool error_is_set = rcl_error_is_set();
+  rcl_reset_error();
+  bool error_is_reset = !rcl_error_is_set();
+  RCL_SET_ERROR_MSG_LITERAL("second literal error");
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  EXPECT_TRUE(error_is_set);
+  EXPECT_TRUE(error_is_reset);
+  // Reading the error formats it, including where it was set.
+  std::string error_string = rcl_get_error_string_safe();
+  EXPECT_NE(std::string::npos, error_string.find("second literal error")) << error_string;
+  EXPECT_NE(std::string::npos, error_string.find("test_error_handling")) << error_string;
+  const rcl_error_state_t * error_state = rcl_get_error_state();
+  ASSERT_NE(nullptr, error_state);
+  EXPECT_EQ(std::string("second literal error"), error_state->message);
+  rcl_reset_error();
+  EXPECT_FALSE(rcl_error_is_set());
+}
+
+/* Tests that the error which was set last is reported.
+ */
+TEST_F(CLASSNAME(TestErrorHandlingFixture, RMW_IMPLEMENTATION), test_last_error_wins) {
+  stop_memory_checking();
+  std::string copied_message = "copied error";
+  RCL_SET_ERROR_MSG_LITERAL("literal error");
+  RCL_SET_ERROR_MSG(copied_message.c_str());
+  EXPECT_NE(
+    std::string::npos, std::string(rcl_get_error_string_safe()).find("copied error"));
+  rcl_reset_error();
+  RCL_SET_ERROR_MSG(copied_message.c_str());
+  RCL_SET_ERROR_MSG_LITERAL("literal error");
+  EXPECT_NE(
+    std::string::npos, std::string(rcl_get_error_string_safe()).find("literal error"));
+  rcl_reset_error();
+}
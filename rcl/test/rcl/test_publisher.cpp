@@ -14,6 +14,11 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
 #include "rcl/publisher.h"
 
 #include "rcl/rcl.h"
@@ -132,6 +137,692 @@ TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_nomin
   ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
 }
 
+/* Basic nominal test of publishing a batch of messages.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_batch) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_batch";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  const size_t count = 3;
+  std_msgs__msg__Int64 msgs[count];
+  const void * msg_pointers[count];
+  for (size_t i = 0; i < count; ++i) {
+    std_msgs__msg__Int64__init(&msgs[i]);
+    msgs[i].data = static_cast<int64_t>(i);
+    msg_pointers[i] = &msgs[i];
+  }
+  auto msgs_exit = make_scope_exit([&msgs]() {
+    for (auto & msg : msgs) {
+      std_msgs__msg__Int64__fini(&msg);
+    }
+  });
+  size_t published_count = 0;
+  ret = rcl_publish_batch(&publisher, msg_pointers, count, &published_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(count, published_count);
+  // An empty batch publishes nothing.
+  ret = rcl_publish_batch(&publisher, nullptr, 0, &published_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, published_count);
+  // Try passing a null publisher.
+  ret = rcl_publish_batch(nullptr, msg_pointers, count, &published_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, published_count);
+  rcl_reset_error();
+  // Try passing a null message inside of the batch, nothing should be published.
+  msg_pointers[1] = nullptr;
+  ret = rcl_publish_batch(&publisher, msg_pointers, count, &published_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, published_count);
+  rcl_reset_error();
+  // Try passing a null published_count.
+  ret = rcl_publish_batch(&publisher, msg_pointers, count, nullptr);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+}
+
+/* Test borrowing, publishing and returning loaned messages.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_loaned_message) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_loaned";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 2;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  void * first = nullptr;
+  void * second = nullptr;
+  void * third = nullptr;
+  // Borrowing and returning loaned messages should not allocate.
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_borrow_loaned_message(&publisher, &first);
+  EXPECT_EQ(RCL_RET_OK, ret);
+  ret = rcl_borrow_loaned_message(&publisher, &second);
+  EXPECT_EQ(RCL_RET_OK, ret);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  EXPECT_NE(first, second);
+  // The pool only has two messages.
+  ret = rcl_borrow_loaned_message(&publisher, &third);
+  EXPECT_EQ(RCL_RET_PUBLISHER_LOAN_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_return_loaned_message(&publisher, second);
+  EXPECT_EQ(RCL_RET_OK, ret);
+  ret = rcl_borrow_loaned_message(&publisher, &third);
+  EXPECT_EQ(RCL_RET_OK, ret);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  ret = rcl_return_loaned_message(&publisher, third);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // A message can only be returned once.
+  ret = rcl_return_loaned_message(&publisher, third);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  static_cast<std_msgs__msg__Int64 *>(first)->data = 42;
+  ret = rcl_publish_loaned_message(&publisher, first);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Messages which were not loaned by the publisher are rejected.
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  ret = rcl_publish_loaned_message(&publisher, &msg);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_return_loaned_message(&publisher, &msg);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  std_msgs__msg__Int64__fini(&msg);
+  // A publisher with the default options cannot lend messages.
+  rcl_publisher_t default_publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t default_publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(
+    &default_publisher, this->node_ptr, ts, topic_name, &default_publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_borrow_loaned_message(&default_publisher, &first);
+  EXPECT_EQ(RCL_RET_PUBLISHER_LOAN_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_publisher_fini(&default_publisher, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test the queue and overflow policies of asynchronous publishers.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_async) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_async";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.qos.history = RMW_QOS_POLICY_KEEP_LAST_HISTORY;
+  publisher_options.qos.depth = 2;
+  publisher_options.asynchronous = true;
+  publisher_options.async_message_size = sizeof(std_msgs__msg__Int64);
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  rcl_publisher_async_counters_t counters;
+  size_t flushed_count = 0;
+  const rcl_publisher_overflow_policy_t policies[] = {
+    RCL_PUBLISHER_OVERFLOW_DROP_OLDEST,
+    RCL_PUBLISHER_OVERFLOW_DROP_NEWEST,
+  };
+  for (rcl_publisher_overflow_policy_t policy : policies) {
+    rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+    publisher_options.async_overflow_policy = policy;
+    ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    auto publisher_exit = make_scope_exit([&publisher, this]() {
+      stop_memory_checking();
+      rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    });
+    EXPECT_NE(nullptr, rcl_publisher_get_async_guard_condition(&publisher));
+    // The first message wakes up the sender, the others are only queued.
+    msg.data = 0;
+    ret = rcl_publish(&publisher, &msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    start_memory_checking();
+    assert_no_malloc_begin();
+    assert_no_realloc_begin();
+    assert_no_free_begin();
+    msg.data = 1;
+    ret = rcl_publish(&publisher, &msg);
+    EXPECT_EQ(RCL_RET_OK, ret);
+    msg.data = 2;
+    ret = rcl_publish(&publisher, &msg);
+    EXPECT_EQ(RCL_RET_OK, ret);
+    assert_no_malloc_end();
+    assert_no_realloc_end();
+    assert_no_free_end();
+    stop_memory_checking();
+    ret = rcl_publisher_get_async_counters(&publisher, &counters);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(0u, counters.published);
+    if (policy == RCL_PUBLISHER_OVERFLOW_DROP_OLDEST) {
+      EXPECT_EQ(3u, counters.enqueued);
+      EXPECT_EQ(1u, counters.dropped_oldest);
+      EXPECT_EQ(0u, counters.dropped_newest);
+    } else {
+      EXPECT_EQ(2u, counters.enqueued);
+      EXPECT_EQ(0u, counters.dropped_oldest);
+      EXPECT_EQ(1u, counters.dropped_newest);
+    }
+    ret = rcl_publisher_flush_async_queue(&publisher, 1, &flushed_count);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(1u, flushed_count);
+    ret = rcl_publisher_flush_async_queue(&publisher, 0, &flushed_count);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(1u, flushed_count);
+    ret = rcl_publisher_get_async_counters(&publisher, &counters);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(2u, counters.published);
+    EXPECT_EQ(0u, counters.publish_errors);
+  }
+  // A blocking publisher waits until the sender thread has made room.
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  publisher_options.qos.depth = 1;
+  publisher_options.async_overflow_policy = RCL_PUBLISHER_OVERFLOW_BLOCK;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  std::thread sender([&publisher]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    size_t sender_flushed_count = 0;
+    rcl_ret_t ret = rcl_publisher_flush_async_queue(&publisher, 1, &sender_flushed_count);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  ret = rcl_publish(&publisher, &msg);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  sender.join();
+  ret = rcl_publisher_flush_async_queue(&publisher, 0, &flushed_count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, flushed_count);
+  ret = rcl_publisher_get_async_counters(&publisher, &counters);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, counters.enqueued);
+  EXPECT_EQ(2u, counters.published);
+  EXPECT_EQ(1u, counters.blocked);
+  // A publisher with the default options is not asynchronous.
+  rcl_publisher_t default_publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t default_publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(
+    &default_publisher, this->node_ptr, ts, topic_name, &default_publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(nullptr, rcl_publisher_get_async_guard_condition(&default_publisher));
+  rcl_reset_error();
+  ret = rcl_publisher_flush_async_queue(&default_publisher, 0, &flushed_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_publisher_get_async_counters(&default_publisher, &counters);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_publisher_fini(&default_publisher, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that asynchronous publishers can queue deep copies of messages with strings.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_async_copy) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, String);
+  const char * topic_name = "chatter_string_async_copy";
+  static size_t fini_count = 0;
+  static bool fail_copy = false;
+  fini_count = 0;
+  fail_copy = false;
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.qos.history = RMW_QOS_POLICY_KEEP_LAST_HISTORY;
+  publisher_options.qos.depth = 2;
+  publisher_options.asynchronous = true;
+  publisher_options.async_message_size = sizeof(std_msgs__msg__String);
+  publisher_options.async_message_fini = [](void * ros_message) {
+      ++fini_count;
+      std_msgs__msg__String__fini(static_cast<std_msgs__msg__String *>(ros_message));
+    };
+  // A fini function without a copy function would finalize data the caller owns.
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  publisher = rcl_get_zero_initialized_publisher();
+  publisher_options.async_message_copy = [](const void * source, void * destination) {
+      const std_msgs__msg__String * from = static_cast<const std_msgs__msg__String *>(source);
+      std_msgs__msg__String * to = static_cast<std_msgs__msg__String *>(destination);
+      return !fail_copy && std_msgs__msg__String__init(to) &&
+             rosidl_generator_c__String__assign(&to->data, from->data.data);
+    };
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    if (publisher.impl) {
+      rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  });
+  std_msgs__msg__String msg;
+  std_msgs__msg__String__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__String__fini(&msg);
+  });
+  // The same message is changed after each publish, which a shallow copy would share.
+  const char * test_strings[3] = {"a long first message", "short", "a medium one"};
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(rosidl_generator_c__String__assign(&msg.data, test_strings[i]));
+    ret = rcl_publish(&publisher, &msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  ASSERT_TRUE(rosidl_generator_c__String__assign(&msg.data, ""));
+  // The first copy was finalized when it was dropped to make room for the third.
+  EXPECT_EQ(1u, fini_count);
+  size_t flushed_count = 0;
+  ret = rcl_publisher_flush_async_queue(&publisher, 0, &flushed_count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, flushed_count);
+  EXPECT_EQ(3u, fini_count);
+  // A message which cannot be copied is not queued.
+  fail_copy = true;
+  ret = rcl_publish(&publisher, &msg);
+  EXPECT_EQ(RCL_RET_ERROR, ret);
+  rcl_reset_error();
+  fail_copy = false;
+  ret = rcl_publish(&publisher, &msg);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  rcl_publisher_async_counters_t counters;
+  ret = rcl_publisher_get_async_counters(&publisher, &counters);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(4u, counters.enqueued);
+  // Copies which were never flushed are finalized with the publisher.
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  publisher.impl = nullptr;
+  EXPECT_EQ(4u, fini_count);
+}
+
+/* Test the statistics collected by publishers.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_statistics) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_statistics";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.enable_statistics = true;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  rcl_publisher_t default_publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t default_publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(
+    &default_publisher, this->node_ptr, ts, topic_name, &default_publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto default_publisher_exit = make_scope_exit([&default_publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&default_publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  msg.data = 42;
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  const void * messages[] = {&msg, &msg};
+  size_t published_count = 0;
+  ret = rcl_publish_batch(&publisher, messages, 2, &published_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Taking a snapshot should not allocate.
+  rcl_publisher_statistics_t statistics;
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_publisher_get_statistics(&publisher, &statistics);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(std::string(topic_name), statistics.topic_name);
+  EXPECT_EQ(3u, statistics.message_count);
+  EXPECT_EQ(0u, statistics.error_count);
+  uint64_t calls = 0;
+  for (size_t i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    calls += statistics.latency_histogram[i];
+  }
+  EXPECT_EQ(2u, calls);
+  // Only the publisher with statistics enabled is listed for the node.
+  size_t count = 0;
+  ret = rcl_node_get_publisher_statistics(this->node_ptr, nullptr, 0, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, count);
+  rcl_publisher_statistics_t node_statistics[2];
+  ret = rcl_node_get_publisher_statistics(this->node_ptr, node_statistics, 2, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(1u, count);
+  EXPECT_EQ(3u, node_statistics[0].message_count);
+  ret = rcl_publisher_get_statistics(&default_publisher, &statistics);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // Finalizing the publisher removes it from the node.
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_node_get_publisher_statistics(this->node_ptr, node_statistics, 2, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, count);
+}
+
+/* Test rate limiting and decimation of publishers.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_throttle) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_throttle";
+  struct throttle_case_t
+  {
+    rcl_publisher_throttle_mode_t mode;
+    uint64_t period_ns;
+    uint64_t keep_every_nth;
+    uint64_t burst;
+    uint64_t expected_published;
+    size_t expected_batch_published;
+  };
+  // The period is long enough that no tokens are earned while the test runs.
+  const uint64_t hour_ns = 3600ull * 1000 * 1000 * 1000;
+  const throttle_case_t cases[] = {
+    {RCL_PUBLISHER_THROTTLE_NONE, 0, 0, 0, 9, 3},
+    {RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH, 0, 3, 0, 3, 1},
+    {RCL_PUBLISHER_THROTTLE_MAX_RATE, hour_ns, 0, 0, 1, 0},
+    {RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET, hour_ns, 0, 4, 4, 0},
+  };
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  for (const throttle_case_t & throttle_case : cases) {
+    rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    publisher_options.throttle_mode = throttle_case.mode;
+    publisher_options.throttle_period_ns = throttle_case.period_ns;
+    publisher_options.throttle_keep_every_nth = throttle_case.keep_every_nth;
+    publisher_options.throttle_burst = throttle_case.burst;
+    publisher_options.enable_statistics = true;
+    ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    auto publisher_exit = make_scope_exit([&publisher, this]() {
+      stop_memory_checking();
+      rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    });
+    for (int64_t i = 0; i < 6; ++i) {
+      msg.data = i;
+      ret = rcl_publish(&publisher, &msg);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+    const void * messages[] = {&msg, &msg, &msg};
+    size_t published_count = 0;
+    ret = rcl_publish_batch(&publisher, messages, 3, &published_count);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    // Suppressed messages of the batch are not counted as published.
+    EXPECT_EQ(throttle_case.expected_batch_published, published_count);
+    uint64_t suppressed_count = 0;
+    ret = rcl_publisher_get_suppressed_count(&publisher, &suppressed_count);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(9u - throttle_case.expected_published, suppressed_count);
+    rcl_publisher_statistics_t statistics;
+    ret = rcl_publisher_get_statistics(&publisher, &statistics);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(throttle_case.expected_published, statistics.message_count);
+  }
+  // Each throttle mode needs its parameters to be set.
+  const rcl_publisher_throttle_mode_t modes[] = {
+    RCL_PUBLISHER_THROTTLE_MAX_RATE,
+    RCL_PUBLISHER_THROTTLE_KEEP_EVERY_NTH,
+    RCL_PUBLISHER_THROTTLE_TOKEN_BUCKET,
+  };
+  for (rcl_publisher_throttle_mode_t mode : modes) {
+    rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    publisher_options.throttle_mode = mode;
+    ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+    EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+    rcl_reset_error();
+  }
+}
+
+/* Test that change-only publishers skip unchanged messages.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_changes_only) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_changes_only";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.publish_changes_only = true;
+  publisher_options.change_only_message_key =
+    [](const void * ros_message, rcl_serialized_message_t * key) {
+      auto message = static_cast<const std_msgs__msg__Int64 *>(ros_message);
+      rcl_ret_t ret = rcl_serialized_message_reserve(key, sizeof(message->data));
+      if (ret != RCL_RET_OK) {
+        return ret;
+      }
+      memcpy(key->buffer, &message->data, sizeof(message->data));
+      key->buffer_length = sizeof(message->data);
+      return RCL_RET_OK;
+    };
+  publisher_options.enable_statistics = true;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  msg.data = 42;
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Skipping an unchanged message should not allocate once the key buffer has grown.
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_publish(&publisher, &msg);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  std_msgs__msg__Int64 other_msg;
+  std_msgs__msg__Int64__init(&other_msg);
+  auto other_msg_exit = make_scope_exit([&other_msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&other_msg);
+  });
+  other_msg.data = 43;
+  const void * messages[] = {&msg, &other_msg, &other_msg, &msg};
+  size_t published_count = 0;
+  ret = rcl_publish_batch(&publisher, messages, 4, &published_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The first msg and the second other_msg are unchanged, and not counted as published.
+  EXPECT_EQ(2u, published_count);
+  uint64_t unchanged_count = 0;
+  ret = rcl_publisher_get_unchanged_count(&publisher, &unchanged_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3u, unchanged_count);
+  rcl_publisher_statistics_t statistics;
+  ret = rcl_publisher_get_statistics(&publisher, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3u, statistics.message_count);
+  // The change-only options must be consistent.
+  rcl_publisher_t invalid_publisher = rcl_get_zero_initialized_publisher();
+  publisher_options = rcl_publisher_get_default_options();
+  publisher_options.publish_changes_only = true;
+  ret = rcl_publisher_init(
+    &invalid_publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+}
+
+/* Test that change-only publishers compare the contents a message refers to.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_changes_only_string) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, String);
+  const char * topic_name = "chatter_string_changes_only";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.publish_changes_only = true;
+  publisher_options.change_only_message_key =
+    [](const void * ros_message, rcl_serialized_message_t * key) {
+      auto message = static_cast<const std_msgs__msg__String *>(ros_message);
+      rcl_ret_t ret = rcl_serialized_message_reserve(key, message->data.size);
+      if (ret != RCL_RET_OK) {
+        return ret;
+      }
+      memcpy(key->buffer, message->data.data, message->data.size);
+      key->buffer_length = message->data.size;
+      return RCL_RET_OK;
+    };
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  std_msgs__msg__String msg;
+  std_msgs__msg__String__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__String__fini(&msg);
+  });
+  ASSERT_TRUE(rosidl_generator_c__String__assign(&msg.data, "testing"));
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Changing the contents in place keeps the pointer and size of the string.
+  msg.data.data[0] = 'r';
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  uint64_t unchanged_count = 0;
+  ret = rcl_publisher_get_unchanged_count(&publisher, &unchanged_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, unchanged_count);
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_publisher_get_unchanged_count(&publisher, &unchanged_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, unchanged_count);
+}
+
+/* Test that the heartbeat of change-only publishers republishes unchanged messages.
+ */
+TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_changes_only_heartbeat) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic_name = "chatter_int64_heartbeat";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.publish_changes_only = true;
+  publisher_options.change_only_message_key =
+    [](const void * ros_message, rcl_serialized_message_t * key) {
+      auto message = static_cast<const std_msgs__msg__Int64 *>(ros_message);
+      rcl_ret_t ret = rcl_serialized_message_reserve(key, sizeof(message->data));
+      if (ret != RCL_RET_OK) {
+        return ret;
+      }
+      memcpy(key->buffer, &message->data, sizeof(message->data));
+      key->buffer_length = sizeof(message->data);
+      return RCL_RET_OK;
+    };
+  publisher_options.change_only_heartbeat_ns = 10ull * 1000 * 1000;
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic_name, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  msg.data = 42;
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  uint64_t unchanged_count = 0;
+  ret = rcl_publisher_get_unchanged_count(&publisher, &unchanged_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, unchanged_count);
+  // Once the heartbeat period has passed, the unchanged message is published again.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_publish(&publisher, &msg);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_publisher_get_unchanged_count(&publisher, &unchanged_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, unchanged_count);
+}
+
 /* Testing the publisher init and fini functions.
  */
 TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_init_fini) {
@@ -201,6 +892,27 @@ TEST_F(CLASSNAME(TestPublisherFixture, RMW_IMPLEMENTATION), test_publisher_init_
 
   // An allocator with an invalid realloc will probably work (so we will not test it).
 
+  // Try passing options with a keep last history of depth 0 with init.
+  publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options_with_invalid_qos = rcl_publisher_get_default_options();
+  publisher_options_with_invalid_qos.qos.history = RMW_QOS_POLICY_KEEP_LAST_HISTORY;
+  publisher_options_with_invalid_qos.qos.depth = 0;
+  ret = rcl_publisher_init(
+    &publisher, this->node_ptr, ts, topic_name, &publisher_options_with_invalid_qos);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+
+  // Try passing asynchronous options without a message size with init.
+  publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options_with_invalid_async;
+  publisher_options_with_invalid_async = rcl_publisher_get_default_options();
+  publisher_options_with_invalid_async.asynchronous = true;
+  publisher_options_with_invalid_async.async_message_size = 0;
+  ret = rcl_publisher_init(
+    &publisher, this->node_ptr, ts, topic_name, &publisher_options_with_invalid_async);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+
   // Try passing options with a failing allocator with init.
   publisher = rcl_get_zero_initialized_publisher();
   rcl_publisher_options_t publisher_options_with_failing_allocator;
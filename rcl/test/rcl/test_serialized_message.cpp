@@ -0,0 +1,121 @@
+// Copyright 2016 Open Source Robotics Foundation, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include "rcl/serialized_message.h"
+
+#include "../memory_tools/memory_tools.hpp"
+#include "rcl/error_handling.h"
+
+#ifdef RMW_IMPLEMENTATION
+# define CLASSNAME_(NAME, SUFFIX) NAME ## __ ## SUFFIX
+# define CLASSNAME(NAME, SUFFIX) CLASSNAME_(NAME, SUFFIX)
+#else
+# define CLASSNAME(NAME, SUFFIX) NAME
+#endif
+
+class CLASSNAME (TestSerializedMessageFixture, RMW_IMPLEMENTATION) : public ::testing::Test
+{
+public:
+  void SetUp()
+  {
+    set_on_unexpected_malloc_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED MALLOC";});
+    set_on_unexpected_realloc_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED REALLOC";});
+    set_on_unexpected_free_callback([]() {ASSERT_FALSE(true) << "UNEXPECTED FREE";});
+    start_memory_checking();
+  }
+
+  void TearDown()
+  {
+    assert_no_malloc_end();
+    assert_no_realloc_end();
+    assert_no_free_end();
+    stop_memory_checking();
+    set_on_unexpected_malloc_callback(nullptr);
+    set_on_unexpected_realloc_callback(nullptr);
+    set_on_unexpected_free_callback(nullptr);
+  }
+};
+
+/* Tests the init, reserve and fini functions of the serialized message.
+ */
+TEST_F(CLASSNAME(TestSerializedMessageFixture, RMW_IMPLEMENTATION), test_serialized_message) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_serialized_message_t serialized_message = rcl_get_zero_initialized_serialized_message();
+  EXPECT_EQ(nullptr, serialized_message.buffer);
+  EXPECT_EQ(0u, serialized_message.buffer_length);
+  EXPECT_EQ(0u, serialized_message.buffer_capacity);
+  // Try passing null to init.
+  ret = rcl_serialized_message_init(nullptr, 16, rcl_get_default_allocator());
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // Try passing an allocator without reallocate to init.
+  rcl_allocator_t allocator_without_reallocate = rcl_get_default_allocator();
+  allocator_without_reallocate.reallocate = nullptr;
+  ret = rcl_serialized_message_init(&serialized_message, 16, allocator_without_reallocate);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // Try a failing allocator.
+  rcl_allocator_t failing_allocator = rcl_get_default_allocator();
+  failing_allocator.allocate = failing_malloc;
+  failing_allocator.reallocate = failing_realloc;
+  failing_allocator.deallocate = failing_free;
+  ret = rcl_serialized_message_init(&serialized_message, 16, failing_allocator);
+  EXPECT_EQ(RCL_RET_BAD_ALLOC, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  serialized_message = rcl_get_zero_initialized_serialized_message();
+  // Normal usage.
+  ret = rcl_serialized_message_init(&serialized_message, 16, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_NE(nullptr, serialized_message.buffer);
+  EXPECT_EQ(16u, serialized_message.buffer_capacity);
+  EXPECT_EQ(0u, serialized_message.buffer_length);
+  // Init twice is an error.
+  ret = rcl_serialized_message_init(&serialized_message, 16, rcl_get_default_allocator());
+  EXPECT_EQ(RCL_RET_ALREADY_INIT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  memset(serialized_message.buffer, 42, 16);
+  serialized_message.buffer_length = 16;
+  // Reserving less than the capacity should not allocate.
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_serialized_message_reserve(&serialized_message, 8);
+  EXPECT_EQ(RCL_RET_OK, ret);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  EXPECT_EQ(16u, serialized_message.buffer_capacity);
+  // Growing keeps the contents.
+  ret = rcl_serialized_message_reserve(&serialized_message, 1024);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1024u, serialized_message.buffer_capacity);
+  EXPECT_EQ(16u, serialized_message.buffer_length);
+  for (size_t i = 0; i < serialized_message.buffer_length; ++i) {
+    EXPECT_EQ(42, serialized_message.buffer[i]);
+  }
+  ret = rcl_serialized_message_fini(&serialized_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(nullptr, serialized_message.buffer);
+  EXPECT_EQ(0u, serialized_message.buffer_capacity);
+  // Fini on a zero initialized serialized message is ok.
+  ret = rcl_serialized_message_fini(&serialized_message);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
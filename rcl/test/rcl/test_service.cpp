@@ -14,9 +14,13 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "rcl/service.h"
 
@@ -193,4 +197,590 @@ TEST_F(TestServiceFixture, test_service_nominal) {
   ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
   EXPECT_EQ(client_response.sum, 3);
   EXPECT_EQ(header.sequence_number, 1);
+
+  // The admission queue is disabled by default.
+  ret = rcl_service_admit_requests(&service, nullptr);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  EXPECT_EQ(nullptr, rcl_service_get_admission_guard_condition(&service));
+  rcl_reset_error();
+}
+
+/* Test that the response to an asynchronous request is passed to its callback.
+ */
+TEST_F(TestServiceFixture, test_service_async_client) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_async";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  client_options.max_pending_requests = 4;
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the client and the service.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  example_interfaces__srv__AddTwoInts_Request client_request;
+  example_interfaces__srv__AddTwoInts_Request__init(&client_request);
+  client_request.a = 1;
+  client_request.b = 2;
+  int64_t sum = 0;
+  auto callback = [](
+    const void * user_data, int64_t sequence_number, const void * ros_response, rcl_ret_t result)
+    {
+      (void)sequence_number;
+      ASSERT_EQ(RCL_RET_OK, result);
+      *static_cast<int64_t *>(const_cast<void *>(user_data)) =
+        static_cast<const example_interfaces__srv__AddTwoInts_Response *>(ros_response)->sum;
+    };
+  int64_t sequence_number;
+  ret = rcl_send_request_async(
+    &client, &client_request, RCL_S_TO_NS(10ull), callback, &sum, &sequence_number);
+  example_interfaces__srv__AddTwoInts_Request__fini(&client_request);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  bool success;
+  wait_for_service_to_be_ready(&service, 10, 100, success);
+  ASSERT_TRUE(success);
+  {
+    example_interfaces__srv__AddTwoInts_Response service_response;
+    example_interfaces__srv__AddTwoInts_Response__init(&service_response);
+    auto msg_exit = make_scope_exit([&service_response]() {
+      stop_memory_checking();
+      example_interfaces__srv__AddTwoInts_Response__fini(&service_response);
+    });
+    example_interfaces__srv__AddTwoInts_Request service_request;
+    example_interfaces__srv__AddTwoInts_Request__init(&service_request);
+    rmw_request_id_t header;
+    ret = rcl_take_request(&service, &header, &service_request);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    service_response.sum = service_request.a + service_request.b;
+    ret = rcl_send_response(&service, &header, &service_response);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  example_interfaces__srv__AddTwoInts_Response client_response;
+  example_interfaces__srv__AddTwoInts_Response__init(&client_response);
+  rmw_request_id_t header;
+  for (size_t tries = 0; tries < 10; ++tries) {
+    ret = rcl_take_response(&client, &header, &client_response);
+    if (ret != RCL_RET_CLIENT_TAKE_FAILED) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(sequence_number, header.sequence_number);
+  EXPECT_EQ(3, sum);
+  size_t pending_count = 1;
+  ret = rcl_client_get_pending_request_count(&client, &pending_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, pending_count);
+}
+
+/* Test that admitted requests are processed by worker threads, and that a full queue pushes back.
+ */
+TEST_F(TestServiceFixture, test_service_admission_queue) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_admission";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  service_options.request_queue_size = 2;
+  service_options.request_size = sizeof(example_interfaces__srv__AddTwoInts_Request);
+  service_options.request_init = [](void * ros_request) {
+      return example_interfaces__srv__AddTwoInts_Request__init(
+        static_cast<example_interfaces__srv__AddTwoInts_Request *>(ros_request));
+    };
+  service_options.request_fini = [](void * ros_request) {
+      example_interfaces__srv__AddTwoInts_Request__fini(
+        static_cast<example_interfaces__srv__AddTwoInts_Request *>(ros_request));
+    };
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  EXPECT_NE(nullptr, rcl_service_get_admission_guard_condition(&service));
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the client and the service.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  // Send one request more than the queue holds.
+  example_interfaces__srv__AddTwoInts_Request client_request;
+  example_interfaces__srv__AddTwoInts_Request__init(&client_request);
+  for (int64_t i = 0; i < 3; ++i) {
+    client_request.a = i;
+    client_request.b = 10;
+    int64_t sequence_number;
+    ret = rcl_send_request(&client, &client_request, &sequence_number);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  example_interfaces__srv__AddTwoInts_Request__fini(&client_request);
+  // Admit requests until the queue is full.
+  size_t admitted = 0;
+  for (size_t tries = 0; tries < 10; ++tries) {
+    size_t admitted_count;
+    ret = rcl_service_admit_requests(&service, &admitted_count);
+    admitted += admitted_count;
+    if (ret != RCL_RET_OK) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_EQ(RCL_RET_SERVICE_QUEUE_FULL, ret);
+  EXPECT_EQ(2u, admitted);
+  // Each worker processes one request and gives it back.
+  auto worker = [&service]() {
+      rcl_service_request_t * request;
+      rcl_ret_t ret = rcl_service_take_admitted_request(&service, &request);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      EXPECT_NE(0, request->admitted_timestamp);
+      auto ros_request =
+        static_cast<example_interfaces__srv__AddTwoInts_Request *>(request->ros_request);
+      example_interfaces__srv__AddTwoInts_Response response;
+      example_interfaces__srv__AddTwoInts_Response__init(&response);
+      response.sum = ros_request->a + ros_request->b;
+      ret = rcl_send_response(&service, &request->request_header, &response);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      example_interfaces__srv__AddTwoInts_Response__fini(&response);
+      ret = rcl_service_release_admitted_request(&service, request);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    };
+  std::thread first_worker(worker);
+  std::thread second_worker(worker);
+  first_worker.join();
+  second_worker.join();
+  rcl_service_request_t * request;
+  ret = rcl_service_take_admitted_request(&service, &request);
+  EXPECT_EQ(RCL_RET_SERVICE_TAKE_FAILED, ret);
+  // The released requests make room for the last one.
+  admitted = 0;
+  for (size_t tries = 0; tries < 10 && admitted == 0; ++tries) {
+    ret = rcl_service_admit_requests(&service, &admitted);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    if (admitted == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  EXPECT_EQ(1u, admitted);
+  worker();
+  // All three responses reach the client.
+  std::set<int64_t> sums;
+  example_interfaces__srv__AddTwoInts_Response client_response;
+  example_interfaces__srv__AddTwoInts_Response__init(&client_response);
+  for (size_t tries = 0; tries < 10 && sums.size() < 3; ++tries) {
+    rmw_request_id_t header;
+    ret = rcl_take_response(&client, &header, &client_response);
+    if (ret == RCL_RET_CLIENT_TAKE_FAILED) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    sums.insert(client_response.sum);
+  }
+  example_interfaces__srv__AddTwoInts_Response__fini(&client_response);
+  EXPECT_EQ(std::set<int64_t>({10, 11, 12}), sums);
+}
+
+/* Test that requests beyond max_requests_in_flight are dropped and counted.
+ */
+TEST_F(TestServiceFixture, test_service_max_requests_in_flight) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_in_flight";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  service_options.max_requests_in_flight = 1;
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the client and the service.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  example_interfaces__srv__AddTwoInts_Request request;
+  example_interfaces__srv__AddTwoInts_Request__init(&request);
+  auto request_exit = make_scope_exit([&request]() {
+    stop_memory_checking();
+    example_interfaces__srv__AddTwoInts_Request__fini(&request);
+  });
+  auto send_and_take = [&client, &service, &request](rmw_request_id_t * header) {
+      int64_t sequence_number;
+      rcl_ret_t ret = rcl_send_request(&client, &request, &sequence_number);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      for (size_t tries = 0; tries < 10; ++tries) {
+        ret = rcl_take_request(&service, header, &request);
+        if (ret != RCL_RET_SERVICE_TAKE_FAILED) {
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+      return ret;
+    };
+  rmw_request_id_t first_header;
+  ret = send_and_take(&first_header);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The first request is in flight, so the second one is dropped.
+  rmw_request_id_t second_header;
+  ret = send_and_take(&second_header);
+  EXPECT_EQ(RCL_RET_SERVICE_REQUEST_SHED, ret);
+  uint64_t overloaded_count = 0;
+  uint64_t expired_count = 1;
+  ret = rcl_service_get_shed_request_counts(&service, &overloaded_count, &expired_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, overloaded_count);
+  EXPECT_EQ(0u, expired_count);
+  // Answering the first request makes room for the next one.
+  example_interfaces__srv__AddTwoInts_Response response;
+  example_interfaces__srv__AddTwoInts_Response__init(&response);
+  ret = rcl_send_response(&service, &first_header, &response);
+  example_interfaces__srv__AddTwoInts_Response__fini(&response);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  rmw_request_id_t third_header;
+  ret = send_and_take(&third_header);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Abandoning a request which will not be answered makes room as well.
+  ret = rcl_service_abandon_request(&service);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  rmw_request_id_t fourth_header;
+  ret = send_and_take(&fourth_header);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that admitted requests older than max_request_age_ns are dropped and counted.
+ */
+TEST_F(TestServiceFixture, test_service_max_request_age) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_age";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  service_options.request_queue_size = 2;
+  service_options.request_size = sizeof(example_interfaces__srv__AddTwoInts_Request);
+  service_options.max_request_age_ns = RCL_MS_TO_NS(10);
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the client and the service.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  example_interfaces__srv__AddTwoInts_Request request;
+  example_interfaces__srv__AddTwoInts_Request__init(&request);
+  int64_t sequence_number;
+  ret = rcl_send_request(&client, &request, &sequence_number);
+  example_interfaces__srv__AddTwoInts_Request__fini(&request);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  size_t admitted = 0;
+  for (size_t tries = 0; tries < 10 && admitted == 0; ++tries) {
+    ret = rcl_service_admit_requests(&service, &admitted);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    if (admitted == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+  }
+  ASSERT_EQ(1u, admitted);
+  // Let the request become too old before a worker gets to it.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  rcl_service_request_t * admitted_request;
+  ret = rcl_service_take_admitted_request(&service, &admitted_request);
+  EXPECT_EQ(RCL_RET_SERVICE_TAKE_FAILED, ret);
+  uint64_t expired_count = 0;
+  ret = rcl_service_get_shed_request_counts(&service, nullptr, &expired_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, expired_count);
+  // The dropped request was released, so both slots can be admitted again.
+  ret = rcl_service_admit_requests(&service, &admitted);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that a repeated request is answered from the response cache without being returned.
+ */
+TEST_F(TestServiceFixture, test_service_response_cache) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_cached";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  service_options.response_size = sizeof(example_interfaces__srv__AddTwoInts_Response);
+  service_options.response_cache_size = 4096;
+  // The cache needs a key function.
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  service_options.request_key = [](const void * ros_request, rcl_serialized_message_t * key) {
+      auto request = static_cast<const example_interfaces__srv__AddTwoInts_Request *>(ros_request);
+      rcl_ret_t ret = rcl_serialized_message_reserve(key, 2 * sizeof(int64_t));
+      if (ret != RCL_RET_OK) {
+        return ret;
+      }
+      memcpy(key->buffer, &request->a, sizeof(int64_t));
+      memcpy(key->buffer + sizeof(int64_t), &request->b, sizeof(int64_t));
+      key->buffer_length = 2 * sizeof(int64_t);
+      return RCL_RET_OK;
+    };
+  // Finalizing shallow copies would finalize the responses of the caller.
+  service_options.response_fini = [](void * ros_response) {
+      example_interfaces__srv__AddTwoInts_Response__fini(
+        static_cast<example_interfaces__srv__AddTwoInts_Response *>(ros_response));
+    };
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  service_options.response_fini = nullptr;
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_client_t client = rcl_get_zero_initialized_client();
+  rcl_client_options_t client_options = rcl_client_get_default_options();
+  ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto client_exit = make_scope_exit([&client, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the client and the service.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  example_interfaces__srv__AddTwoInts_Request client_request;
+  example_interfaces__srv__AddTwoInts_Request__init(&client_request);
+  client_request.a = 1;
+  client_request.b = 2;
+  example_interfaces__srv__AddTwoInts_Request service_request;
+  example_interfaces__srv__AddTwoInts_Request__init(&service_request);
+  int64_t sequence_number;
+  ret = rcl_send_request(&client, &client_request, &sequence_number);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The first request is not cached yet, so it is returned and answered by the test.
+  rmw_request_id_t header;
+  for (size_t tries = 0; tries < 10; ++tries) {
+    ret = rcl_take_request(&service, &header, &service_request);
+    if (ret != RCL_RET_SERVICE_TAKE_FAILED) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  example_interfaces__srv__AddTwoInts_Response service_response;
+  example_interfaces__srv__AddTwoInts_Response__init(&service_response);
+  service_response.sum = service_request.a + service_request.b;
+  ret = rcl_send_response(&service, &header, &service_response);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_service_cache_response(&service, &service_request, &service_response);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  example_interfaces__srv__AddTwoInts_Response__fini(&service_response);
+  // The same request again is answered by rcl_take_request() itself.
+  ret = rcl_send_request(&client, &client_request, &sequence_number);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  uint64_t hit_count = 0;
+  uint64_t miss_count = 0;
+  for (size_t tries = 0; tries < 10 && hit_count == 0; ++tries) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ret = rcl_take_request(&service, &header, &service_request);
+    EXPECT_EQ(RCL_RET_SERVICE_TAKE_FAILED, ret);
+    ret = rcl_service_get_response_cache_counts(&service, &hit_count, &miss_count);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  EXPECT_EQ(1u, hit_count);
+  EXPECT_EQ(1u, miss_count);
+  // The client gets both responses.
+  example_interfaces__srv__AddTwoInts_Response client_response;
+  example_interfaces__srv__AddTwoInts_Response__init(&client_response);
+  size_t response_count = 0;
+  for (size_t tries = 0; tries < 10 && response_count < 2; ++tries) {
+    ret = rcl_take_response(&client, &header, &client_response);
+    if (ret == RCL_RET_CLIENT_TAKE_FAILED) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      continue;
+    }
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(3, client_response.sum);
+    ++response_count;
+  }
+  example_interfaces__srv__AddTwoInts_Response__fini(&client_response);
+  EXPECT_EQ(2u, response_count);
+  example_interfaces__srv__AddTwoInts_Request__fini(&service_request);
+  example_interfaces__srv__AddTwoInts_Request__fini(&client_request);
+}
+
+/* Benchmark the throughput of a pipelined client for several window sizes.
+ */
+TEST_F(TestServiceFixture, test_service_pipelined_client) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_service_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(
+    example_interfaces, srv, AddTwoInts);
+  const char * topic = "add_two_ints_pipelined";
+  rcl_service_t service = rcl_get_zero_initialized_service();
+  rcl_service_options_t service_options = rcl_service_get_default_options();
+  ret = rcl_service_init(&service, this->node_ptr, ts, topic, &service_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto service_exit = make_scope_exit([&service, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_service_fini(&service, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // The service answers requests in its own thread for the whole test.
+  std::atomic<bool> done(false);
+  std::thread server([&service, &done]() {
+      example_interfaces__srv__AddTwoInts_Request request;
+      example_interfaces__srv__AddTwoInts_Request__init(&request);
+      example_interfaces__srv__AddTwoInts_Response response;
+      example_interfaces__srv__AddTwoInts_Response__init(&response);
+      while (!done) {
+        rmw_request_id_t header;
+        rcl_ret_t ret = rcl_take_request(&service, &header, &request);
+        if (ret != RCL_RET_OK) {
+          std::this_thread::yield();
+          continue;
+        }
+        response.sum = request.a + request.b;
+        ret = rcl_send_response(&service, &header, &response);
+        EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      }
+      example_interfaces__srv__AddTwoInts_Response__fini(&response);
+      example_interfaces__srv__AddTwoInts_Request__fini(&request);
+    });
+  auto server_exit = make_scope_exit([&server, &done]() {
+    done = true;
+    server.join();
+  });
+  example_interfaces__srv__AddTwoInts_Request client_request;
+  example_interfaces__srv__AddTwoInts_Request__init(&client_request);
+  client_request.a = 1;
+  client_request.b = 2;
+  const size_t request_count = 1000;
+  const size_t batch_size = 16;
+  // The request is only read, so every element of the batch can point to it.
+  std::vector<const void *> requests(batch_size, &client_request);
+  std::vector<int64_t> sequence_numbers(batch_size);
+  std::vector<example_interfaces__srv__AddTwoInts_Response> responses(batch_size);
+  std::vector<void *> response_pointers;
+  for (example_interfaces__srv__AddTwoInts_Response & response : responses) {
+    example_interfaces__srv__AddTwoInts_Response__init(&response);
+    response_pointers.push_back(&response);
+  }
+  std::vector<rmw_request_id_t> headers(batch_size);
+  for (size_t window : {1u, 4u, 16u, 64u}) {
+    rcl_client_t client = rcl_get_zero_initialized_client();
+    rcl_client_options_t client_options = rcl_client_get_default_options();
+    client_options.max_pending_requests = window;
+    ret = rcl_client_init(&client, this->node_ptr, ts, topic, &client_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    auto client_exit = make_scope_exit([&client, this]() {
+      stop_memory_checking();
+      rcl_ret_t ret = rcl_client_fini(&client, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    });
+    // Give the middleware time to connect the client and the service.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    size_t completed = 0;
+    auto callback = [](
+      const void * user_data, int64_t sequence_number, const void * ros_response, rcl_ret_t result)
+      {
+        (void)sequence_number;
+        EXPECT_EQ(RCL_RET_OK, result);
+        auto response = static_cast<const example_interfaces__srv__AddTwoInts_Response *>(
+          ros_response);
+        if (response) {
+          EXPECT_EQ(3, response->sum);
+        }
+        ++*static_cast<size_t *>(const_cast<void *>(user_data));
+      };
+    size_t sent = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(30);
+    while (completed < request_count && std::chrono::steady_clock::now() < deadline) {
+      size_t sent_count = 0;
+      size_t count = std::min(batch_size, request_count - sent);
+      if (count > 0) {
+        ret = rcl_send_request_batch_async(
+          &client, requests.data(), count, RCL_S_TO_NS(10ull), callback, &completed,
+          sequence_numbers.data(), &sent_count);
+        if (ret == RCL_RET_CLIENT_PENDING_REQUESTS_FULL) {
+          rcl_reset_error();
+        } else {
+          ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+        }
+        sent += sent_count;
+      }
+      size_t taken_count = 0;
+      ret = rcl_take_response_batch(
+        &client, headers.data(), response_pointers.data(), batch_size, &taken_count);
+      if (ret != RCL_RET_CLIENT_TAKE_FAILED) {
+        ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      }
+      ret = rcl_client_expire_pending_requests(&client, nullptr);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+    auto duration_us = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(request_count, completed);
+    double requests_per_second = duration_us > 0 ?
+      1e6 * static_cast<double>(request_count) / duration_us : 0.0;
+    RecordProperty(
+      "window_" + std::to_string(window) + "_requests_per_second",
+      static_cast<int>(requests_per_second));
+  }
+  for (example_interfaces__srv__AddTwoInts_Response & response : responses) {
+    example_interfaces__srv__AddTwoInts_Response__fini(&response);
+  }
+  example_interfaces__srv__AddTwoInts_Request__fini(&client_request);
 }
@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include <chrono>
+#include <cstddef>
 #include <string>
 #include <thread>
 
@@ -176,6 +177,687 @@ TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription
   }
 }
 
+/* Test the meta-data of a message taken from the middleware.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_message_info) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_message_info_chatter_int64";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  {
+    std_msgs__msg__Int64 msg;
+    std_msgs__msg__Int64__init(&msg);
+    msg.data = 42;
+    ret = rcl_publish(&publisher, &msg);
+    std_msgs__msg__Int64__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  bool success;
+  wait_for_subscription_to_be_ready(&subscription, 10, 100, success);
+  ASSERT_TRUE(success);
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  rcl_message_info_t message_info;
+  ret = rcl_take_with_info(&subscription, &msg, &message_info);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(42, msg.data);
+  EXPECT_FALSE(message_info.rmw_message_info.from_intra_process);
+  EXPECT_LT(0, message_info.received_timestamp);
+  // The middleware does not tell when or in which order the message was published.
+  EXPECT_EQ(0, message_info.source_timestamp);
+  EXPECT_EQ(0u, message_info.publication_sequence_number);
+}
+
+/* Test taking several messages at once.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_take_batch) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_take_batch_chatter_int64";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  std_msgs__msg__Int64 msgs[4];
+  void * ros_messages[4];
+  for (size_t i = 0; i < 4; ++i) {
+    std_msgs__msg__Int64__init(&msgs[i]);
+    ros_messages[i] = &msgs[i];
+  }
+  auto msgs_exit = make_scope_exit([&msgs]() {
+    stop_memory_checking();
+    for (size_t i = 0; i < 4; ++i) {
+      std_msgs__msg__Int64__fini(&msgs[i]);
+    }
+  });
+  // Invalid arguments are rejected before anything is taken.
+  size_t taken_count = 42;
+  ret = rcl_take_batch(&subscription, ros_messages, nullptr, 0, &taken_count);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, taken_count);
+  void * null_messages[] = {&msgs[0], nullptr};
+  ret = rcl_take_batch(&subscription, null_messages, nullptr, 2, &taken_count);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_take_batch(&subscription, ros_messages, nullptr, 4, nullptr);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  for (int64_t i = 0; i < 3; ++i) {
+    msgs[0].data = i;
+    ret = rcl_publish(&publisher, &msgs[0]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  // The messages may arrive one by one, so keep taking until all three are in.
+  rmw_message_info_t message_infos[4];
+  size_t total_taken = 0;
+  for (size_t tries = 0; tries < 10 && total_taken < 3; ++tries) {
+    bool success;
+    wait_for_subscription_to_be_ready(&subscription, 10, 100, success);
+    ASSERT_TRUE(success);
+    ret = rcl_take_batch(
+      &subscription, ros_messages + total_taken, message_infos + total_taken,
+      4 - total_taken, &taken_count);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    total_taken += taken_count;
+  }
+  ASSERT_EQ(3u, total_taken);
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(static_cast<int64_t>(i), msgs[i].data);
+    EXPECT_FALSE(message_infos[i].from_intra_process);
+  }
+  // Finding nothing to take is not an error, so it should not allocate or set an error.
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_take_batch(&subscription, ros_messages, message_infos, 4, &taken_count);
+  rcl_ret_t single_ret = rcl_take(&subscription, ros_messages[0], nullptr);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, taken_count);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, single_ret) << rcl_get_error_string_safe();
+  EXPECT_FALSE(rcl_error_is_set());
+}
+
+/* Test that subscriptions with the keep_latest_only option only take the latest message.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_keep_latest) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_keep_latest_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 3;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.intra_process_depth = 3;
+  subscription_options.keep_latest_only = true;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  for (int64_t i = 0; i < 3; ++i) {
+    void * loaned = nullptr;
+    ret = rcl_borrow_loaned_message(&publisher, &loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+    ret = rcl_publish_loaned_message(&publisher, loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  // The two older intra-process messages are given back to the publisher while taking.
+  const void * taken = nullptr;
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  uint64_t skipped_count = 0;
+  ret = rcl_subscription_get_skipped_count(&subscription, &skipped_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, skipped_count);
+  void * other = nullptr;
+  ret = rcl_borrow_loaned_message(&publisher, &other);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_return_loaned_message(&publisher, other);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The same messages also arrive through the middleware, possibly not all at once,
+  // but every message is either the one taken or skipped, and the last one taken is the latest.
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  uint64_t taken_count = 0;
+  for (size_t tries = 0; tries < 10 && taken_count + skipped_count < 5; ++tries) {
+    bool success;
+    wait_for_subscription_to_be_ready(&subscription, 10, 100, success);
+    ASSERT_TRUE(success);
+    ret = rcl_take(&subscription, &msg, nullptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    ++taken_count;
+    ret = rcl_subscription_get_skipped_count(&subscription, &skipped_count);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  EXPECT_EQ(5u, taken_count + skipped_count);
+  EXPECT_EQ(2, msg.data);
+}
+
+/* Test that the new message callback is told about each intra-process message.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_callback) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_callback_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 3;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Without intra-process delivery there is nothing which could call the callback yet.
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, nullptr, nullptr);
+  EXPECT_EQ(RCL_RET_UNSUPPORTED, ret);
+  rcl_reset_error();
+  ret = rcl_subscription_fini(&subscription, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  subscription_options.intra_process_depth = 3;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  auto publish = [&publisher](int64_t data) {
+      void * loaned = nullptr;
+      rcl_ret_t ret = rcl_borrow_loaned_message(&publisher, &loaned);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      static_cast<std_msgs__msg__Int64 *>(loaned)->data = data;
+      ret = rcl_publish_loaned_message(&publisher, loaned);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    };
+  auto count_events = [](const void * user_data, size_t number_of_events) {
+      *static_cast<size_t *>(const_cast<void *>(user_data)) += number_of_events;
+    };
+  // A message which arrived before the callback was set is reported when it is set.
+  publish(0);
+  size_t event_count = 0;
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, count_events, &event_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, event_count);
+  publish(1);
+  EXPECT_EQ(2u, event_count);
+  // After removing the callback messages are counted again until the next one is set.
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, nullptr, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  publish(2);
+  EXPECT_EQ(2u, event_count);
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, count_events, &event_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3u, event_count);
+  auto take_all = [&subscription](int64_t first, int64_t count) {
+      for (int64_t i = first; i < first + count; ++i) {
+        const void * taken = nullptr;
+        rcl_ret_t ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+        ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+        EXPECT_EQ(i, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+        ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+        EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      }
+    };
+  take_all(0, 3);
+  // A message which was reported by rcl_wait() is not passed to a callback set later.
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, nullptr, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  publish(3);
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 1, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_wait_set_add_guard_condition(
+    &wait_set, rcl_subscription_get_intra_process_guard_condition(&subscription));
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_wait_set_fini(&wait_set);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  event_count = 0;
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, count_events, &event_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0u, event_count);
+  take_all(3, 1);
+  // The callback is called without a lock held, so it can remove itself.
+  auto remove_self = [](const void * user_data, size_t) {
+      rcl_ret_t ret = rcl_subscription_set_on_new_message_callback(
+        static_cast<const rcl_subscription_t *>(user_data), nullptr, nullptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    };
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, remove_self, &subscription);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  publish(4);
+  publish(5);
+  event_count = 0;
+  ret = rcl_subscription_set_on_new_message_callback(&subscription, count_events, &event_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1u, event_count);
+  take_all(4, 2);
+}
+
+/* Test that the new message callback can publish to another intra-process subscription.
+ */
+TEST_F(
+  CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION),
+  test_subscription_callback_publishes)
+{
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topics[2] = {
+    "rcl_test_subscription_callback_publishes_chatter_int64",
+    "rcl_test_subscription_callback_publishes_relay_int64",
+  };
+  rcl_publisher_t publishers[2];
+  rcl_subscription_t subscriptions[2];
+  for (size_t i = 0; i < 2; ++i) {
+    publishers[i] = rcl_get_zero_initialized_publisher();
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    publisher_options.loaned_message_pool_size = 1;
+    publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+    ret = rcl_publisher_init(&publishers[i], this->node_ptr, ts, topics[i], &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    subscriptions[i] = rcl_get_zero_initialized_subscription();
+    rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+    subscription_options.intra_process_depth = 1;
+    ret = rcl_subscription_init(
+      &subscriptions[i], this->node_ptr, ts, topics[i], &subscription_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  auto exit = make_scope_exit([&publishers, &subscriptions, this]() {
+    stop_memory_checking();
+    for (size_t i = 0; i < 2; ++i) {
+      rcl_ret_t ret = rcl_subscription_fini(&subscriptions[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      ret = rcl_publisher_fini(&publishers[i], this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  });
+  // The first subscription relays each message to the second topic from its callback.
+  auto relay = [](const void * user_data, size_t number_of_events) {
+      rcl_publisher_t * relay_publisher =
+        static_cast<rcl_publisher_t *>(const_cast<void *>(user_data));
+      for (size_t i = 0; i < number_of_events; ++i) {
+        void * loaned = nullptr;
+        rcl_ret_t ret = rcl_borrow_loaned_message(relay_publisher, &loaned);
+        ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+        static_cast<std_msgs__msg__Int64 *>(loaned)->data = 42;
+        ret = rcl_publish_loaned_message(relay_publisher, loaned);
+        EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      }
+    };
+  ret = rcl_subscription_set_on_new_message_callback(&subscriptions[0], relay, &publishers[1]);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  void * loaned = nullptr;
+  ret = rcl_borrow_loaned_message(&publishers[0], &loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  static_cast<std_msgs__msg__Int64 *>(loaned)->data = 7;
+  ret = rcl_publish_loaned_message(&publishers[0], loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  const void * taken = nullptr;
+  ret = rcl_take_loaned_message(&subscriptions[1], &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(42, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  ret = rcl_return_loaned_message_from_subscription(&subscriptions[1], taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_take_loaned_message(&subscriptions[0], &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(7, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  ret = rcl_return_loaned_message_from_subscription(&subscriptions[0], taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that messages which do not meet the content filter are never taken.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_content_filter) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_content_filter_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 4;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Only take messages with 1 < data <= 3.
+  rcl_content_filter_condition_t conditions[2];
+  conditions[0].offset = offsetof(std_msgs__msg__Int64, data);
+  conditions[0].type = RCL_CONTENT_FILTER_INT64;
+  conditions[0].op = RCL_CONTENT_FILTER_GREATER;
+  conditions[0].value.int_value = 1;
+  conditions[1] = conditions[0];
+  conditions[1].op = RCL_CONTENT_FILTER_LESS_EQUAL;
+  conditions[1].value.int_value = 3;
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.ignore_local_publications = true;
+  subscription_options.intra_process_depth = 4;
+  subscription_options.content_filter = conditions;
+  subscription_options.content_filter_size = 2;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  for (int64_t i = 0; i < 4; ++i) {
+    void * loaned = nullptr;
+    ret = rcl_borrow_loaned_message(&publisher, &loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+    ret = rcl_publish_loaned_message(&publisher, loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  for (int64_t expected = 2; expected <= 3; ++expected) {
+    const void * taken = nullptr;
+    start_memory_checking();
+    assert_no_malloc_begin();
+    ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+    assert_no_malloc_end();
+    stop_memory_checking();
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    EXPECT_EQ(expected, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+    ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  uint64_t filtered_count = 0;
+  ret = rcl_subscription_get_filtered_count(&subscription, &filtered_count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, filtered_count);
+  // The filtered messages were given back, so the whole pool can be borrowed again.
+  void * loaned[4];
+  for (size_t i = 0; i < 4; ++i) {
+    ret = rcl_borrow_loaned_message(&publisher, &loaned[i]);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    ret = rcl_return_loaned_message(&publisher, loaned[i]);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  // Invalid conditions are rejected when the subscription is created.
+  conditions[1].op = static_cast<rcl_content_filter_operator_t>(42);
+  rcl_subscription_t invalid_subscription = rcl_get_zero_initialized_subscription();
+  ret = rcl_subscription_init(
+    &invalid_subscription, this->node_ptr, ts, topic, &subscription_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+}
+
+/* Test looking up the messages kept in the message cache of a subscription by time.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_message_cache) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_message_cache_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 4;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.intra_process_depth = 4;
+  subscription_options.cache_depth = 3;
+  subscription_options.cache_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Take four messages a few milliseconds apart, the first one is dropped from the cache.
+  for (int64_t i = 0; i < 4; ++i) {
+    void * loaned = nullptr;
+    ret = rcl_borrow_loaned_message(&publisher, &loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+    ret = rcl_publish_loaned_message(&publisher, loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    const void * taken = nullptr;
+    ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  const void * messages[3] = {nullptr, nullptr, nullptr};
+  rcl_time_point_value_t times[3] = {0, 0, 0};
+  size_t count = 0;
+  start_memory_checking();
+  assert_no_malloc_begin();
+  ret = rcl_message_cache_get_range(&subscription, 0, INT64_MAX, messages, times, 3, &count);
+  assert_no_malloc_end();
+  stop_memory_checking();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(3u, count);
+  for (size_t i = 0; i < count; ++i) {
+    EXPECT_EQ(static_cast<int64_t>(i + 1), static_cast<const std_msgs__msg__Int64 *>(
+        messages[i])->data);
+  }
+  EXPECT_LT(times[0], times[1]);
+  EXPECT_LT(times[1], times[2]);
+  // The copies in the cache stay valid after the loaned messages were returned.
+  const void * found = nullptr;
+  rcl_time_point_value_t found_time = 0;
+  ret = rcl_message_cache_lookup(
+    &subscription, times[1], RCL_MESSAGE_CACHE_BEFORE, &found, &found_time);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2, static_cast<const std_msgs__msg__Int64 *>(found)->data);
+  EXPECT_EQ(times[1], found_time);
+  ret = rcl_message_cache_lookup(
+    &subscription, times[1] + 1, RCL_MESSAGE_CACHE_AFTER, &found, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3, static_cast<const std_msgs__msg__Int64 *>(found)->data);
+  ret = rcl_message_cache_lookup(
+    &subscription, times[0] + 1, RCL_MESSAGE_CACHE_NEAREST, &found, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1, static_cast<const std_msgs__msg__Int64 *>(found)->data);
+  ret = rcl_message_cache_lookup(
+    &subscription, times[2] + 1000000000, RCL_MESSAGE_CACHE_NEAREST, &found, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(3, static_cast<const std_msgs__msg__Int64 *>(found)->data);
+  // Misses are expected, so they do not set an error.
+  ret = rcl_message_cache_lookup(
+    &subscription, times[0] - 1, RCL_MESSAGE_CACHE_BEFORE, &found, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_CACHE_MISS, ret);
+  EXPECT_FALSE(rcl_error_is_set());
+  ret = rcl_message_cache_lookup(
+    &subscription, times[2] + 1, RCL_MESSAGE_CACHE_AFTER, &found, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_CACHE_MISS, ret);
+  ret = rcl_message_cache_get_range(&subscription, times[1], times[2], nullptr, nullptr, 0, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(2u, count);
+  // A subscription without a cache cannot be looked up.
+  rcl_subscription_t no_cache = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t no_cache_options = rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(&no_cache, this->node_ptr, ts, topic, &no_cache_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_message_cache_lookup(&no_cache, 0, RCL_MESSAGE_CACHE_NEAREST, &found, nullptr);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_subscription_fini(&no_cache, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that the message cache keeps deep copies of messages with strings.
+ */
+TEST_F(
+  CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION),
+  test_subscription_message_cache_copy)
+{
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, String);
+  const char * topic = "rcl_test_subscription_message_cache_copy_chatter";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  static size_t fini_count = 0;
+  fini_count = 0;
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.cache_depth = 2;
+  subscription_options.cache_message_size = sizeof(std_msgs__msg__String);
+  subscription_options.cache_message_fini = [](void * ros_message) {
+      ++fini_count;
+      std_msgs__msg__String__fini(static_cast<std_msgs__msg__String *>(ros_message));
+    };
+  // A fini function without a copy function would finalize data the caller owns.
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  subscription = rcl_get_zero_initialized_subscription();
+  subscription_options.cache_message_copy = [](const void * source, void * destination) {
+      const std_msgs__msg__String * from = static_cast<const std_msgs__msg__String *>(source);
+      std_msgs__msg__String * to = static_cast<std_msgs__msg__String *>(destination);
+      return std_msgs__msg__String__init(to) &&
+             rosidl_generator_c__String__assign(&to->data, from->data.data);
+    };
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  // Every message is taken into the same string, which a shallow copy would share.
+  const char * test_strings[3] = {"a long first message", "short", "a medium one"};
+  std_msgs__msg__String msg;
+  std_msgs__msg__String__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__String__fini(&msg);
+  });
+  for (size_t i = 0; i < 3; ++i) {
+    std_msgs__msg__String published;
+    std_msgs__msg__String__init(&published);
+    ASSERT_TRUE(rosidl_generator_c__String__assign(&published.data, test_strings[i]));
+    ret = rcl_publish(&publisher, &published);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    bool success;
+    wait_for_subscription_to_be_ready(&subscription, 10, 100, success);
+    ASSERT_TRUE(success);
+    ret = rcl_take(&subscription, &msg, nullptr);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  // The first copy was finalized when it was dropped to make room for the third.
+  EXPECT_EQ(1u, fini_count);
+  const void * messages[2] = {nullptr, nullptr};
+  size_t count = 0;
+  ret = rcl_message_cache_get_range(&subscription, 0, INT64_MAX, messages, nullptr, 2, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(2u, count);
+  for (size_t i = 0; i < count; ++i) {
+    const std_msgs__msg__String * cached = static_cast<const std_msgs__msg__String *>(messages[i]);
+    EXPECT_NE(msg.data.data, cached->data.data);
+    EXPECT_EQ(std::string(test_strings[i + 1]), std::string(cached->data.data, cached->data.size));
+  }
+  ret = rcl_subscription_fini(&subscription, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  subscription = rcl_get_zero_initialized_subscription();
+  EXPECT_EQ(3u, fini_count);
+}
+
 /* Basic nominal test of a publisher with a string.
  */
 TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_nominal_string) {
@@ -231,3 +913,556 @@ TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription
     ASSERT_EQ(std::string(test_string), std::string(msg.data.data, msg.data.size));
   }
 }
+
+/* Test that taking into pooled messages reuses them without allocating.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_take_pool) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, String);
+  const char * topic = "rcl_test_subscription_take_pool_chatter";
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.take_message_pool_size = 1;
+  subscription_options.take_message_size = sizeof(std_msgs__msg__String);
+  subscription_options.take_message_init =
+    reinterpret_cast<rcl_message_init_function_t>(std_msgs__msg__String__init);
+  subscription_options.take_message_fini =
+    reinterpret_cast<rcl_message_fini_function_t>(std_msgs__msg__String__fini);
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  // Shorter strings after longer ones must fit into the memory the pooled string already has.
+  const char * test_strings[] = {"a string which sizes the pooled message", "shorter", "tiny"};
+  std_msgs__msg__String msg;
+  std_msgs__msg__String__init(&msg);
+  // The published message is not finalized, since with Connext that can cause
+  // a double free.
+  void * previous = nullptr;
+  for (const char * test_string : test_strings) {
+    stop_memory_checking();
+    ASSERT_TRUE(rosidl_generator_c__String__assign(&msg.data, test_string));
+    ret = rcl_publish(&publisher, &msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    bool success;
+    wait_for_subscription_to_be_ready(&subscription, 10, 100, success);
+    ASSERT_TRUE(success);
+    // The first take sizes the pooled string, the ones after it reuse that memory.
+    start_memory_checking();
+    if (previous) {
+      assert_no_malloc_begin();
+      assert_no_realloc_begin();
+      assert_no_free_begin();
+    }
+    void * taken = nullptr;
+    ret = rcl_take_pooled_message(&subscription, &taken, nullptr);
+    assert_no_malloc_end();
+    assert_no_realloc_end();
+    assert_no_free_end();
+    stop_memory_checking();
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    const std_msgs__msg__String * taken_msg = static_cast<const std_msgs__msg__String *>(taken);
+    EXPECT_EQ(std::string(test_string), std::string(taken_msg->data.data, taken_msg->data.size));
+    if (previous) {
+      EXPECT_EQ(previous, taken);
+    }
+    previous = taken;
+    // The only pooled message is in use until it is returned.
+    void * other = nullptr;
+    ret = rcl_take_pooled_message(&subscription, &other, nullptr);
+    EXPECT_EQ(RCL_RET_SUBSCRIPTION_POOL_EXHAUSTED, ret);
+    rcl_reset_error();
+    start_memory_checking();
+    assert_no_malloc_begin();
+    assert_no_realloc_begin();
+    assert_no_free_begin();
+    ret = rcl_return_pooled_message(&subscription, taken);
+    assert_no_malloc_end();
+    assert_no_realloc_end();
+    assert_no_free_end();
+    stop_memory_checking();
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  // Returning a message which was not taken from the pool fails.
+  ret = rcl_return_pooled_message(&subscription, &msg);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+}
+
+/* Compare publish throughput and delivery for a few quality of service profiles.
+ *
+ * The results are recorded as test properties, and only loosely checked, since
+ * they depend on the middleware and on the load of the machine.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_qos_throughput) {
+  stop_memory_checking();
+  struct qos_case_t
+  {
+    const char * name;
+    rmw_qos_reliability_policy_t reliability;
+    size_t depth;
+  };
+  const qos_case_t cases[] = {
+    {"reliable_depth_1", RMW_QOS_POLICY_RELIABLE, 1},
+    {"reliable_depth_100", RMW_QOS_POLICY_RELIABLE, 100},
+    {"best_effort_depth_1", RMW_QOS_POLICY_BEST_EFFORT, 1},
+    {"best_effort_depth_100", RMW_QOS_POLICY_BEST_EFFORT, 100},
+  };
+  const size_t number_of_messages = 100;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  for (const qos_case_t & qos_case : cases) {
+    rcl_ret_t ret;
+    std::string topic = std::string("rcl_test_subscription_qos_throughput_") + qos_case.name;
+    rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+    rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+    publisher_options.qos.history = RMW_QOS_POLICY_KEEP_LAST_HISTORY;
+    publisher_options.qos.depth = qos_case.depth;
+    publisher_options.qos.reliability = qos_case.reliability;
+    ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic.c_str(), &publisher_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    auto publisher_exit = make_scope_exit([&publisher, this]() {
+      stop_memory_checking();
+      rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    });
+    EXPECT_EQ(qos_case.depth, rcl_publisher_get_options(&publisher)->qos.depth);
+    rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+    rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+    subscription_options.qos = publisher_options.qos;
+    ret = rcl_subscription_init(
+      &subscription, this->node_ptr, ts, topic.c_str(), &subscription_options);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    auto subscription_exit = make_scope_exit([&subscription, this]() {
+      stop_memory_checking();
+      rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    });
+    // Give the middleware time to connect the publisher and the subscription.
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    std_msgs__msg__Int64 msg;
+    std_msgs__msg__Int64__init(&msg);
+    auto msg_exit = make_scope_exit([&msg]() {
+      stop_memory_checking();
+      std_msgs__msg__Int64__fini(&msg);
+    });
+    auto publish_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < number_of_messages; ++i) {
+      msg.data = static_cast<int64_t>(i);
+      ret = rcl_publish(&publisher, &msg);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+    auto publish_end = std::chrono::steady_clock::now();
+    auto receive_end = publish_end;
+    size_t received = 0;
+    bool success = true;
+    while (success) {
+      // Stop once nothing has arrived for half a second.
+      wait_for_subscription_to_be_ready(&subscription, 5, 100, success);
+      while (success && rcl_take(&subscription, &msg, nullptr) == RCL_RET_OK) {
+        ++received;
+        receive_end = std::chrono::steady_clock::now();
+      }
+      rcl_reset_error();
+    }
+    auto publish_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(publish_end - publish_start).count();
+    auto total_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(receive_end - publish_start).count();
+    RecordProperty(std::string(qos_case.name) + "_publish_us", static_cast<int>(publish_us));
+    RecordProperty(std::string(qos_case.name) + "_total_us", static_cast<int>(total_us));
+    RecordProperty(std::string(qos_case.name) + "_received", static_cast<int>(received));
+    EXPECT_LE(received, number_of_messages);
+    if (qos_case.reliability == RMW_QOS_POLICY_RELIABLE) {
+      // At least the last message must be kept, regardless of the depth.
+      EXPECT_GE(received, 1u);
+    }
+  }
+}
+
+/* Test handing loaned messages to a subscription in the same process.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_intra_process) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_intra_process_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 2;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.ignore_local_publications = true;
+  subscription_options.intra_process_depth = 1;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  const rcl_guard_condition_t * guard_condition =
+    rcl_subscription_get_intra_process_guard_condition(&subscription);
+  ASSERT_NE(nullptr, guard_condition) << rcl_get_error_string_safe();
+  EXPECT_TRUE(rcl_subscription_can_loan_messages(&subscription));
+  void * loaned = nullptr;
+  ret = rcl_borrow_loaned_message(&publisher, &loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  static_cast<std_msgs__msg__Int64 *>(loaned)->data = 42;
+  ret = rcl_publish_loaned_message(&publisher, loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The delivery triggers the guard condition, so waiting on it returns immediately.
+  rcl_wait_set_t wait_set = rcl_get_zero_initialized_wait_set();
+  ret = rcl_wait_set_init(&wait_set, 0, 1, 0, 0, 0, rcl_get_default_allocator());
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_wait_set_add_guard_condition(&wait_set, guard_condition);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_wait(&wait_set, RCL_S_TO_NS(1));
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(guard_condition, wait_set.guard_conditions[0]);
+  ret = rcl_wait_set_fini(&wait_set);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // Taking and returning the message should not allocate or copy it.
+  const void * taken = nullptr;
+  rcl_message_info_t message_info;
+  message_info.rmw_message_info.from_intra_process = false;
+  rcl_time_point_value_t before_take = 0;
+  ret = rcl_steady_time_now(&before_take);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_take_loaned_message(&subscription, &taken, &message_info);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(loaned, taken);
+  EXPECT_EQ(42, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  EXPECT_TRUE(message_info.rmw_message_info.from_intra_process);
+  // The message was published before the take started, and is the first of its publisher.
+  EXPECT_LT(0, message_info.source_timestamp);
+  EXPECT_LE(message_info.source_timestamp, before_take);
+  EXPECT_LE(before_take, message_info.received_timestamp);
+  EXPECT_EQ(1u, message_info.publication_sequence_number);
+  // The subscription still holds the message, so only one is left in the pool.
+  void * other = nullptr;
+  ret = rcl_borrow_loaned_message(&publisher, &other);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  void * exhausted = nullptr;
+  ret = rcl_borrow_loaned_message(&publisher, &exhausted);
+  EXPECT_EQ(RCL_RET_PUBLISHER_LOAN_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_return_loaned_message(&publisher, other);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  start_memory_checking();
+  assert_no_malloc_begin();
+  assert_no_realloc_begin();
+  assert_no_free_begin();
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  assert_no_malloc_end();
+  assert_no_realloc_end();
+  assert_no_free_end();
+  stop_memory_checking();
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // A message can only be returned once.
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // Nothing is left to take.
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // With a depth of 1 the second of two messages is dropped, and given back to the pool.
+  for (int64_t i = 0; i < 2; ++i) {
+    ret = rcl_borrow_loaned_message(&publisher, &loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+    ret = rcl_publish_loaned_message(&publisher, loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  ret = rcl_take_loaned_message(&subscription, &taken, &message_info);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(0, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  EXPECT_EQ(2u, message_info.publication_sequence_number);
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  // A subscription with the default options does not receive intra-process messages.
+  rcl_subscription_t default_subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t default_subscription_options =
+    rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(
+    &default_subscription, this->node_ptr, ts, topic, &default_subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(nullptr, rcl_subscription_get_intra_process_guard_condition(&default_subscription));
+  rcl_reset_error();
+  EXPECT_FALSE(rcl_subscription_can_loan_messages(&default_subscription));
+  ret = rcl_take_loaned_message(&default_subscription, &taken, nullptr);
+  EXPECT_EQ(RCL_RET_UNSUPPORTED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+  ret = rcl_subscription_fini(&default_subscription, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}
+
+/* Test that intra-process messages stay valid after their publisher was finalized.
+ */
+TEST_F(
+  CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION),
+  test_subscription_intra_process_publisher_fini)
+{
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_intra_process_publisher_fini_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 2;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    if (publisher.impl) {
+      rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+      EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.ignore_local_publications = true;
+  subscription_options.intra_process_depth = 2;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  for (int64_t i = 0; i < 2; ++i) {
+    void * loaned = nullptr;
+    ret = rcl_borrow_loaned_message(&publisher, &loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+    ret = rcl_publish_loaned_message(&publisher, loaned);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  const void * taken = nullptr;
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // One message is held and the other is still queued when the publisher goes away.
+  ret = rcl_publisher_fini(&publisher, this->node_ptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  publisher.impl = nullptr;
+  EXPECT_EQ(0, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(1, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+}
+
+/* Test that intra-process messages are not taken again from the middleware.
+ */
+TEST_F(
+  CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION),
+  test_subscription_intra_process_no_duplicates)
+{
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_intra_process_no_duplicates_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 1;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.intra_process_depth = 1;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  // Give the middleware time to connect the publisher and the subscription.
+  std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+  // A loaned message goes both ways, a message published by copy only through the middleware.
+  void * loaned = nullptr;
+  ret = rcl_borrow_loaned_message(&publisher, &loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  static_cast<std_msgs__msg__Int64 *>(loaned)->data = 42;
+  ret = rcl_publish_loaned_message(&publisher, loaned);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  {
+    std_msgs__msg__Int64 msg;
+    std_msgs__msg__Int64__init(&msg);
+    msg.data = 7;
+    ret = rcl_publish(&publisher, &msg);
+    std_msgs__msg__Int64__fini(&msg);
+    ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  }
+  const void * taken = nullptr;
+  ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(42, static_cast<const std_msgs__msg__Int64 *>(taken)->data);
+  ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  // The middleware copy of the loaned message is skipped, the two may arrive separately.
+  std_msgs__msg__Int64 msg;
+  std_msgs__msg__Int64__init(&msg);
+  auto msg_exit = make_scope_exit([&msg]() {
+    stop_memory_checking();
+    std_msgs__msg__Int64__fini(&msg);
+  });
+  ret = RCL_RET_SUBSCRIPTION_TAKE_FAILED;
+  for (size_t i = 0; i < 10 && ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED; ++i) {
+    bool success;
+    wait_for_subscription_to_be_ready(&subscription, 1, 100, success);
+    ret = rcl_take(&subscription, &msg, nullptr);
+    if (ret == RCL_RET_SUBSCRIPTION_TAKE_FAILED) {
+      rcl_reset_error();
+    }
+  }
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(7, msg.data);
+  ret = rcl_take(&subscription, &msg, nullptr);
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, ret) << rcl_get_error_string_safe();
+  rcl_reset_error();
+}
+
+/* Test the statistics collected by subscriptions.
+ */
+TEST_F(CLASSNAME(TestSubscriptionFixture, RMW_IMPLEMENTATION), test_subscription_statistics) {
+  stop_memory_checking();
+  rcl_ret_t ret;
+  const rosidl_message_type_support_t * ts = ROSIDL_GET_TYPE_SUPPORT(std_msgs, msg, Int64);
+  const char * topic = "rcl_test_subscription_statistics_chatter_int64";
+  rcl_publisher_t publisher = rcl_get_zero_initialized_publisher();
+  rcl_publisher_options_t publisher_options = rcl_publisher_get_default_options();
+  publisher_options.loaned_message_pool_size = 3;
+  publisher_options.loaned_message_size = sizeof(std_msgs__msg__Int64);
+  ret = rcl_publisher_init(&publisher, this->node_ptr, ts, topic, &publisher_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto publisher_exit = make_scope_exit([&publisher, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_publisher_fini(&publisher, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  rcl_subscription_t subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t subscription_options = rcl_subscription_get_default_options();
+  subscription_options.ignore_local_publications = true;
+  subscription_options.intra_process_depth = 1;
+  subscription_options.enable_statistics = true;
+  ret = rcl_subscription_init(&subscription, this->node_ptr, ts, topic, &subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  auto subscription_exit = make_scope_exit([&subscription, this]() {
+    stop_memory_checking();
+    rcl_ret_t ret = rcl_subscription_fini(&subscription, this->node_ptr);
+    EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  });
+  auto publish = [&publisher](int64_t count) {
+    for (int64_t i = 0; i < count; ++i) {
+      void * loaned = nullptr;
+      rcl_ret_t ret = rcl_borrow_loaned_message(&publisher, &loaned);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+      static_cast<std_msgs__msg__Int64 *>(loaned)->data = i;
+      ret = rcl_publish_loaned_message(&publisher, loaned);
+      ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+    }
+  };
+  auto take = [&subscription]() {
+    const void * taken = nullptr;
+    rcl_ret_t ret = rcl_take_loaned_message(&subscription, &taken, nullptr);
+    if (ret == RCL_RET_OK) {
+      ret = rcl_return_loaned_message_from_subscription(&subscription, taken);
+    }
+    return ret;
+  };
+  // The queue holds a single message, so of three messages in a row two are dropped.
+  publish(1);
+  ASSERT_EQ(RCL_RET_OK, take()) << rcl_get_error_string_safe();
+  EXPECT_EQ(RCL_RET_SUBSCRIPTION_TAKE_FAILED, take());
+  publish(3);
+  ASSERT_EQ(RCL_RET_OK, take()) << rcl_get_error_string_safe();
+  publish(1);
+  start_memory_checking();
+  assert_no_malloc_begin();
+  ret = take();
+  assert_no_malloc_end();
+  stop_memory_checking();
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  rcl_subscription_statistics_t statistics;
+  ret = rcl_subscription_get_statistics(&subscription, &statistics);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  EXPECT_EQ(std::string(topic), statistics.topic_name);
+  EXPECT_EQ(3u, statistics.take_count);
+  EXPECT_EQ(1u, statistics.empty_take_count);
+  EXPECT_EQ(2u, statistics.dropped_count);
+  EXPECT_EQ(3u, statistics.aged_count);
+  uint64_t aged = 0;
+  uint64_t intervals = 0;
+  for (size_t i = 0; i < RCL_STATISTICS_LATENCY_HISTOGRAM_SIZE; ++i) {
+    aged += statistics.age_histogram[i];
+    intervals += statistics.inter_arrival_histogram[i];
+  }
+  EXPECT_EQ(3u, aged);
+  EXPECT_EQ(2u, intervals);
+  // Only the subscription with statistics enabled is listed for the node.
+  rcl_subscription_t default_subscription = rcl_get_zero_initialized_subscription();
+  rcl_subscription_options_t default_subscription_options =
+    rcl_subscription_get_default_options();
+  ret = rcl_subscription_init(
+    &default_subscription, this->node_ptr, ts, topic, &default_subscription_options);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  size_t count = 0;
+  rcl_subscription_statistics_t node_statistics[2];
+  ret = rcl_node_get_subscription_statistics(this->node_ptr, node_statistics, 2, &count);
+  ASSERT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+  ASSERT_EQ(1u, count);
+  EXPECT_EQ(3u, node_statistics[0].take_count);
+  ret = rcl_subscription_get_statistics(&default_subscription, &statistics);
+  EXPECT_EQ(RCL_RET_INVALID_ARGUMENT, ret);
+  rcl_reset_error();
+  ret = rcl_subscription_fini(&default_subscription, this->node_ptr);
+  EXPECT_EQ(RCL_RET_OK, ret) << rcl_get_error_string_safe();
+}